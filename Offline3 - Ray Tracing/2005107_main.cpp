@@ -2,13 +2,28 @@
 using namespace std;
 #include "2005107_main.hpp"
 #include "bitmap_image.hpp"
-#include "header/Camera/2005107_Camera.h"
-
-#ifdef __linux__
-#include <GL/glut.h>
-#elif WIN32
-#include <glut.h>
-#include <windows.h>
+#include "header/TileScheduler/2005107_TileScheduler.h"
+#include "header/Benchmark/2005107_Benchmark.h"
+#include "header/Sampling/2005107_Sampling.h"
+#include "header/CameraPath/2005107_CameraPath.h"
+#include "header/FrameWriter/2005107_FrameWriter.h"
+#include "header/RenderStats/2005107_RenderStats.h"
+#include "header/SceneGenerator/2005107_SceneGenerator.h"
+#include "header/ScratchArena/2005107_ScratchArena.h"
+#include "header/AllocationCheck/2005107_AllocationCheck.h"
+#include "header/Wavefront/2005107_Wavefront.h"
+#include "header/LightTree/2005107_LightTree.h"
+#include "header/MappedFile/2005107_MappedFile.h"
+#include "header/TextScanner/2005107_TextScanner.h"
+#include "header/SceneStore/2005107_SceneStore.h"
+#include "header/SceneCache/2005107_SceneCache.h"
+#include "header/TiledBmpWriter/2005107_TiledBmpWriter.h"
+#include "header/WorkerPool/2005107_WorkerPool.h"
+
+// Render-only builds (-DRENDER_ONLY) leave out the GLUT viewer so they link
+// without OpenGL and always render headless
+#ifndef RENDER_ONLY
+#include "2005107_viewer.hpp"
 #endif
 
 // Configuration constants
@@ -21,6 +36,14 @@ struct Config {
     static constexpr double CAMERA_ROTATION_SPEED = 2.0;
     static constexpr int DEFAULT_WINDOW_POS_X = 100;
     static constexpr int DEFAULT_WINDOW_POS_Y = 100;
+    static constexpr int DEFAULT_TILE_SIZE = 32;
+    static constexpr int BENCHMARK_PASSES = 3;
+    static constexpr int PROGRESSIVE_EXTRA_SAMPLES = 4;
+    static constexpr int DEFAULT_AA_MAX_SAMPLES = 1;
+    static constexpr double DEFAULT_AA_THRESHOLD = 0.1;
+    static constexpr int FRAME_WRITER_QUEUE = 2;
+    static constexpr int DEFAULT_LIGHT_SAMPLES = 0; // every light at every hit
+    static constexpr int TILED_OUTPUT_BAND_TILES = 64; // at least, per band; keeps every core busy without depending on how many there are
 };
 
 // Global variables definitions
@@ -30,8 +53,12 @@ double fieldOfViewY = Config::DEFAULT_FOVY;
 double zNear = Config::DEFAULT_ZNEAR; 
 double zFar = Config::DEFAULT_ZFAR;
 vector<Object *> objects;
+SceneStore sceneStore; // owns the spheres, triangles and quadrics in objects
 vector<PointLight *> pointLights;
 vector<SpotLight *> spotLights;
+CompiledScene compiledScene;
+LightTree lightTree;
+int lightSampleBudget = Config::DEFAULT_LIGHT_SAMPLES;
 
 double cameraMovementSpeed = Config::CAMERA_MOVEMENT_SPEED;
 double cameraRotationSpeed = Config::CAMERA_ROTATION_SPEED;
@@ -49,90 +76,155 @@ double windowPositionY = Config::DEFAULT_WINDOW_POS_Y;
 int captureCount = 0;
 string outputFileDirectory;
 string textureFilePath = "";
+TextureFilter textureFilter = TEXTURE_TRILINEAR;
+
+int renderThreadCount = TileScheduler::defaultThreadCount();
+int tileSize = Config::DEFAULT_TILE_SIZE;
+bool usePacketTracing = false;
+bool useWavefront = false;
+SimdLevel requestedSimdLevel = SIMD_AVX2;
+AccelerationMode accelerationMode = ACCELERATION_BVH;
+bool useSceneCache = true;
+bool sceneNamesMesh = false; // set by readMesh(), which keeps a scene out of the cache
+unsigned long long sceneTextHash = 0; // of the loaded scene file
+bool benchmarkMode = false;
+string benchmarkSuitePath = "";
+string compareReferencePath = "", compareCandidatePath = "";
+double compareMinimumPsnr = -1; // --compare fails below this, when set
+#ifdef RENDER_ONLY
+bool renderMode = true;
+#else
+bool renderMode = false;
+#endif
+string renderOutputPath = "";
+bool tiledOutput = false;
+bool resumeTiledOutput = false;
+int renderResolution = 0; // overrides the scene's dimension when set
+int workerCount = 0;
+int workerFd = -1; // socket to the coordinator, in worker processes
+string cameraPathFilePath = "";
+int antiAliasingMaxSamples = Config::DEFAULT_AA_MAX_SAMPLES;
+double antiAliasingThreshold = Config::DEFAULT_AA_THRESHOLD;
+bool renderCameraOverride = false;
+Vector3D renderCameraPosition, renderCameraLook, renderCameraUp;
 
 Camera camera;
 
+// Defined after the scene globals so that, on exit, it is destroyed (and its
+// worker stopped) before the objects it traces against
+ProgressiveRenderer progressiveRenderer;
+int progressiveExtraSamples = Config::PROGRESSIVE_EXTRA_SAMPLES;
+WorkerPool workerPool;
+
+// Primary rays through the capture image for the camera as it is when the
+// generator is created; integer (i, j) are pixel centres
+struct PrimaryRayGenerator {
+    Vector3D cameraPosition, cameraUpDirection, cameraRightDirection;
+    Vector3D topLeftCorner; // centre of pixel (0, 0)
+    double pixelWidth, pixelHeight;
+
+    PrimaryRayGenerator();
+    Ray operator()(double i, double j) const;
+};
+
 // Forward declarations
-void capture();
-Color traceRay(const Ray& ray);
-Object* createSphere(ifstream& in);
-Object* createTriangle(ifstream& in);
-Object* createGeneral(ifstream& in);
+void renderHeadless();
+int serveCoordinator();
+void renderAnimation();
+void runBenchmark();
+void runBenchmarkSuite();
+bool compareImages(const string& referencePath, const string& candidatePath);
+Color traceRay(const Ray& ray, const Object** primaryObject = nullptr);
+void tracePacket(const Ray rays[PACKET_SIZE], int laneMask, Color colors[PACKET_SIZE], const Object* primaryObjects[PACKET_SIZE] = nullptr);
+bool readSphere(TextScanner& in);
+bool readTriangle(TextScanner& in);
+bool readGeneral(TextScanner& in);
+bool readMesh(TextScanner& in);
 void initializeFloor();
-void adjustMovementSpeed(bool increase);
-void adjustRotationSpeed(bool increase);
-void displayCameraInfo();
-void displayHelp();
-
-// Helper function to create sphere objects
-Object* createSphere(ifstream& in) {
-    double centerX, centerY, centerZ, radius;
-    in >> centerX >> centerY >> centerZ >> radius;
-    
-    double r, g, b;
-    in >> r >> g >> b;
-    
-    double ambient, diffuse, specular, reflection;
-    in >> ambient >> diffuse >> specular >> reflection;
-    
+
+// Colour, Phong coefficients and shininess, which end every object
+bool readMaterial(TextScanner& in, Object& object) {
+    double color[3], coefficients[4];
     int shininess;
-    in >> shininess;
-    
-    Sphere* sphere = new Sphere(Vector3D(centerX, centerY, centerZ), radius);
-    sphere->setColor(Color(r, g, b));
-    sphere->setCoefficients(Coefficients(ambient, diffuse, specular, reflection));
-    sphere->setShine(shininess);
-    
-    return sphere;
+    if (!in.readDoubles(color, 3, "a colour component") || !in.readDoubles(coefficients, 4, "a lighting coefficient") ||
+        !in.readInt(shininess, "an integer shininess")) {
+        return false;
+    }
+    object.setColor(Color(color[0], color[1], color[2]));
+    object.setCoefficients(Coefficients(coefficients[0], coefficients[1], coefficients[2], coefficients[3]));
+    object.setShine(shininess);
+    return true;
 }
 
-// Helper function to create triangle objects
-Object* createTriangle(ifstream& in) {
-    double x1, y1, z1, x2, y2, z2, x3, y3, z3;
-    in >> x1 >> y1 >> z1 >> x2 >> y2 >> z2 >> x3 >> y3 >> z3;
-    
-    double r, g, b;
-    in >> r >> g >> b;
-    
-    double ambient, diffuse, specular, reflection;
-    in >> ambient >> diffuse >> specular >> reflection;
-    
-    int shininess;
-    in >> shininess;
-    
-    Triangle* triangle = new Triangle(Vector3D(x1, y1, z1), Vector3D(x2, y2, z2), Vector3D(x3, y3, z3));
-    triangle->setColor(Color(r, g, b));
-    triangle->setCoefficients(Coefficients(ambient, diffuse, specular, reflection));
-    triangle->setShine(shininess);
-    
-    return triangle;
+// Helper function to read a sphere into the scene store
+bool readSphere(TextScanner& in) {
+    double values[4];
+    if (!in.readDoubles(values, 4, "a sphere centre or radius")) {
+        return false;
+    }
+    Sphere& sphere = sceneStore.addSphere(Vector3D(values[0], values[1], values[2]), values[3]);
+    objects.push_back(&sphere);
+    return readMaterial(in, sphere);
 }
 
-// Helper function to create general quadric objects
-Object* createGeneral(ifstream& in) {
-    double a, b, c, d, e, f, g, h, i, j;
-    in >> a >> b >> c >> d >> e >> f >> g >> h >> i >> j;
-    
-    Vector3D referencePoint;
-    double height, width, length;
-    in >> referencePoint.x >> referencePoint.y >> referencePoint.z >> height >> width >> length;
-    
-    double red, green, blue;
-    in >> red >> green >> blue;
-    
-    double ambient, diffuse, specular, reflection;
-    in >> ambient >> diffuse >> specular >> reflection;
-    
-    int shininess;
-    in >> shininess;
-    
-    General* general = new General(a, b, c, d, e, f, g, h, i, j);
-    general->setBoundingBox(referencePoint, height, width, length);
-    general->setColor(Color(red, green, blue));
-    general->setCoefficients(Coefficients(ambient, diffuse, specular, reflection));
-    general->setShine(shininess);
-    
-    return general;
+// Helper function to read a triangle into the scene store
+bool readTriangle(TextScanner& in) {
+    double values[9];
+    if (!in.readDoubles(values, 9, "a triangle vertex coordinate")) {
+        return false;
+    }
+    Triangle& triangle = sceneStore.addTriangle(Vector3D(values[0], values[1], values[2]), Vector3D(values[3], values[4], values[5]),
+                                                Vector3D(values[6], values[7], values[8]));
+    objects.push_back(&triangle);
+    return readMaterial(in, triangle);
+}
+
+// Helper function to read a general quadric into the scene store
+bool readGeneral(TextScanner& in) {
+    double c[10], box[6];
+    if (!in.readDoubles(c, 10, "a quadric coefficient") || !in.readDoubles(box, 6, "a quadric reference point or size")) {
+        return false;
+    }
+    General& general = sceneStore.addGeneral(c);
+    general.setBoundingBox(Vector3D(box[0], box[1], box[2]), box[3], box[4], box[5]);
+    objects.push_back(&general);
+    return readMaterial(in, general);
+}
+
+// Helper function to read a triangle mesh loaded from an OBJ or binary PLY file.
+// The vertices are scaled, rotated about x, y, z (degrees) and translated, in that order.
+// A mesh that cannot be loaded is skipped rather than failing the scene.
+bool readMesh(TextScanner& in) {
+    sceneNamesMesh = true;
+    string fileName;
+    double transform[7];
+    if (!in.readWord(fileName, "a mesh file name") || !in.readDoubles(transform, 7, "a mesh translation, rotation or scale")) {
+        return false;
+    }
+    Vector3D translation(transform[0], transform[1], transform[2]), rotation(transform[3], transform[4], transform[5]);
+    double scale = transform[6];
+
+    auto start = chrono::steady_clock::now();
+    TriangleMesh* mesh = new TriangleMesh();
+    if (!readMaterial(in, *mesh)) {
+        delete mesh;
+        return false;
+    }
+    string error;
+    if (!mesh->load(fileName, error)) {
+        cout << "Skipping mesh: " << error << endl;
+        delete mesh;
+        return true;
+    }
+    mesh->transform(scale, rotation, translation);
+    mesh->buildHierarchy();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Mesh " << fileName << ": " << mesh->getTriangleCount() << " triangles, " << mesh->getVertexCount()
+         << " vertices, " << mesh->getNodeCount() << " nodes, "
+         << (double)mesh->getMemoryUsage() / mesh->getTriangleCount() << " bytes per triangle, loaded in " << seconds << " s" << endl;
+    objects.push_back(mesh);
+    return true;
 }
 
 // Initialize the checkered floor
@@ -144,6 +236,7 @@ void initializeFloor() {
     checkeredFloor->tileColor2 = Color(0, 0, 0);
     
     // Apply texture if specified
+    checkeredFloor->setTextureFilter(textureFilter);
     if (!textureFilePath.empty()) {
         checkeredFloor->setTexture(textureFilePath);
     }
@@ -151,96 +244,158 @@ void initializeFloor() {
     objects.push_back(checkeredFloor);
 }
 
-void loadObjects(ifstream &in)
+// Spheres, triangles and quadrics are built in place in the scene store
+bool loadObjects(TextScanner &in)
 {
-    initializeFloor();
-    
     int numberOfObjects;
-    in >> numberOfObjects;
+    if (!in.readInt(numberOfObjects, "the number of objects"))
+    {
+        return false;
+    }
     
     for (int i = 0; i < numberOfObjects; i++)
     {
         string objectType;
-        in >> objectType;
-        
-        Object* newObject = nullptr;
+        if (!in.readWord(objectType, "an object type"))
+        {
+            return false;
+        }
         
+        bool read;
         if (objectType == "sphere") {
-            newObject = createSphere(in);
+            read = readSphere(in);
         } else if (objectType == "triangle") {
-            newObject = createTriangle(in);
-        } else if (objectType == "general") {
-            newObject = createGeneral(in);
+            read = readTriangle(in);
         } else if (objectType == "general") {
-            newObject = createGeneral(in);
+            read = readGeneral(in);
+        } else if (objectType == "mesh") {
+            read = readMesh(in);
+        } else {
+            read = in.fail("unknown object type '" + objectType + "'");
         }
         
-        if (newObject != nullptr) {
-            objects.push_back(newObject);
+        if (!read) {
+            return false;
         }
     }
+    return true;
 }
 
-void loadPointLights(ifstream &in)
+bool loadPointLights(TextScanner &in)
 {
     int numberOfPointLights;
-    in >> numberOfPointLights;
+    if (!in.readInt(numberOfPointLights, "the number of point lights"))
+    {
+        return false;
+    }
     
     for (int i = 0; i < numberOfPointLights; i++)
     {
-        double x, y, z;
-        in >> x >> y >> z;
-        
-        double r, g, b;
-        in >> r >> g >> b;
+        double values[6];
+        if (!in.readDoubles(values, 3, "a point light position") || !in.readDoubles(values + 3, 3, "a point light colour component"))
+        {
+            return false;
+        }
         
         PointLight *pointLight = new PointLight();
-        pointLight->setLightPosition(x, y, z);
-        pointLight->setColor(Color(r, g, b));
+        pointLight->setLightPosition(values[0], values[1], values[2]);
+        pointLight->setColor(Color(values[3], values[4], values[5]));
         
         pointLights.push_back(pointLight);
     }
+    return true;
 }
 
-void loadSpotLights(ifstream &in)
+bool loadSpotLights(TextScanner &in)
 {
     int numberOfSpotLights;
-    in >> numberOfSpotLights;
+    if (!in.readInt(numberOfSpotLights, "the number of spot lights"))
+    {
+        return false;
+    }
     
     for (int i = 0; i < numberOfSpotLights; i++)
     {
-        double x, y, z;
-        in >> x >> y >> z;
-        
-        double r, g, b;
-        in >> r >> g >> b;
-        
-        double directionX, directionY, directionZ;
-        in >> directionX >> directionY >> directionZ;
-        
-        double cutoffAngle;
-        in >> cutoffAngle;
+        double values[10];
+        if (!in.readDoubles(values, 3, "a spot light position") || !in.readDoubles(values + 3, 3, "a spot light colour component") ||
+            !in.readDoubles(values + 6, 3, "a spot light direction") || !in.readDouble(values[9], "a spot light cutoff angle"))
+        {
+            return false;
+        }
         
         SpotLight *spotLight = new SpotLight();
-        spotLight->setLightPosition(x, y, z);
-        spotLight->setColor(Color(r, g, b));
-        spotLight->setLightDirection(directionX, directionY, directionZ);
-        spotLight->setCutoffAngle(cutoffAngle);
+        spotLight->setLightPosition(values[0], values[1], values[2]);
+        spotLight->setColor(Color(values[3], values[4], values[5]));
+        spotLight->setLightDirection(values[6], values[7], values[8]);
+        spotLight->setCutoffAngle(values[9]);
         
         spotLights.push_back(spotLight);
     }
+    return true;
 }
 
-void loadData(string fileName)
+// Parses the scene file in place from a memory map. Anything after the spot
+// lights is never read, so the notes at the end of the sample scenes are fine.
+// On failure error says where the file went wrong. Unless --no-scene-cache is
+// given, a compiled copy of the scene is kept next to the file and used
+// instead of the text for as long as the text is unchanged.
+bool loadData(const string& fileName, string& error)
 {
-    ifstream in(fileName);
-    double dimension;
-    in >> recursionLevel >> dimension;
+    MappedFile file;
+    if (!file.open(fileName, error)) {
+        return false;
+    }
+    initializeFloor();
+    sceneNamesMesh = false;
+
+    SceneCacheContents cache = {recursionLevel, 0, objects.size(), objects, pointLights, spotLights, sceneStore, compiledScene};
+    string cachePath = sceneCachePath(fileName);
+    // Also names the scene in a tiled render's progress file, so it is always computed
+    sceneTextHash = hashSceneText(file.begin(), file.end());
+    bool cached = false, hierarchyBuilt = false;
+    if (useSceneCache) {
+        string reason;
+        cached = loadSceneCache(cachePath, sceneTextHash, accelerationMode, cache, hierarchyBuilt, reason);
+        if (cached) {
+            cout << "Scene cache: loaded " << cachePath << endl;
+        } else {
+            cout << "Scene cache: not used, " << reason << endl;
+        }
+    }
+
+    double dimension = cache.dimension;
+    if (cached) {
+        recursionLevel = cache.recursionLevel;
+    } else {
+        TextScanner in(file.begin(), file.end(), fileName);
+        if (!in.readDouble(recursionLevel, "the recursion level") || !in.readDouble(dimension, "the image dimension") ||
+            !loadObjects(in) || !loadPointLights(in) || !loadSpotLights(in)) {
+            error = in.getError();
+            return false;
+        }
+        // Objects never move after loading, so the hierarchy is built exactly once
+        compiledScene.compile(objects, accelerationMode);
+    }
     windowHeight = windowWidth = dimension;
     imageHeight = imageWidth = dimension;
-    loadObjects(in);
-    loadPointLights(in);
-    loadSpotLights(in);
+    lightTree.build(pointLights, spotLights);
+
+    // Also rewritten when a cache saved in flat mode just had its hierarchy built.
+    // Mesh files can change without the scene text changing, so scenes that
+    // name one are never cached, even when the mesh was skipped.
+    if (useSceneCache && sceneNamesMesh) {
+        cout << "Scene cache: not written, scenes with meshes are read from the text every time" << endl;
+    } else if (useSceneCache && (!cached || hierarchyBuilt)) {
+        cache.recursionLevel = recursionLevel;
+        cache.dimension = dimension;
+        string cacheError;
+        if (saveSceneCache(cachePath, sceneTextHash, cache, cacheError)) {
+            cout << "Scene cache: written to " << cachePath << endl;
+        } else {
+            cout << "Scene cache: not written, " << cacheError << endl;
+        }
+    }
+    return true;
 }
 
 void printInputs()
@@ -259,252 +414,274 @@ void printInputs()
     }
 }
 
-void init()
-{
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Set background color to black and opaque
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-
-    GLdouble aspectRatio = (GLdouble)windowWidth / (GLdouble)windowHeight;
-    gluPerspective(fieldOfViewY, aspectRatio, zNear, zFar);
-    glMatrixMode(GL_MODELVIEW);
-
-    // Initialize camera with the original camera values
-    camera.setPosition(initialCameraPosition);
-    camera.setLookDirection(initialCameraLook);
-    camera.setUpDirection(initialCameraUp);
-    camera.setMovementSpeed(cameraMovementSpeed);
-    camera.setRotationSpeed(cameraRotationSpeed);
-}
-
-void drawObjects()
+// Also empties the lists, so a half loaded scene can be freed too
+void freeMemory()
 {
     for (int i = 0; i < objects.size(); i++)
     {
-        objects[i]->draw();
+        if (!sceneStore.owns(objects[i]))
+        {
+            delete objects[i];
+        }
     }
-}
-
-void drawLights()
-{
     for (int i = 0; i < pointLights.size(); i++)
     {
-        pointLights[i]->draw();
+        delete pointLights[i];
     }
     for (int i = 0; i < spotLights.size(); i++)
     {
-        spotLights[i]->draw();
+        delete spotLights[i];
     }
+    objects.clear();
+    pointLights.clear();
+    spotLights.clear();
+    sceneStore.clear();
 }
 
-void display()
-{
-    glEnable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-
-    camera.applyLookAt();
-
-    drawObjects();
-    drawLights();
-
-    glutSwapBuffers();
-}
-
-void reshape(int width, int height)
-{
-    if (height == 0) height = 1; // Prevent divide by zero
-
-    GLfloat aspectRatio = (GLfloat)width / (GLfloat)height;
-    glViewport(0, 0, width, height);
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(fieldOfViewY, aspectRatio, zNear, zFar);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+// Validation and initialization functions
+void printUsage(const char* programName) {
+    cout << "Usage: " << programName << " <input_file_path> <output_file_dir> [texture_file_path] [--threads N] [--tile-size N] [--packets] [--wavefront] [--simd scalar|sse2|avx2] [--flat] [--benchmark]" << endl;
+    cout << "       [--render] [--camera px,py,pz,lx,ly,lz,ux,uy,uz] [--out file.bmp] [--extra-samples N] [--aa N] [--aa-threshold T]" << endl;
+    cout << "       [--camera-path file.txt] [--phase-timers] [--texture-filter nearest|bilinear|trilinear] [--light-samples N]" << endl;
+    cout << "       [--no-scene-cache] [--resolution N] [--tiled-output] [--resume] [--workers N]" << endl;
+    cout << "       " << programName << " --benchmark-suite results.json [--threads N] [--tile-size N] [--packets] [--simd scalar|sse2|avx2] [--phase-timers] [--light-samples N]" << endl;
+    cout << "       " << programName << " --compare reference.bmp candidate.bmp [--min-psnr dB]" << endl;
 }
 
-void keyboardListener(unsigned char key, int x, int y)
-{
-    switch (key)
-    {
-    // Capture image
-    case '0':
-        capture();
-        break;
-        
-    // Rotation controls
-    case '1':
-        camera.lookLeft();
-        cout << "Looking left" << endl;
-        break;
-    case '2':
-        camera.lookRight();
-        cout << "Looking right" << endl;
-        break;
-    case '3':
-        camera.lookUp();
-        cout << "Looking up" << endl;
-        break;
-    case '4':
-        camera.lookDown();
-        cout << "Looking down" << endl;
-        break;
-    case '5':
-        camera.tiltCounterClockwise();
-        cout << "Tilting counter-clockwise" << endl;
-        break;
-    case '6':
-        camera.tiltClockwise();
-        cout << "Tilting clockwise" << endl;
-        break;
-        
-    // Speed controls
-    case 'w':
-    case 'W':
-        adjustMovementSpeed(true);
-        break;
-    case 's':
-    case 'S':
-        adjustMovementSpeed(false);
-        break;
-    case 'a':
-    case 'A':
-        adjustRotationSpeed(true);
-        break;
-    case 'd':
-    case 'D':
-        adjustRotationSpeed(false);
-        break;
-        
-    // Camera actions
-    case 'r':
-    case 'R':
-        camera.reset();
-        cout << "Camera reset to initial position" << endl;
-        break;
-    case 'c':
-    case 'C':
-        displayCameraInfo();
-        break;
-        
-    // Help and quit
-    case 'h':
-    case 'H':
-        displayHelp();
-        break;
-    case 'q':
-    case 'Q':
-        cout << "Exiting program..." << endl;
-        exit(0);
-        break;
-        
-    default:
-        cout << "Unknown key: '" << key << "' - Press 'H' for help" << endl;
-        break;
+// "px,py,pz,lx,ly,lz,ux,uy,uz": camera position, look direction and up direction
+bool parseCameraPose(const string& text, Vector3D& position, Vector3D& look, Vector3D& up) {
+    stringstream stream(text);
+    double values[9];
+    for (int k = 0; k < 9; k++) {
+        string field;
+        if (!getline(stream, field, ',')) {
+            return false;
+        }
+        char* end = nullptr;
+        values[k] = strtod(field.c_str(), &end);
+        if (end == field.c_str() || *end != '\0') {
+            return false;
+        }
+    }
+    string rest;
+    if (getline(stream, rest, ',')) {
+        return false;
     }
+    position = Vector3D(values[0], values[1], values[2]);
+    look = Vector3D(values[3], values[4], values[5]);
+    up = Vector3D(values[6], values[7], values[8]);
+    return true;
 }
 
-void keyboardSpecialListener(int key, int x, int y)
-{
-    switch (key)
-    {
-    case GLUT_KEY_UP:
-        camera.moveForward();
-        cout << "Moving forward" << endl;
-        break;
-    case GLUT_KEY_DOWN:
-        camera.moveBackward();
-        cout << "Moving backward" << endl;
-        break;
-    case GLUT_KEY_RIGHT:
-        camera.moveRight();
-        cout << "Moving right" << endl;
-        break;
-    case GLUT_KEY_LEFT:
-        camera.moveLeft();
-        cout << "Moving left" << endl;
-        break;
-    case GLUT_KEY_PAGE_UP:
-        camera.moveUp();
-        cout << "Moving up" << endl;
-        break;
-    case GLUT_KEY_PAGE_DOWN:
-        camera.moveDown();
-        cout << "Moving down" << endl;
-        break;
-    default:
-        cout << "Unknown special key - Press 'H' for help" << endl;
-        break;
-    }
-}
-
-void idle()
-{
-    glutPostRedisplay();
-}
+// Pulls "--option value" pairs out of argv, leaving the positional arguments in place
+bool parseOptions(int& argc, char** argv) {
+    int positionalCount = 1;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--packets") {
+            usePacketTracing = true;
+        } else if (argument == "--wavefront") {
+            useWavefront = true;
+        } else if (argument == "--flat") {
+            accelerationMode = ACCELERATION_FLAT;
+        } else if (argument == "--no-scene-cache") {
+            useSceneCache = false;
+        } else if (argument == "--tiled-output") {
+            tiledOutput = true;
+        } else if (argument == "--resume") {
+            tiledOutput = resumeTiledOutput = true;
+        } else if (argument == "--benchmark") {
+            benchmarkMode = true;
+        } else if (argument == "--phase-timers") {
+            setPhaseTimersEnabled(true);
+        } else if (argument == "--render") {
+            renderMode = true;
+        } else if (argument == "--out") {
+            if (i + 1 >= argc) {
+                cout << "Option --out expects a file path" << endl;
+                return false;
+            }
+            renderOutputPath = argv[++i];
+        } else if (argument == "--camera-path") {
+            if (i + 1 >= argc) {
+                cout << "Option --camera-path expects a file path" << endl;
+                return false;
+            }
+            cameraPathFilePath = argv[++i];
+        } else if (argument == "--benchmark-suite") {
+            if (i + 1 >= argc) {
+                cout << "Option --benchmark-suite expects a JSON file path" << endl;
+                return false;
+            }
+            benchmarkSuitePath = argv[++i];
+        } else if (argument == "--compare") {
+            if (i + 2 >= argc) {
+                cout << "Option --compare expects two BMP file paths" << endl;
+                return false;
+            }
+            compareReferencePath = argv[++i];
+            compareCandidatePath = argv[++i];
+        } else if (argument == "--camera") {
+            if (i + 1 >= argc || !parseCameraPose(argv[i + 1], renderCameraPosition, renderCameraLook, renderCameraUp)) {
+                cout << "Option --camera expects nine comma separated numbers: position, look and up" << endl;
+                return false;
+            }
+            renderCameraOverride = true;
+            i++;
+        } else if (argument == "--extra-samples") {
+            if (i + 1 >= argc || atoi(argv[i + 1]) < 0 || !isdigit(argv[i + 1][0])) {
+                cout << "Option --extra-samples expects a non-negative integer" << endl;
+                return false;
+            }
+            progressiveExtraSamples = atoi(argv[++i]);
+        } else if (argument == "--light-samples") {
+            int value = i + 1 < argc && isdigit(argv[i + 1][0]) ? atoi(argv[i + 1]) : -1;
+            if (value < 0 || value > MAX_LIGHT_SAMPLES) {
+                cout << "Option --light-samples expects an integer from 0 (every light) to " << MAX_LIGHT_SAMPLES << endl;
+                return false;
+            }
+            lightSampleBudget = value;
+            i++;
+        } else if (argument == "--min-psnr") {
+            char* end = nullptr;
+            double value = i + 1 < argc ? strtod(argv[i + 1], &end) : -1;
+            if (i + 1 >= argc || end == argv[i + 1] || *end != '\0' || value < 0) {
+                cout << "Option --min-psnr expects a non-negative number of decibels" << endl;
+                return false;
+            }
+            compareMinimumPsnr = value;
+            i++;
+        } else if (argument == "--aa-threshold") {
+            char* end = nullptr;
+            double value = i + 1 < argc ? strtod(argv[i + 1], &end) : -1;
+            if (i + 1 >= argc || end == argv[i + 1] || *end != '\0' || value < 0) {
+                cout << "Option --aa-threshold expects a non-negative number" << endl;
+                return false;
+            }
+            antiAliasingThreshold = value;
+            i++;
+        } else if (argument == "--texture-filter") {
+            if (i + 1 >= argc || !parseTextureFilter(argv[i + 1], textureFilter)) {
+                cout << "Option --texture-filter expects one of: nearest, bilinear, trilinear" << endl;
+                return false;
+            }
+            i++;
+        } else if (argument == "--simd") {
+            if (i + 1 >= argc || !parseSimdLevel(argv[i + 1], requestedSimdLevel)) {
+                cout << "Option --simd expects one of: scalar, sse2, avx2" << endl;
+                return false;
+            }
+            i++;
+        } else if (argument == "--worker-fd") {
+            if (i + 1 >= argc || !isdigit(argv[i + 1][0])) {
+                cout << "Option --worker-fd expects a file descriptor" << endl;
+                return false;
+            }
+            workerFd = atoi(argv[++i]);
+        } else if (argument == "--threads" || argument == "--tile-size" || argument == "--aa" || argument == "--resolution" ||
+                   argument == "--workers") {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+                cout << "Option " << argument << " expects a positive integer" << endl;
+                return false;
+            }
+            int value = atoi(argv[++i]);
+            if (argument == "--threads") {
+                renderThreadCount = value;
+            } else if (argument == "--aa") {
+                antiAliasingMaxSamples = value;
+            } else if (argument == "--resolution") {
+                renderResolution = value;
+            } else if (argument == "--workers") {
+                workerCount = value;
+            } else {
+                tileSize = value;
+            }
+        } else {
+            argv[positionalCount++] = argv[i];
+        }
+    }
+    argc = positionalCount;
+    argv[argc] = nullptr;
 
-void freeMemory()
-{
-    for (int i = 0; i < objects.size(); i++)
-    {
-        delete objects[i];
+    // Refinement needs the centre samples of the whole image, which tiled output never holds
+    if (tiledOutput && antiAliasingMaxSamples > 1) {
+        cout << "Option --aa cannot be combined with --tiled-output or --resume" << endl;
+        return false;
     }
-    for (int i = 0; i < pointLights.size(); i++)
-    {
-        delete pointLights[i];
+    // Workers return bands of an image the coordinator holds whole, and only
+    // headless captures hand them out; anywhere else they would load the scene and idle
+    if (workerCount > 0 && (tiledOutput || antiAliasingMaxSamples > 1)) {
+        cout << "Option --workers cannot be combined with --tiled-output, --resume or --aa" << endl;
+        return false;
     }
-    for (int i = 0; i < spotLights.size(); i++)
-    {
-        delete spotLights[i];
+    if (workerCount > 0 && (!renderMode || benchmarkMode || !cameraPathFilePath.empty())) {
+        cout << "Option --workers needs --render and cannot be combined with --benchmark or --camera-path" << endl;
+        return false;
     }
+    return true;
 }
 
-// Validation and initialization functions
 bool validateArguments(int argc, char** argv) {
     if (argc < 3) {
-        cout << "Usage: " << argv[0] << " <input_file_path> <output_file_dir> [texture_file_path]" << endl;
+        printUsage(argv[0]);
         return false;
     }
     return true;
 }
 
-void initializeSystem(const string& inputFilePath, const string& outputDirectory) {
+bool initializeSystem(const string& inputFilePath, const string& outputDirectory) {
     outputFileDirectory = outputDirectory;
-    loadData(inputFilePath);
-}
-
-void setupGraphics(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-    glutInitWindowSize(768, 768);
-    glutInitWindowPosition(windowPositionX, windowPositionY);
-    glutCreateWindow("Ray Tracing");
-    
-    glutDisplayFunc(display);
-    glutReshapeFunc(reshape);
-    glutKeyboardFunc(keyboardListener);
-    glutSpecialFunc(keyboardSpecialListener);
-    glutIdleFunc(idle);
-    
-    init();
-}
-
-void runMainLoop() {
-    glutMainLoop();
+    string error;
+    if (!loadData(inputFilePath, error)) {
+        cout << "Error: could not load scene: " << error << endl;
+        freeMemory();
+        return false;
+    }
+    return true;
 }
 
 void cleanup() {
+    workerPool.stop();
     freeMemory();
 }
 
+// The command line minus what only the coordinator acts on: workers load the
+// same scene with the same render options, split the coordinator's threads
+// between them, and receive the view with each frame
+vector<string> workerArguments(const vector<string>& commandLine) {
+    static const set<string> coordinatorFlags = {"--render", "--benchmark", "--tiled-output", "--resume", "--phase-timers"};
+    static const set<string> coordinatorOptions = {"--workers", "--threads", "--out", "--camera", "--camera-path", "--extra-samples", "--aa", "--aa-threshold"};
+    vector<string> arguments;
+    for (size_t k = 0; k < commandLine.size(); k++) {
+        if (coordinatorOptions.count(commandLine[k])) {
+            k++;
+        } else if (!coordinatorFlags.count(commandLine[k])) {
+            arguments.push_back(commandLine[k]);
+        }
+    }
+    arguments.push_back("--threads");
+    arguments.push_back(to_string(max(1, renderThreadCount / workerCount)));
+    return arguments;
+}
+
 int main(int argc, char **argv)
 {
+    vector<string> commandLine(argv + 1, argv + argc);
+    if (!parseOptions(argc, argv)) {
+        return 1;
+    }
+
+    if (!compareReferencePath.empty()) {
+        return compareImages(compareReferencePath, compareCandidatePath) ? 0 : 1;
+    }
+
+    // The suite generates its own scenes, so it needs no input file
+    if (!benchmarkSuitePath.empty()) {
+        selectPacketKernels(requestedSimdLevel);
+        runBenchmarkSuite();
+        return 0;
+    }
+
     if (!validateArguments(argc, argv)) {
         return 1;
     }
@@ -518,13 +695,80 @@ int main(int argc, char **argv)
         cout << "Texture file specified: " << textureFilePath << endl;
     }
     
-    initializeSystem(argv[1], argv[2]);
+    auto loadStartTime = chrono::steady_clock::now();
+    if (!initializeSystem(argv[1], argv[2])) {
+        return 1;
+    }
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - loadStartTime).count();
+    if (renderResolution > 0) {
+        imageWidth = imageHeight = renderResolution;
+    }
+    // Before any render thread starts, workers included, so the kernels are never chosen lazily from several threads
+    selectPacketKernels(requestedSimdLevel);
+    if (workerFd >= 0) {
+        int exitCode = serveCoordinator();
+        cleanup();
+        return exitCode;
+    }
     
     cout << "Scene loaded successfully!" << endl;
+    cout << "Scene load time: " << loadSeconds << " s" << endl;
     cout << "Objects loaded: " << objects.size() << endl;
     cout << "Point lights: " << pointLights.size() << endl;
     cout << "Spot lights: " << spotLights.size() << endl;
-    
+    cout << compiledScene << endl;
+    cout << "Render threads: " << renderThreadCount << endl;
+    cout << "Scalar precision: " << realTypeName() << ", " << simdMathName() << " vector math" << endl;
+    if (allocationChecksEnabled()) {
+        cout << "Allocation checks: on, tracing and shading must not allocate" << endl;
+    }
+
+    if (Object::usesLightSampling()) {
+        cout << lightTree << endl;
+        cout << "Light sampling: " << lightSampleBudget << " of " << lightTree.getLightCount() << " lights per shading point" << endl;
+    } else if (lightSampleBudget > 0) {
+        cout << "Light sampling: off, the scene has no more than " << lightSampleBudget << " lights" << endl;
+    }
+    if (useWavefront) {
+        cout << "Wavefront tracing: one batch per tile, reflections to depth " << recursionLevel << endl;
+        if (usePacketTracing) {
+            cout << "Packet tracing: ignored, the wavefront executor traces its own batches" << endl;
+        }
+    } else if (usePacketTracing) {
+        cout << "Packet tracing: " << PACKET_SIZE << " rays per packet, " << getPacketKernels().name << " kernels" << endl;
+    }
+
+    if (workerCount > 0) {
+        string error;
+        auto startTime = chrono::steady_clock::now();
+        if (!workerPool.start(workerArguments(commandLine), workerCount, error)) {
+            cout << "Workers: " << error << ", rendering locally" << endl;
+        } else {
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+            cout << "Workers: " << workerPool.getWorkerCount() << " processes ready in " << seconds << " s, "
+                 << max(1, renderThreadCount / workerCount) << " threads each" << endl;
+        }
+    }
+
+    if (benchmarkMode) {
+        runBenchmark();
+        cleanup();
+        return 0;
+    }
+
+    if (!cameraPathFilePath.empty()) {
+        renderAnimation();
+        cleanup();
+        return 0;
+    }
+
+    if (renderMode) {
+        renderHeadless();
+        cleanup();
+        return 0;
+    }
+
+#ifndef RENDER_ONLY
     setupGraphics(argc, argv);
     
     cout << "\nPress 'H' for help and controls information." << endl;
@@ -533,147 +777,711 @@ int main(int argc, char **argv)
     
     runMainLoop();
     cleanup();
+#endif
 
     return 0;
 }
 
-// Ray tracing function
-Color traceRay(const Ray& ray) {
+// Ray tracing function; primaryObject, when given, receives the object the ray
+// hits first (nullptr on a miss)
+Color traceRay(const Ray& ray, const Object** primaryObject) {
+    countStat(STAT_PRIMARY_RAYS);
     Color color(0, 0, 0);
-    double minimumDistance = -1;
-    Object* nearestObject = nullptr;
+    if (primaryObject != nullptr) {
+        *primaryObject = nullptr;
+    }
 
-    // Find the nearest intersecting object
-    for (auto object : objects) {
-        double intersectionDistance = object->intersect(const_cast<Ray*>(&ray));
-        if ((intersectionDistance > 0) && (intersectionDistance < minimumDistance || (nearestObject == nullptr))) {
-            minimumDistance = intersectionDistance;
-            nearestObject = object;
+    // Only the part of the ray between the near and far planes can produce a hit
+    double tMin = 0, tMax = numeric_limits<double>::infinity();
+    if (!ray.clipToDepthRange(camera.getPosition(), camera.getLookDirection(), zNear, zFar, tMin, tMax)) {
+        return color;
+    }
+
+    // Find the nearest intersecting object and apply lighting
+    HitRecord hit;
+    bool found;
+    {
+        ScopedPhase phase(PHASE_PRIMARY_VISIBILITY);
+        found = compiledScene.intersect(ray, tMin, tMax, hit);
+    }
+    if (found) {
+        hit.object->phongLighting(ray, hit, &color, 0);
+        if (primaryObject != nullptr) {
+            *primaryObject = hit.object;
         }
     }
 
-    // Check if intersection point is within render distance
-    if (nearestObject != nullptr) {
-        Vector3D intersectionPoint = ray.getOrigin() + (ray.getDirection() * minimumDistance);
-        double distanceAlongLookDirection = (intersectionPoint - camera.getPosition()) * camera.getLookDirection();
+    return color;
+}
+
+// Traces up to PACKET_SIZE coherent primary rays together (lanes set in laneMask).
+// Only visibility runs as a packet; shading and reflections diverge, so each hit
+// continues as a single ray from there.
+void tracePacket(const Ray rays[PACKET_SIZE], int laneMask, Color colors[PACKET_SIZE], const Object* primaryObjects[PACKET_SIZE]) {
+    RayPacket packet;
+    PacketHit hits;
+
+    for (int lane = 0; lane < PACKET_SIZE; lane++) {
+        colors[lane] = Color(0, 0, 0);
+        if (primaryObjects != nullptr) {
+            primaryObjects[lane] = nullptr;
+        }
+        hits.t[lane] = -numeric_limits<double>::infinity();
 
-        if (distanceAlongLookDirection > zFar || distanceAlongLookDirection < zNear) {
-            nearestObject = nullptr;
+        double tMin = 0, tMax = numeric_limits<double>::infinity();
+        if (((laneMask >> lane) & 1) &&
+            rays[lane].clipToDepthRange(camera.getPosition(), camera.getLookDirection(), zNear, zFar, tMin, tMax)) {
+            packet.setRay(lane, rays[lane], tMin);
+            hits.t[lane] = tMax;
         }
     }
+    packet.finalize();
+    countStat(STAT_PRIMARY_RAYS, packet.activeCount());
 
-    // Apply lighting if object found
-    if (nearestObject != nullptr) {
-        nearestObject->phongLighting(const_cast<Ray*>(&ray), &color, 0);
+    {
+        ScopedPhase phase(PHASE_PRIMARY_VISIBILITY);
+        compiledScene.closestHitPacket(packet, hits);
     }
 
-    return color;
+    for (int lane = 0; lane < PACKET_SIZE; lane++) {
+        if (!packet.isActive(lane) || hits.object[lane] == nullptr) {
+            continue;
+        }
+        HitRecord hit;
+        hit.t = hits.t[lane];
+        hit.object = hits.object[lane];
+        hit.object->completeHit(rays[lane], hit);
+        hit.object->phongLighting(rays[lane], hit, &colors[lane], 0);
+        if (primaryObjects != nullptr) {
+            primaryObjects[lane] = hit.object;
+        }
+    }
 }
 
-void capture()
-{
-    cout << "Capturing image..." << endl;
-    bitmap_image image(imageWidth, imageHeight);
-    image.clear();
-
+PrimaryRayGenerator::PrimaryRayGenerator() {
     double planeDistance = (windowHeight / 2.0) / tan(degreeToRadian(fieldOfViewY / 2.0));
-    
-    Vector3D cameraPosition = camera.getPosition();
+
+    cameraPosition = camera.getPosition();
     Vector3D cameraLookDirection = camera.getLookDirection();
-    Vector3D cameraUpDirection = camera.getUpDirection();
-    Vector3D cameraRightDirection = camera.getRightDirection();
+    cameraUpDirection = camera.getUpDirection();
+    cameraRightDirection = camera.getRightDirection();
 
-    Vector3D topLeftCorner = cameraPosition + (cameraLookDirection * planeDistance) + 
-                            (cameraUpDirection * (windowHeight / 2.0)) - 
-                            (cameraRightDirection * (windowWidth / 2.0));
+    topLeftCorner = cameraPosition + (cameraLookDirection * planeDistance) + 
+                    (cameraUpDirection * (windowHeight / 2.0)) - 
+                    (cameraRightDirection * (windowWidth / 2.0));
 
-    double pixelWidth = windowWidth / imageWidth;
-    double pixelHeight = windowHeight / imageHeight;
+    pixelWidth = windowWidth / imageWidth;
+    pixelHeight = windowHeight / imageHeight;
 
     topLeftCorner = topLeftCorner + (cameraRightDirection * pixelWidth * 0.5) - 
-                   (cameraUpDirection * pixelHeight * 0.5);
+                    (cameraUpDirection * pixelHeight * 0.5);
+}
 
-    for (int i = 0; i < imageWidth; i++) {
-        for (int j = 0; j < imageHeight; j++) {
-            Vector3D currentPixel = topLeftCorner + (cameraRightDirection * i * pixelWidth) - 
-                                   (cameraUpDirection * j * pixelHeight);
+Ray PrimaryRayGenerator::operator()(double i, double j) const {
+    Vector3D currentPixel = topLeftCorner + (cameraRightDirection * i * pixelWidth) - 
+                           (cameraUpDirection * j * pixelHeight);
+
+    Vector3D rayDirection = (currentPixel - cameraPosition).normalized();
+    return Ray(cameraPosition, rayDirection);
+}
+
+// Scratch arena space renderWavefrontTile needs for a tile of pixelCount pixels
+size_t wavefrontTileBytes(int pixelCount) {
+    return wavefrontScratchBytes(pixelCount) + pixelCount * (sizeof(Ray) + sizeof(Color) + sizeof(const Object*)) + 4 * alignof(double);
+}
+
+// Traces a whole tile as one wavefront batch; the ray, colour and object
+// arrays come from the thread's scratch arena
+template <class PixelWriter>
+void renderWavefrontTile(const Tile& tile, const PrimaryRayGenerator& primaryRay, PixelWriter& writePixel, AdaptiveSampler* adaptiveSampler) {
+    int width = tile.x1 - tile.x0;
+    int count = width * (tile.y1 - tile.y0);
+    ScratchArena& arena = threadScratchArena();
+    Ray* rays = arena.allocate<Ray>(count);
+    Color* colors = arena.allocate<Color>(count);
+    const Object** primaryObjects = arena.allocate<const Object*>(count);
+
+    for (int k = 0; k < count; k++) {
+        new (&rays[k]) Ray(primaryRay(tile.x0 + k % width, tile.y0 + k / width));
+    }
+    traceWavefront(rays, count, colors, adaptiveSampler != nullptr ? primaryObjects : nullptr);
+
+    for (int k = 0; k < count; k++) {
+        int i = tile.x0 + k % width, j = tile.y0 + k / width;
+        writePixel(i, j, colors[k]);
+        if (adaptiveSampler != nullptr) {
+            adaptiveSampler->setCentreSample(i, j, colors[k], primaryObjects[k]);
+        }
+    }
+}
+
+// Traces the primary rays of one tile and hands every pixel to writePixel, by
+// the scalar, packet or wavefront path. The tile starts with a fresh scratch
+// arena; from there on nothing may allocate. With adaptiveSampler set, each
+// pixel's centre sample is also recorded there for anti-aliasing.
+template <class PixelWriter>
+void renderTilePixels(const Tile& tile, const PrimaryRayGenerator& primaryRay, PixelWriter& writePixel, AdaptiveSampler* adaptiveSampler) {
+    int tilePixels = (tile.x1 - tile.x0) * (tile.y1 - tile.y0);
+    size_t wavefrontBytes = useWavefront ? wavefrontTileBytes(tilePixels) : 0;
+    threadScratchArena().reset(wavefrontBytes);
+    Object::prepareOccluderCache();
+    NoAllocationScope noAllocation;
+    if (useWavefront) {
+        renderWavefrontTile(tile, primaryRay, writePixel, adaptiveSampler);
+        return;
+    }
+    bool antiAliasing = adaptiveSampler != nullptr;
+    if (!usePacketTracing) {
+        for (int j = tile.y0; j < tile.y1; j++) {
+            for (int i = tile.x0; i < tile.x1; i++) {
+                const Object* primaryObject = nullptr;
+                Color pixelColor = traceRay(primaryRay(i, j), antiAliasing ? &primaryObject : nullptr);
+                writePixel(i, j, pixelColor);
+                if (antiAliasing) {
+                    adaptiveSampler->setCentreSample(i, j, pixelColor, primaryObject);
+                }
+            }
+        }
+        return;
+    }
+
+    // 2x2 pixel blocks, one packet each; lanes falling outside the tile stay inactive
+    for (int j = tile.y0; j < tile.y1; j += 2) {
+        for (int i = tile.x0; i < tile.x1; i += 2) {
+            Ray rays[PACKET_SIZE];
+            Color colors[PACKET_SIZE];
+            const Object* primaryObjects[PACKET_SIZE];
+            int laneMask = 0;
+            for (int lane = 0; lane < PACKET_SIZE; lane++) {
+                int x = i + (lane & 1), y = j + (lane >> 1);
+                if (x < tile.x1 && y < tile.y1) {
+                    rays[lane] = primaryRay(x, y);
+                    laneMask |= 1 << lane;
+                }
+            }
+
+            tracePacket(rays, laneMask, colors, antiAliasing ? primaryObjects : nullptr);
+
+            for (int lane = 0; lane < PACKET_SIZE; lane++) {
+                if ((laneMask >> lane) & 1) {
+                    writePixel(i + (lane & 1), j + (lane >> 1), colors[lane]);
+                    if (antiAliasing) {
+                        adaptiveSampler->setCentreSample(i + (lane & 1), j + (lane >> 1), colors[lane], primaryObjects[lane]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Band pixels as RGB bytes, row y0 first, as the worker protocol carries them
+struct RgbBandWriter {
+    unsigned char* rgb;
+    int width, y0;
+
+    void operator()(int i, int j, const Color& pixelColor) const {
+        unsigned char* pixel = &rgb[3 * ((size_t)(j - y0) * width + i)];
+        pixel[0] = (int)round(pixelColor.getRed() * 255);
+        pixel[1] = (int)round(pixelColor.getGreen() * 255);
+        pixel[2] = (int)round(pixelColor.getBlue() * 255);
+    }
+};
+
+// Renders the full width rows [y0, y1) on the render threads and returns the wall time
+template <class PixelWriter>
+double renderBand(int y0, int y1, const PrimaryRayGenerator& primaryRay, PixelWriter& writePixel) {
+    TileScheduler scheduler(imageWidth, y1 - y0, tileSize, renderThreadCount);
+    auto renderTile = [&](const Tile& bandTile) {
+        // The scheduler's tiles are band relative
+        Tile tile = bandTile;
+        tile.y0 += y0;
+        tile.y1 += y0;
+        renderTilePixels(tile, primaryRay, writePixel, nullptr);
+    };
+    auto startTime = chrono::steady_clock::now();
+    scheduler.run(renderTile);
+    assertNoScopedAllocations("a band");
+    return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+}
+
+// Renders the current camera view into image and returns the wall time of the
+// primary pass, whose tile timings stay in scheduler. Only the pixels are
+// written; saving is left to the caller.
+double renderView(bitmap_image& image, TileScheduler& scheduler)
+{
+    PrimaryRayGenerator primaryRay;
+
+    // With anti-aliasing on, the first pass also records what each pixel centre
+    // saw; a second pass then refines only the pixels along edges
+    bool antiAliasing = antiAliasingMaxSamples > 1;
+    AdaptiveSampler adaptiveSampler(antiAliasing ? imageWidth : 0, antiAliasing ? imageHeight : 0,
+                                    antiAliasingMaxSamples, antiAliasingThreshold);
+
+    auto writePixel = [&](int i, int j, const Color& pixelColor) {
+        // Convert to RGB values
+        int red = round(pixelColor.getRed() * 255);
+        int green = round(pixelColor.getGreen() * 255);
+        int blue = round(pixelColor.getBlue() * 255);
+        
+        image.set_pixel(i, j, red, green, blue);
+    };
+
+    // Tiles cover disjoint pixel ranges, so workers write into the image without locking
+    auto renderTile = [&](const Tile& tile) {
+        renderTilePixels(tile, primaryRay, writePixel, antiAliasing ? &adaptiveSampler : nullptr);
+    };
+
+    auto startTime = chrono::steady_clock::now();
+    scheduler.run(renderTile);
+    double renderSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    // Refinement needs every centre sample, so it only starts once the first pass is done
+    if (antiAliasing) {
+        PixelSampler sampler = [&](double x, double y) {
+            return traceRay(primaryRay(x, y));
+        };
+        auto refineTile = [&](const Tile& tile) {
+            threadScratchArena().reset();
+            Object::prepareOccluderCache();
+            NoAllocationScope noAllocation;
+            for (int j = tile.y0; j < tile.y1; j++) {
+                for (int i = tile.x0; i < tile.x1; i++) {
+                    if (adaptiveSampler.needsRefinement(i, j)) {
+                        writePixel(i, j, adaptiveSampler.refine(i, j, sampler));
+                    }
+                }
+            }
+        };
+
+        TileScheduler refineScheduler(imageWidth, imageHeight, tileSize, renderThreadCount);
+        auto refineStartTime = chrono::steady_clock::now();
+        refineScheduler.run(refineTile);
+        double refineSeconds = chrono::duration<double>(chrono::steady_clock::now() - refineStartTime).count();
+
+        cout << "Anti-aliasing: " << adaptiveSampler.getRefinedPixelCount() << " of " << (int)(imageWidth * imageHeight)
+             << " pixels refined in " << refineSeconds << " s, " << adaptiveSampler.getAverageSamplesPerPixel()
+             << " samples per pixel on average (cap " << antiAliasingMaxSamples << ")" << endl;
+    }
+
+    assertNoScopedAllocations("a frame");
+    return renderSeconds;
+}
+
+// Everything besides the image size that decides a tiled render's pixels, for
+// its progress file: the scene text, the exact camera, and the options that
+// can change shading. Mesh files and the texture's pixels are named by path only.
+string tiledRenderKey() {
+    ostringstream key;
+    key << hex << "scene " << sceneTextHash << dec << setprecision(17);
+    Vector3D vectors[4] = {camera.getPosition(), camera.getLookDirection(), camera.getUpDirection(), camera.getRightDirection()};
+    key << " camera";
+    for (const Vector3D& vector : vectors) {
+        key << " " << (double)vector.x << " " << (double)vector.y << " " << (double)vector.z;
+    }
+    key << " aa " << antiAliasingMaxSamples << " " << antiAliasingThreshold << " light-samples " << lightSampleBudget
+        << " texture-filter " << textureFilter << " texture " << textureFilePath.size() << ":" << textureFilePath
+        << " executor " << (useWavefront ? "wavefront" : usePacketTracing ? "packets" : "scalar") << " precision " << realTypeName();
+    return key.str();
+}
+
+// capture() for images too large to hold: the frame is rendered one band of
+// tile rows at a time, each written into the BMP file as soon as it is done,
+// so memory is bounded by one band whatever the resolution. With --resume,
+// bands a crashed render already wrote are kept and only the rest are traced.
+void captureTiled(const string& filename)
+{
+    int width = imageWidth, height = imageHeight;
+    // Depends only on the image and tile size, so a resumed render may use any number of threads
+    int tilesAcross = (width + tileSize - 1) / tileSize;
+    int bandTileRows = max(1, (Config::TILED_OUTPUT_BAND_TILES + tilesAcross - 1) / tilesAcross);
+
+    TiledBmpWriter writer;
+    string error;
+    if (!writer.open(filename, width, height, bandTileRows * tileSize, tiledRenderKey(), resumeTiledOutput, error)) {
+        cout << "Error: " << error << endl;
+        return;
+    }
+    int bandCount = writer.getBandCount();
+    if (writer.getDoneCount() > 0) {
+        cout << "Resuming: " << writer.getDoneCount() << " of " << bandCount << " bands already written" << endl;
+    } else if (resumeTiledOutput) {
+        cout << "Resuming: no progress file for " << filename << ", rendering every band" << endl;
+    }
+
+    PrimaryRayGenerator primaryRay;
+    auto writePixel = [&](int i, int j, const Color& pixelColor) {
+        int red = round(pixelColor.getRed() * 255);
+        int green = round(pixelColor.getGreen() * 255);
+        int blue = round(pixelColor.getBlue() * 255);
+
+        writer.setPixel(i, j, red, green, blue);
+    };
+
+    resetRenderStats();
+    double renderSeconds = 0;
+    int bandsRendered = 0, reportedTenths = 0;
+    for (int band = 0; band < bandCount; band++) {
+        if (writer.isBandDone(band)) {
+            continue;
+        }
+        writer.beginBand(band);
+        renderSeconds += renderBand(writer.getBandY0(), writer.getBandY1(), primaryRay, writePixel);
+
+        if (!writer.writeBand(error)) {
+            cout << "Error: " << error << endl;
+            return;
+        }
+        bandsRendered++;
+        int tenths = 10 * writer.getDoneCount() / bandCount;
+        if (tenths > reportedTenths) {
+            reportedTenths = tenths;
+            cout << "Written " << writer.getDoneCount() << " of " << bandCount << " bands (" << 10 * tenths << "%)" << endl;
+        }
+    }
+    RenderStats stats = collectRenderStats();
 
-            Vector3D rayDirection = (currentPixel - cameraPosition).normalized();
-            Ray ray(cameraPosition, rayDirection);
+    if (!writer.finish(error)) {
+        cout << "Error: " << error << endl;
+        return;
+    }
+    cout << "Image saved as: " << filename << endl;
+    cout << "Render time: " << renderSeconds << " s for " << bandsRendered << " bands of " << writer.getBandHeight()
+         << " rows" << endl;
+    cout << stats << endl;
+}
+
+// renderView() spread over the worker processes, one row of tiles per band;
+// returns the wall time
+double renderOnWorkers(bitmap_image& image)
+{
+    FrameSetup frame;
+    frame.width = imageWidth;
+    frame.height = imageHeight;
+    Vector3D vectors[4] = {camera.getPosition(), camera.getLookDirection(), camera.getUpDirection(), camera.getRightDirection()};
+    double* fields[4] = {frame.position, frame.look, frame.up, frame.right};
+    for (int k = 0; k < 4; k++) {
+        fields[k][0] = vectors[k].x;
+        fields[k][1] = vectors[k].y;
+        fields[k][2] = vectors[k].z;
+    }
 
-            Color pixelColor = traceRay(ray);
-            
-            // Convert to RGB values
-            int red = round(pixelColor.getRed() * 255);
-            int green = round(pixelColor.getGreen() * 255);
-            int blue = round(pixelColor.getBlue() * 255);
-            
-            image.set_pixel(i, j, red, green, blue);
+    PrimaryRayGenerator primaryRay;
+    auto store = [&](int y0, int y1, const unsigned char* rgb) {
+        for (int j = y0; j < y1; j++) {
+            for (int i = 0; i < frame.width; i++) {
+                const unsigned char* pixel = &rgb[3 * ((size_t)(j - y0) * frame.width + i)];
+                image.set_pixel(i, j, pixel[0], pixel[1], pixel[2]);
+            }
         }
+    };
+    auto renderLocally = [&](int y0, int y1, unsigned char* rgb) {
+        RgbBandWriter writePixel = {rgb, frame.width, y0};
+        renderBand(y0, y1, primaryRay, writePixel);
+    };
+
+    auto startTime = chrono::steady_clock::now();
+    workerPool.render(frame, tileSize, store, renderLocally);
+    return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+}
+
+// Main loop of a process started by --workers: renders the bands the
+// coordinator asks for, with the coordinator's view
+int serveCoordinator()
+{
+    auto setFrame = [](const FrameSetup& frame) {
+        imageWidth = frame.width;
+        imageHeight = frame.height;
+        camera.setPosition(Vector3D(frame.position[0], frame.position[1], frame.position[2]));
+        camera.setBasis(Vector3D(frame.look[0], frame.look[1], frame.look[2]), Vector3D(frame.up[0], frame.up[1], frame.up[2]),
+                        Vector3D(frame.right[0], frame.right[1], frame.right[2]));
+    };
+    auto renderWorkerBand = [](int y0, int y1, unsigned char* rgb) {
+        PrimaryRayGenerator primaryRay;
+        RgbBandWriter writePixel = {rgb, (int)imageWidth, y0};
+        renderBand(y0, y1, primaryRay, writePixel);
+    };
+    return serveWorker(workerFd, setFrame, renderWorkerBand);
+}
+
+void capture()
+{
+    cout << "Capturing image..." << endl;
+    if (tiledOutput) {
+        captureCount++;
+        captureTiled(renderOutputPath.empty() ? outputFileDirectory + "/saved_image-" + to_string(captureCount) + ".bmp" : renderOutputPath);
+        return;
     }
+    bitmap_image image(imageWidth, imageHeight);
+    image.clear();
+
+    TileScheduler scheduler(imageWidth, imageHeight, tileSize, renderThreadCount);
+    resetRenderStats();
+    bool distributed = workerPool.getWorkerCount() > 0;
+    double renderSeconds = distributed ? renderOnWorkers(image) : renderView(image, scheduler);
+    RenderStats stats = collectRenderStats();
 
     captureCount++;
-    string filename = outputFileDirectory + "/saved_image-" + to_string(captureCount) + ".bmp";
+    string filename = renderOutputPath.empty() ? outputFileDirectory + "/saved_image-" + to_string(captureCount) + ".bmp" : renderOutputPath;
     image.save_image(filename);
     cout << "Image saved as: " << filename << endl;
+
+    cout << "Render time: " << renderSeconds << " s" << endl;
+    // Tiles traced by the workers are timed, and counted, in their processes
+    if (distributed) {
+        return;
+    }
+    scheduler.printTimingSummary(cout);
+    string timingFilename = outputFileDirectory + "/tile_timings-" + to_string(captureCount) + ".csv";
+    scheduler.saveTimings(timingFilename);
+    cout << "Tile timings saved as: " << timingFilename << endl;
+    cout << stats << endl;
 }
 
-// Helper functions for enhanced controls
-void adjustMovementSpeed(bool increase) {
-    if (increase) {
-        cameraMovementSpeed = min(cameraMovementSpeed + 1.0, 20.0);
-        cout << "Movement speed increased to: " << cameraMovementSpeed << endl;
-    } else {
-        cameraMovementSpeed = max(cameraMovementSpeed - 1.0, 1.0);
-        cout << "Movement speed decreased to: " << cameraMovementSpeed << endl;
+// Starts a background render of the current view for the viewer; the image is
+// saved like capture()'s once every pass has finished
+void startProgressiveCapture() {
+    PrimaryRayGenerator primaryRay;
+    auto sampler = [primaryRay](double x, double y) {
+        return traceRay(primaryRay(x, y));
+    };
+    auto saveFrame = [](const vector<unsigned char>& rgb) {
+        bitmap_image image(imageWidth, imageHeight);
+        for (int j = 0; j < imageHeight; j++) {
+            for (int i = 0; i < imageWidth; i++) {
+                const unsigned char* pixel = &rgb[3 * (j * (int)imageWidth + i)];
+                image.set_pixel(i, j, pixel[0], pixel[1], pixel[2]);
+            }
+        }
+        captureCount++;
+        string filename = outputFileDirectory + "/saved_image-" + to_string(captureCount) + ".bmp";
+        image.save_image(filename);
+        cout << "Image saved as: " << filename << endl;
+    };
+
+    progressiveRenderer.start(imageWidth, imageHeight, tileSize, renderThreadCount, progressiveExtraSamples, sampler, saveFrame);
+    cout << "Rendering in the background: " << progressiveRenderer.getPassCount() << " passes, press 'x' to cancel" << endl;
+}
+
+// Renders one frame without a window, for machines with no display. The view is
+// the initial camera unless --camera gave another one.
+void renderHeadless() {
+    camera.setPosition(initialCameraPosition);
+    camera.setLookDirection(initialCameraLook);
+    camera.setUpDirection(initialCameraUp);
+    if (renderCameraOverride) {
+        camera = Camera(renderCameraPosition, renderCameraLook, renderCameraUp);
     }
-    camera.setMovementSpeed(cameraMovementSpeed);
+    cout << camera;
+
+    capture();
 }
 
-void adjustRotationSpeed(bool increase) {
-    if (increase) {
-        cameraRotationSpeed = min(cameraRotationSpeed + 2.0, 30.0);
-        cout << "Rotation speed increased to: " << cameraRotationSpeed << endl;
-    } else {
-        cameraRotationSpeed = max(cameraRotationSpeed - 2.0, 2.0);
-        cout << "Rotation speed decreased to: " << cameraRotationSpeed << endl;
-    }
-    camera.setRotationSpeed(cameraRotationSpeed);
-}
-
-// Display help information
-void displayHelp() {
-    cout << "\n=== RAY TRACING CONTROLS ===" << endl;
-    cout << "CAMERA MOVEMENT:" << endl;
-    cout << "  Arrow Keys    - Move Forward/Back/Left/Right" << endl;
-    cout << "  Page Up/Down  - Move Up/Down" << endl;
-    cout << "\nCAMERA ROTATION:" << endl;
-    cout << "  1/2           - Look Left/Right" << endl;
-    cout << "  3/4           - Look Up/Down" << endl;
-    cout << "  5/6           - Tilt Counter-clockwise/Clockwise" << endl;
-    cout << "\nSPEED CONTROLS:" << endl;
-    cout << "  +/-           - Increase/Decrease Movement Speed" << endl;
-    cout << "  [/]           - Increase/Decrease Rotation Speed" << endl;
-    cout << "\nINFORMATION:" << endl;
-    cout << "  i             - Display Camera Information" << endl;
-    cout << "  h             - Display This Help" << endl;
-    cout << "\nRENDERING:" << endl;
-    cout << "  0             - Capture/Render Image" << endl;
-    cout << "  q             - Quit Application" << endl;
-    cout << "===========================\n" << endl;
-}
-
-// Display current camera information
-void displayCameraInfo() {
-    Vector3D pos = camera.getPosition();
-    Vector3D look = camera.getLookDirection();
-    Vector3D up = camera.getUpDirection();
-    
-    cout << "\n=== CAMERA INFO ===" << endl;
-    cout << "Position: (" << pos.x << ", " << pos.y << ", " << pos.z << ")" << endl;
-    cout << "Look Direction: (" << look.x << ", " << look.y << ", " << look.z << ")" << endl;
-    cout << "Up Direction: (" << up.x << ", " << up.y << ", " << up.z << ")" << endl;
-    cout << "Movement Speed: " << cameraMovementSpeed << endl;
-    cout << "Rotation Speed: " << cameraRotationSpeed << endl;
-    cout << "==================\n" << endl;
-}
\ No newline at end of file
+// Renders every frame of the --camera-path fly-through into the output directory
+// as frame-NNNN.bmp. The scene and its acceleration structure are built once and
+// shared by all frames, and each finished frame is saved on the writer thread
+// while the next one renders.
+void renderAnimation() {
+    CameraPath path;
+    string error;
+    if (!path.load(cameraPathFilePath, error)) {
+        cout << "Camera path error: " << error << endl;
+        return;
+    }
+
+    int firstFrame = path.getFirstFrame(), lastFrame = path.getLastFrame();
+    cout << "Camera path: " << path.getKeyframeCount() << " keyframes, frames " << firstFrame << " to " << lastFrame << endl;
+
+    FrameWriter writer(Config::FRAME_WRITER_QUEUE);
+    double renderSeconds = 0;
+    resetRenderStats();
+    auto startTime = chrono::steady_clock::now();
+    for (int frame = firstFrame; frame <= lastFrame; frame++) {
+        camera = path.cameraAt(frame);
+
+        unique_ptr<bitmap_image> image(new bitmap_image(imageWidth, imageHeight));
+        image->clear();
+        TileScheduler scheduler(imageWidth, imageHeight, tileSize, renderThreadCount);
+        double seconds = renderView(*image, scheduler);
+        renderSeconds += seconds;
+
+        char name[32];
+        snprintf(name, sizeof(name), "/frame-%04d.bmp", frame);
+        writer.submit(move(image), outputFileDirectory + name);
+        cout << "Frame " << frame << ": " << seconds << " s" << endl;
+    }
+    writer.finish();
+    double totalSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    int frameCount = lastFrame - firstFrame + 1;
+    cout << "Frames written: " << writer.getFramesWritten() << " to " << outputFileDirectory << endl;
+    cout << "Animation time: " << totalSeconds << " s (" << totalSeconds / frameCount << " s per frame)" << endl;
+    cout << "Primary pass time: " << renderSeconds << " s" << endl;
+    cout << "Image write time: " << writer.getWriteSeconds() << " s on the writer thread, renderer blocked "
+         << writer.getBlockedSeconds() << " s" << endl;
+    cout << collectRenderStats() << endl;
+}
+
+// Closest-hit throughput of the initial view's primary rays. The first row is a
+// plain virtual intersect() loop over every object, which is how hits were found
+// before the scene was compiled; the others query the compiled representations.
+void runBenchmark() {
+    camera.setPosition(initialCameraPosition);
+    camera.setLookDirection(initialCameraLook);
+    camera.setUpDirection(initialCameraUp);
+
+    PrimaryRayGenerator primaryRay;
+    RayBatch batch;
+    for (int j = 0; j < imageHeight; j++) {
+        for (int i = 0; i < imageWidth; i++) {
+            Ray ray = primaryRay(i, j);
+            double tMin = 0, tMax = numeric_limits<double>::infinity();
+            if (ray.clipToDepthRange(camera.getPosition(), camera.getLookDirection(), zNear, zFar, tMin, tMax)) {
+                batch.add(ray, tMin, tMax);
+            }
+        }
+    }
+
+    CompiledScene flatScene, bvhScene;
+    flatScene.compile(objects, ACCELERATION_FLAT);
+    bvhScene.compile(objects, ACCELERATION_BVH);
+
+    vector<BenchmarkResult> results;
+    results.push_back(benchmarkClosestHit("virtual object list", batch, [](const Ray& ray, double tMin, double tMax, HitRecord& hit) {
+        hit.t = tMax;
+        hit.object = nullptr;
+        for (Object* object : objects) {
+            object->intersect(ray, tMin, hit.t, hit);
+        }
+        return hit.object != nullptr;
+    }, Config::BENCHMARK_PASSES));
+
+    auto flatQuery = [&](const Ray& ray, double tMin, double tMax, HitRecord& hit) {
+        return flatScene.closestHit(ray, tMin, tMax, hit);
+    };
+    selectPacketKernels(SIMD_SCALAR);
+    results.push_back(benchmarkClosestHit("flat typed, scalar kernels", batch, flatQuery, Config::BENCHMARK_PASSES));
+    selectPacketKernels(requestedSimdLevel);
+    if (&getPacketKernels() != scalarPacketKernels()) {
+        string name = string("flat typed, ") + getPacketKernels().name + " kernels";
+        results.push_back(benchmarkClosestHit(name, batch, flatQuery, Config::BENCHMARK_PASSES));
+    }
+
+    results.push_back(benchmarkClosestHit("bvh typed leaves", batch, [&](const Ray& ray, double tMin, double tMax, HitRecord& hit) {
+        return bvhScene.closestHit(ray, tMin, tMax, hit);
+    }, Config::BENCHMARK_PASSES));
+
+    cout << "Benchmark: " << batch.size() << " primary rays x " << Config::BENCHMARK_PASSES << " passes" << endl;
+#ifndef __OPTIMIZE__
+    cout << "Warning: built without optimization, so these timings say little about real throughput" << endl;
+#endif
+    printBenchmarkTable(cout, results);
+}
+
+// Renders one generated scene from the initial view, replacing whatever scene
+// was loaded before
+RenderBenchmarkResult runRenderBenchmark(const SceneSpec& spec, AccelerationMode mode) {
+    freeMemory();
+    Object::clearOccluderCache();
+
+    recursionLevel = spec.recursionLevel;
+    windowWidth = windowHeight = spec.imageSize;
+    imageWidth = imageHeight = spec.imageSize;
+
+    RenderBenchmarkResult result;
+    result.scene = spec.name;
+    result.acceleration = mode == ACCELERATION_BVH ? "bvh" : "flat";
+
+    auto startTime = chrono::steady_clock::now();
+    initializeFloor();
+    generateScene(spec, objects, pointLights, spotLights);
+    result.generateSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    startTime = chrono::steady_clock::now();
+    compiledScene.compile(objects, mode);
+    lightTree.build(pointLights, spotLights);
+    result.buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    camera = Camera(initialCameraPosition, initialCameraLook, initialCameraUp);
+    bitmap_image image(imageWidth, imageHeight);
+    image.clear();
+    TileScheduler scheduler(imageWidth, imageHeight, tileSize, renderThreadCount);
+    resetRenderStats();
+    startTime = chrono::steady_clock::now();
+    renderView(image, scheduler);
+    result.renderSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    result.stats = collectRenderStats();
+
+    result.objects = objects.size();
+    result.pointLights = pointLights.size();
+    result.spotLights = spotLights.size();
+    result.recursionLevel = spec.recursionLevel;
+    result.width = imageWidth;
+    result.height = imageHeight;
+    return result;
+}
+
+// Full capture()-equivalent renders of every generated benchmark scene, once per
+// acceleration structure, written to --benchmark-suite as JSON
+void runBenchmarkSuite() {
+#ifdef __OPTIMIZE__
+    bool optimized = true;
+#else
+    bool optimized = false;
+    cout << "Warning: built without optimization, so these timings say little about real throughput" << endl;
+#endif
+
+    vector<RenderBenchmarkResult> results;
+    for (const SceneSpec& spec : benchmarkSceneSpecs()) {
+        for (AccelerationMode mode : {ACCELERATION_BVH, ACCELERATION_FLAT}) {
+            results.push_back(runRenderBenchmark(spec, mode));
+            cout << "Rendered " << spec.name << " (" << results.back().acceleration << ") in "
+                 << results.back().renderSeconds << " s" << endl;
+        }
+    }
+    freeMemory();
+
+    printRenderBenchmarkTable(cout, results);
+    ofstream out(benchmarkSuitePath);
+    writeRenderBenchmarkJson(out, results, optimized, renderThreadCount, getPacketKernels().name, lightSampleBudget);
+    cout << "Benchmark results saved as: " << benchmarkSuitePath << endl;
+}
+
+// Reports how far candidate is from reference, e.g. a float build's render
+// against the double build's. Fails when either file is missing, the sizes differ,
+// or the images differ and the PSNR is below --min-psnr.
+bool compareImages(const string& referencePath, const string& candidatePath) {
+    bitmap_image reference(referencePath), candidate(candidatePath);
+    if (!reference || !candidate) {
+        cout << "Cannot compare: failed to load " << (!reference ? referencePath : candidatePath) << endl;
+        return false;
+    }
+    if (reference.width() != candidate.width() || reference.height() != candidate.height()) {
+        cout << "Cannot compare: " << referencePath << " is " << reference.width() << "x" << reference.height() << ", "
+             << candidatePath << " is " << candidate.width() << "x" << candidate.height() << endl;
+        return false;
+    }
+
+    int differentPixels = 0, maxDifference = 0;
+    for (unsigned int y = 0; y < reference.height(); y++) {
+        for (unsigned int x = 0; x < reference.width(); x++) {
+            rgb_t a = reference.get_pixel(x, y), b = candidate.get_pixel(x, y);
+            int difference = max(abs(a.red - b.red), max(abs(a.green - b.green), abs(a.blue - b.blue)));
+            differentPixels += difference > 0;
+            maxDifference = max(maxDifference, difference);
+        }
+    }
+
+    double psnr = reference.psnr(candidate);
+    cout << "Compared " << candidatePath << " with " << referencePath << ": ";
+    if (differentPixels == 0) {
+        cout << "identical" << endl;
+        return true;
+    }
+    cout << "PSNR " << psnr << " dB, " << differentPixels << " of " << reference.width() * reference.height()
+         << " pixels differ, largest channel difference " << maxDifference << endl;
+    if (compareMinimumPsnr >= 0 && psnr < compareMinimumPsnr) {
+        cout << "Failed: PSNR is below the " << compareMinimumPsnr << " dB floor" << endl;
+        return false;
+    }
+    return true;
+}
@@ -13,8 +13,12 @@ using namespace std;
 #include "header/Sphere/2005107_Sphere.h"
 #include "header/Triangle/2005107_Triangle.h"
 #include "header/General/2005107_General.h"
+#include "header/TriangleMesh/2005107_TriangleMesh.h"
 #include "header/PointLight/2005107_PointLight.h"
 #include "header/SpotLight/2005107_SpotLight.h"
+#include "header/CompiledScene/2005107_CompiledScene.h"
+#include "header/Camera/2005107_Camera.h"
+#include "header/ProgressiveRenderer/2005107_ProgressiveRenderer.h"
 
 extern double epsilon;
 extern double recursionLevel;
@@ -22,6 +26,7 @@ extern double fieldOfViewY, zNear, zFar;
 extern vector<Object *> objects;
 extern vector<PointLight *> pointLights;
 extern vector<SpotLight *> spotLights;
+extern CompiledScene compiledScene;
 
 extern double cameraMovementSpeed;
 extern double cameraRotationSpeed;
@@ -29,3 +34,14 @@ extern double cameraRotationSpeed;
 extern Vector3D initialCameraPosition;
 extern Vector3D initialCameraUp;
 extern Vector3D initialCameraLook;
+
+extern Camera camera;
+extern ProgressiveRenderer progressiveRenderer;
+extern double windowWidth, windowHeight;
+extern double windowPositionX, windowPositionY;
+
+// Ray traces the camera's current view and saves it
+void capture();
+
+// Renders the camera's current view in the background, refining it pass by pass
+void startProgressiveCapture();
@@ -0,0 +1,376 @@
+#include <bits/stdc++.h>
+using namespace std;
+#include "2005107_main.hpp"
+#include "2005107_viewer.hpp"
+
+#ifdef __linux__
+#include <GL/glut.h>
+#elif WIN32
+#include <glut.h>
+#include <windows.h>
+#endif
+
+// Progressive render preview, drawn over the scene while visible
+GLuint previewTexture = 0;
+int previewTextureWidth = 0, previewTextureHeight = 0;
+vector<unsigned char> previewPixels;
+bool previewVisible = false;
+
+// Forward declarations
+void hidePreview();
+void adjustMovementSpeed(bool increase);
+void adjustRotationSpeed(bool increase);
+void displayCameraInfo();
+void displayHelp();
+
+void init()
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Set background color to black and opaque
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+
+    GLdouble aspectRatio = (GLdouble)windowWidth / (GLdouble)windowHeight;
+    gluPerspective(fieldOfViewY, aspectRatio, zNear, zFar);
+    glMatrixMode(GL_MODELVIEW);
+
+    // Initialize camera with the original camera values
+    camera.setPosition(initialCameraPosition);
+    camera.setLookDirection(initialCameraLook);
+    camera.setUpDirection(initialCameraUp);
+    camera.setMovementSpeed(cameraMovementSpeed);
+    camera.setRotationSpeed(cameraRotationSpeed);
+}
+
+void drawObjects()
+{
+    for (int i = 0; i < objects.size(); i++)
+    {
+        objects[i]->draw();
+    }
+}
+
+void drawLights()
+{
+    for (int i = 0; i < pointLights.size(); i++)
+    {
+        pointLights[i]->draw();
+    }
+    for (int i = 0; i < spotLights.size(); i++)
+    {
+        spotLights[i]->draw();
+    }
+}
+
+// Stretches the progressive render over the whole window, uploading whatever
+// the render thread has finished since the last frame
+void drawPreview()
+{
+    int width = progressiveRenderer.getWidth();
+    int height = progressiveRenderer.getHeight();
+
+    if (previewTexture == 0) {
+        glGenTextures(1, &previewTexture);
+    }
+    glBindTexture(GL_TEXTURE_2D, previewTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    bool resized = width != previewTextureWidth || height != previewTextureHeight;
+    if (resized) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        previewTextureWidth = width;
+        previewTextureHeight = height;
+    }
+    if (progressiveRenderer.takePreview(previewPixels) || resized) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, previewPixels.data());
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, 1, 0, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glColor3f(1, 1, 1);
+    // Image row 0 is the top of the picture but the bottom row of the texture
+    glBegin(GL_QUADS);
+    {
+        glTexCoord2f(0, 1); glVertex2f(0, 0);
+        glTexCoord2f(1, 1); glVertex2f(1, 0);
+        glTexCoord2f(1, 0); glVertex2f(1, 1);
+        glTexCoord2f(0, 0); glVertex2f(0, 1);
+    }
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_DEPTH_TEST);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+// Stops any background render and goes back to the OpenGL view; the
+// ray traced image no longer matches once the camera moves
+void hidePreview()
+{
+    progressiveRenderer.cancel();
+    previewVisible = false;
+}
+
+void display()
+{
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    camera.applyLookAt();
+
+    drawObjects();
+    drawLights();
+
+    if (previewVisible) {
+        drawPreview();
+    }
+
+    glutSwapBuffers();
+}
+
+void reshape(int width, int height)
+{
+    if (height == 0) height = 1; // Prevent divide by zero
+
+    GLfloat aspectRatio = (GLfloat)width / (GLfloat)height;
+    glViewport(0, 0, width, height);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(fieldOfViewY, aspectRatio, zNear, zFar);
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+}
+
+void keyboardListener(unsigned char key, int x, int y)
+{
+    if (strchr("123456rR", key) != nullptr) {
+        hidePreview();
+    }
+
+    switch (key)
+    {
+    // Capture image
+    case '0':
+        startProgressiveCapture();
+        previewVisible = true;
+        break;
+    case 'x':
+    case 'X':
+        if (progressiveRenderer.isRunning()) {
+            progressiveRenderer.cancel();
+        } else {
+            previewVisible = false;
+        }
+        break;
+        
+    // Rotation controls
+    case '1':
+        camera.lookLeft();
+        cout << "Looking left" << endl;
+        break;
+    case '2':
+        camera.lookRight();
+        cout << "Looking right" << endl;
+        break;
+    case '3':
+        camera.lookUp();
+        cout << "Looking up" << endl;
+        break;
+    case '4':
+        camera.lookDown();
+        cout << "Looking down" << endl;
+        break;
+    case '5':
+        camera.tiltCounterClockwise();
+        cout << "Tilting counter-clockwise" << endl;
+        break;
+    case '6':
+        camera.tiltClockwise();
+        cout << "Tilting clockwise" << endl;
+        break;
+        
+    // Speed controls
+    case 'w':
+    case 'W':
+        adjustMovementSpeed(true);
+        break;
+    case 's':
+    case 'S':
+        adjustMovementSpeed(false);
+        break;
+    case 'a':
+    case 'A':
+        adjustRotationSpeed(true);
+        break;
+    case 'd':
+    case 'D':
+        adjustRotationSpeed(false);
+        break;
+        
+    // Camera actions
+    case 'r':
+    case 'R':
+        camera.reset();
+        cout << "Camera reset to initial position" << endl;
+        break;
+    case 'c':
+    case 'C':
+        displayCameraInfo();
+        break;
+        
+    // Help and quit
+    case 'h':
+    case 'H':
+        displayHelp();
+        break;
+    case 'q':
+    case 'Q':
+        cout << "Exiting program..." << endl;
+        exit(0);
+        break;
+        
+    default:
+        cout << "Unknown key: '" << key << "' - Press 'H' for help" << endl;
+        break;
+    }
+}
+
+void keyboardSpecialListener(int key, int x, int y)
+{
+    hidePreview();
+
+    switch (key)
+    {
+    case GLUT_KEY_UP:
+        camera.moveForward();
+        cout << "Moving forward" << endl;
+        break;
+    case GLUT_KEY_DOWN:
+        camera.moveBackward();
+        cout << "Moving backward" << endl;
+        break;
+    case GLUT_KEY_RIGHT:
+        camera.moveRight();
+        cout << "Moving right" << endl;
+        break;
+    case GLUT_KEY_LEFT:
+        camera.moveLeft();
+        cout << "Moving left" << endl;
+        break;
+    case GLUT_KEY_PAGE_UP:
+        camera.moveUp();
+        cout << "Moving up" << endl;
+        break;
+    case GLUT_KEY_PAGE_DOWN:
+        camera.moveDown();
+        cout << "Moving down" << endl;
+        break;
+    default:
+        cout << "Unknown special key - Press 'H' for help" << endl;
+        break;
+    }
+}
+
+void idle()
+{
+    glutPostRedisplay();
+}
+
+void setupGraphics(int argc, char** argv) {
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(768, 768);
+    glutInitWindowPosition(windowPositionX, windowPositionY);
+    glutCreateWindow("Ray Tracing");
+    
+    glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
+    glutKeyboardFunc(keyboardListener);
+    glutSpecialFunc(keyboardSpecialListener);
+    glutIdleFunc(idle);
+    
+    init();
+}
+
+void runMainLoop() {
+    glutMainLoop();
+}
+
+// Helper functions for enhanced controls
+void adjustMovementSpeed(bool increase) {
+    if (increase) {
+        cameraMovementSpeed = min(cameraMovementSpeed + 1.0, 20.0);
+        cout << "Movement speed increased to: " << cameraMovementSpeed << endl;
+    } else {
+        cameraMovementSpeed = max(cameraMovementSpeed - 1.0, 1.0);
+        cout << "Movement speed decreased to: " << cameraMovementSpeed << endl;
+    }
+    camera.setMovementSpeed(cameraMovementSpeed);
+}
+
+void adjustRotationSpeed(bool increase) {
+    if (increase) {
+        cameraRotationSpeed = min(cameraRotationSpeed + 2.0, 30.0);
+        cout << "Rotation speed increased to: " << cameraRotationSpeed << endl;
+    } else {
+        cameraRotationSpeed = max(cameraRotationSpeed - 2.0, 2.0);
+        cout << "Rotation speed decreased to: " << cameraRotationSpeed << endl;
+    }
+    camera.setRotationSpeed(cameraRotationSpeed);
+}
+
+// Display help information
+void displayHelp() {
+    cout << "\n=== RAY TRACING CONTROLS ===" << endl;
+    cout << "CAMERA MOVEMENT:" << endl;
+    cout << "  Arrow Keys    - Move Forward/Back/Left/Right" << endl;
+    cout << "  Page Up/Down  - Move Up/Down" << endl;
+    cout << "\nCAMERA ROTATION:" << endl;
+    cout << "  1/2           - Look Left/Right" << endl;
+    cout << "  3/4           - Look Up/Down" << endl;
+    cout << "  5/6           - Tilt Counter-clockwise/Clockwise" << endl;
+    cout << "\nSPEED CONTROLS:" << endl;
+    cout << "  +/-           - Increase/Decrease Movement Speed" << endl;
+    cout << "  [/]           - Increase/Decrease Rotation Speed" << endl;
+    cout << "\nINFORMATION:" << endl;
+    cout << "  i             - Display Camera Information" << endl;
+    cout << "  h             - Display This Help" << endl;
+    cout << "\nRENDERING:" << endl;
+    cout << "  0             - Render Image (progressive preview, saved when done)" << endl;
+    cout << "  x             - Cancel Render / Hide Preview" << endl;
+    cout << "  q             - Quit Application" << endl;
+    cout << "===========================\n" << endl;
+}
+
+// Display current camera information
+void displayCameraInfo() {
+    Vector3D pos = camera.getPosition();
+    Vector3D look = camera.getLookDirection();
+    Vector3D up = camera.getUpDirection();
+    
+    cout << "\n=== CAMERA INFO ===" << endl;
+    cout << "Position: (" << pos.x << ", " << pos.y << ", " << pos.z << ")" << endl;
+    cout << "Look Direction: (" << look.x << ", " << look.y << ", " << look.z << ")" << endl;
+    cout << "Up Direction: (" << up.x << ", " << up.y << ", " << up.z << ")" << endl;
+    cout << "Movement Speed: " << cameraMovementSpeed << endl;
+    cout << "Rotation Speed: " << cameraRotationSpeed << endl;
+    cout << "==================\n" << endl;
+}
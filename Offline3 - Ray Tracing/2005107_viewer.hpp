@@ -0,0 +1,6 @@
+#pragma once
+
+// Interactive OpenGL/GLUT preview of the scene; pressing '0' ray traces the
+// current view with capture(). Render-only builds leave this out entirely.
+void setupGraphics(int argc, char** argv);
+void runMainLoop();
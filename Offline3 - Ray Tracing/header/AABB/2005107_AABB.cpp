@@ -0,0 +1,110 @@
+#include "2005107_AABB.h"
+#include <algorithm>
+#include <limits>
+
+AABB::AABB()
+    : minimum(numeric_limits<double>::infinity(), numeric_limits<double>::infinity(), numeric_limits<double>::infinity()),
+      maximum(-numeric_limits<double>::infinity(), -numeric_limits<double>::infinity(), -numeric_limits<double>::infinity())
+{
+}
+
+AABB::AABB(Vector3D minimum, Vector3D maximum) : minimum(minimum), maximum(maximum)
+{
+}
+
+void AABB::expand(const Vector3D &point)
+{
+    minimum = Vector3D(min(minimum.x, point.x), min(minimum.y, point.y), min(minimum.z, point.z));
+    maximum = Vector3D(max(maximum.x, point.x), max(maximum.y, point.y), max(maximum.z, point.z));
+}
+
+void AABB::expand(const AABB &box)
+{
+    minimum = Vector3D(min(minimum.x, box.minimum.x), min(minimum.y, box.minimum.y), min(minimum.z, box.minimum.z));
+    maximum = Vector3D(max(maximum.x, box.maximum.x), max(maximum.y, box.maximum.y), max(maximum.z, box.maximum.z));
+}
+
+void AABB::pad(double amount)
+{
+    minimum = minimum - Vector3D(amount, amount, amount);
+    maximum = maximum + Vector3D(amount, amount, amount);
+}
+
+bool AABB::isEmpty() const
+{
+    return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z;
+}
+
+bool AABB::isFinite() const
+{
+    return std::isfinite(minimum.x) && std::isfinite(minimum.y) && std::isfinite(minimum.z) &&
+           std::isfinite(maximum.x) && std::isfinite(maximum.y) && std::isfinite(maximum.z);
+}
+
+Vector3D AABB::centroid() const
+{
+    return (minimum + maximum) * 0.5;
+}
+
+Vector3D AABB::extent() const
+{
+    return maximum - minimum;
+}
+
+double AABB::surfaceArea() const
+{
+    if (isEmpty())
+    {
+        return 0.0;
+    }
+    Vector3D size = extent();
+    return 2.0 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+int AABB::longestAxis() const
+{
+    Vector3D size = extent();
+    if (size.x >= size.y && size.x >= size.z)
+    {
+        return 0;
+    }
+    return size.y >= size.z ? 1 : 2;
+}
+
+bool AABB::intersect(const Vector3D &origin, const Vector3D &inverseDirection, double tMin, double tMax, double &tEntry) const
+{
+    double t1 = (minimum.x - origin.x) * inverseDirection.x;
+    double t2 = (maximum.x - origin.x) * inverseDirection.x;
+    tMin = max(tMin, min(t1, t2));
+    tMax = min(tMax, max(t1, t2));
+
+    t1 = (minimum.y - origin.y) * inverseDirection.y;
+    t2 = (maximum.y - origin.y) * inverseDirection.y;
+    tMin = max(tMin, min(t1, t2));
+    tMax = min(tMax, max(t1, t2));
+
+    t1 = (minimum.z - origin.z) * inverseDirection.z;
+    t2 = (maximum.z - origin.z) * inverseDirection.z;
+    tMin = max(tMin, min(t1, t2));
+    tMax = min(tMax, max(t1, t2));
+
+    tEntry = tMin;
+    return tMin <= tMax;
+}
+
+AABB AABB::infinite()
+{
+    double inf = numeric_limits<double>::infinity();
+    return AABB(Vector3D(-inf, -inf, -inf), Vector3D(inf, inf, inf));
+}
+
+ostream &operator<<(ostream &out, const AABB &box)
+{
+    out << "AABB: " << box.minimum << " - " << box.maximum;
+    return out;
+}
+
+double axisComponent(const Vector3D &vector, int axis)
+{
+    return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iostream>
+using namespace std;
+
+#include "../Vector3D/2005107_Vector3D.h"
+#include "../Ray/2005107_Ray.h"
+
+// Axis-aligned bounding box; a default constructed box is empty
+class AABB
+{
+public:
+    Vector3D minimum, maximum;
+
+    AABB();
+    AABB(Vector3D minimum, Vector3D maximum);
+
+    void expand(const Vector3D &point);
+    void expand(const AABB &box);
+    void pad(double amount);
+
+    bool isEmpty() const;
+    bool isFinite() const;
+    Vector3D centroid() const;
+    Vector3D extent() const;
+    double surfaceArea() const;
+    int longestAxis() const;
+
+    // Slab test; inverseDirection is 1 / ray direction, precomputed by the caller
+    bool intersect(const Vector3D &origin, const Vector3D &inverseDirection, double tMin, double tMax, double &tEntry) const;
+
+    static AABB infinite();
+
+    friend ostream &operator<<(ostream &out, const AABB &box);
+};
+
+// Component access by axis index (0 = x, 1 = y, 2 = z)
+double axisComponent(const Vector3D &vector, int axis);
@@ -0,0 +1,114 @@
+#include "2005107_AllocationCheck.h"
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#ifdef CHECK_ALLOCATIONS
+
+namespace
+{
+    // Plain values with constant initialisers, so operator new can read them on
+    // any thread at any time without allocating or running constructors
+    thread_local int scopeDepth = 0;
+    atomic<long long> scopedAllocations(0);
+
+    void *countedAllocate(size_t size)
+    {
+        if (scopeDepth > 0)
+        {
+            scopedAllocations.fetch_add(1, memory_order_relaxed);
+        }
+        return malloc(size == 0 ? 1 : size);
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *memory = countedAllocate(size);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+    return countedAllocate(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, const nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, const nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+NoAllocationScope::NoAllocationScope()
+{
+    scopeDepth++;
+}
+
+NoAllocationScope::~NoAllocationScope()
+{
+    scopeDepth--;
+}
+
+bool allocationChecksEnabled()
+{
+    return true;
+}
+
+long long takeScopedAllocationCount()
+{
+    return scopedAllocations.exchange(0);
+}
+
+#else
+
+bool allocationChecksEnabled()
+{
+    return false;
+}
+
+long long takeScopedAllocationCount()
+{
+    return 0;
+}
+
+#endif
+
+void assertNoScopedAllocations(const char *frame)
+{
+    long long count = takeScopedAllocationCount();
+    if (count != 0)
+    {
+        cerr << "Heap allocations while tracing " << frame << ": " << count << " (expected none)" << endl;
+    }
+    assert(count == 0);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+using namespace std;
+
+// Debug check that tracing and shading never touch the heap. Builds with
+// -DCHECK_ALLOCATIONS replace the global operator new and count every
+// allocation a thread makes while it is inside a NoAllocationScope; the
+// renderer asserts at the end of each frame that the count is still zero.
+// In other builds the scope compiles to nothing and the count is always 0.
+
+#ifdef CHECK_ALLOCATIONS
+
+// Marks the calling thread's trace and shade work; scopes may nest
+class NoAllocationScope
+{
+public:
+    NoAllocationScope();
+    ~NoAllocationScope();
+    NoAllocationScope(const NoAllocationScope &) = delete;
+    NoAllocationScope &operator=(const NoAllocationScope &) = delete;
+};
+
+#else
+
+class NoAllocationScope
+{
+public:
+    NoAllocationScope() {}
+};
+
+#endif
+
+bool allocationChecksEnabled();
+
+// Allocations made inside any NoAllocationScope since the last call, on any thread
+long long takeScopedAllocationCount();
+
+// Ends a frame: reports and asserts when anything in it allocated inside a scope
+void assertNoScopedAllocations(const char *frame);
@@ -0,0 +1,503 @@
+#include "2005107_BVH.h"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+    const int SAH_BIN_COUNT = 16;
+    const int MAX_LEAF_SIZE = 8;
+    const int MAX_STACK_DEPTH = 64;
+    // Below this depth splits fall back to the median, which bounds the total depth by the stack size
+    const int MEDIAN_SPLIT_DEPTH = 32;
+    const double TRAVERSAL_COST = 1.0;
+    const double INTERSECTION_COST = 1.0;
+    const double BOUNDS_PADDING = 1e-6; // keeps flat boxes (floor, axis aligned triangles) from being degenerate
+
+    int depthOf(const vector<BVHNode> &nodes, int nodeIndex)
+    {
+        const BVHNode &node = nodes[nodeIndex];
+        if (node.objectCount > 0)
+        {
+            return 1;
+        }
+        return 1 + max(depthOf(nodes, nodeIndex + 1), depthOf(nodes, node.secondChildOrFirstObject));
+    }
+}
+
+BVH::BVH()
+{
+}
+
+void BVH::clear()
+{
+    nodes.clear();
+    orderedObjects.clear();
+    unboundedObjects.clear();
+    orderedTypes.clear();
+    unboundedTypes.clear();
+}
+
+void BVH::build(const vector<Object *> &objects)
+{
+    clear();
+
+    vector<BuildEntry> entries;
+    for (Object *object : objects)
+    {
+        AABB bounds = object->getBounds();
+        PrimitiveType type = classifyPrimitive(object);
+        if (!bounds.isFinite())
+        {
+            unboundedObjects.push_back(object);
+            unboundedTypes.push_back(type);
+            continue;
+        }
+        bounds.pad(BOUNDS_PADDING);
+        BuildEntry entry;
+        entry.bounds = bounds;
+        entry.centroid = bounds.centroid();
+        entry.object = object;
+        entry.type = type;
+        entries.push_back(entry);
+    }
+
+    if (entries.empty())
+    {
+        return;
+    }
+
+    nodes.reserve(2 * entries.size());
+    orderedObjects.reserve(entries.size());
+    orderedTypes.reserve(entries.size());
+    buildRecursive(entries, 0, entries.size(), 0);
+}
+
+int BVH::buildRecursive(vector<BuildEntry> &entries, int begin, int end, int depth)
+{
+    AABB bounds, centroidBounds;
+    for (int i = begin; i < end; i++)
+    {
+        bounds.expand(entries[i].bounds);
+        centroidBounds.expand(entries[i].centroid);
+    }
+
+    int nodeIndex = nodes.size();
+    nodes.push_back(BVHNode());
+    nodes[nodeIndex].bounds = bounds;
+    nodes[nodeIndex].splitAxis = 0;
+    nodes[nodeIndex].padding = 0;
+
+    int count = end - begin;
+    int axis = 0;
+    int middle = count > 1 ? partitionSAH(entries, begin, end, centroidBounds, bounds.surfaceArea(), depth, axis) : -1;
+
+    if (middle < 0)
+    {
+        nodes[nodeIndex].secondChildOrFirstObject = orderedObjects.size();
+        nodes[nodeIndex].objectCount = count;
+
+        // Grouping a leaf by type keeps its dispatch switch predictable
+        stable_sort(entries.begin() + begin, entries.begin() + end, [](const BuildEntry &a, const BuildEntry &b) {
+            return a.type < b.type;
+        });
+        for (int i = begin; i < end; i++)
+        {
+            orderedObjects.push_back(entries[i].object);
+            orderedTypes.push_back(entries[i].type);
+        }
+        return nodeIndex;
+    }
+
+    nodes[nodeIndex].splitAxis = axis;
+    nodes[nodeIndex].objectCount = 0;
+    buildRecursive(entries, begin, middle, depth + 1);
+    int secondChild = buildRecursive(entries, middle, end, depth + 1);
+    nodes[nodeIndex].secondChildOrFirstObject = secondChild;
+    return nodeIndex;
+}
+
+// Picks the cheapest binned SAH split and partitions entries around it.
+// Returns the partition point, or -1 when a leaf is cheaper.
+int BVH::partitionSAH(vector<BuildEntry> &entries, int begin, int end, const AABB &centroidBounds, double parentArea, int depth, int &axis)
+{
+    int count = end - begin;
+    if (depth >= MEDIAN_SPLIT_DEPTH)
+    {
+        if (count <= MAX_LEAF_SIZE)
+        {
+            return -1;
+        }
+        axis = centroidBounds.longestAxis();
+        int middle = begin + count / 2;
+        nth_element(entries.begin() + begin, entries.begin() + middle, entries.begin() + end, [axis](const BuildEntry &a, const BuildEntry &b) {
+            return axisComponent(a.centroid, axis) < axisComponent(b.centroid, axis);
+        });
+        return middle;
+    }
+
+    double leafCost = INTERSECTION_COST * count;
+    double bestCost = numeric_limits<double>::infinity();
+    int bestAxis = -1, bestSplit = -1;
+
+    for (int candidateAxis = 0; candidateAxis < 3; candidateAxis++)
+    {
+        double axisMin = axisComponent(centroidBounds.minimum, candidateAxis);
+        double axisMax = axisComponent(centroidBounds.maximum, candidateAxis);
+        if (axisMax - axisMin <= 0)
+        {
+            continue;
+        }
+
+        AABB binBounds[SAH_BIN_COUNT];
+        int binCounts[SAH_BIN_COUNT] = {0};
+        double scale = SAH_BIN_COUNT / (axisMax - axisMin);
+        for (int i = begin; i < end; i++)
+        {
+            int bin = min(SAH_BIN_COUNT - 1, (int)((axisComponent(entries[i].centroid, candidateAxis) - axisMin) * scale));
+            binCounts[bin]++;
+            binBounds[bin].expand(entries[i].bounds);
+        }
+
+        // Sweep from the right to get the area/count of every right-hand side
+        double rightArea[SAH_BIN_COUNT];
+        int rightCount[SAH_BIN_COUNT];
+        AABB accumulated;
+        int accumulatedCount = 0;
+        for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--)
+        {
+            accumulated.expand(binBounds[bin]);
+            accumulatedCount += binCounts[bin];
+            rightArea[bin] = accumulated.surfaceArea();
+            rightCount[bin] = accumulatedCount;
+        }
+
+        accumulated = AABB();
+        accumulatedCount = 0;
+        for (int split = 1; split < SAH_BIN_COUNT; split++)
+        {
+            accumulated.expand(binBounds[split - 1]);
+            accumulatedCount += binCounts[split - 1];
+            if (accumulatedCount == 0 || rightCount[split] == 0)
+            {
+                continue;
+            }
+            double cost = TRAVERSAL_COST + INTERSECTION_COST *
+                          (accumulated.surfaceArea() * accumulatedCount + rightArea[split] * rightCount[split]) / parentArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = candidateAxis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+    {
+        // Every centroid coincides; only split (in half) when the leaf would be too big
+        if (count <= MAX_LEAF_SIZE)
+        {
+            return -1;
+        }
+        axis = 0;
+        return begin + count / 2;
+    }
+
+    if (bestCost >= leafCost && count <= MAX_LEAF_SIZE)
+    {
+        return -1;
+    }
+
+    axis = bestAxis;
+    double axisMin = axisComponent(centroidBounds.minimum, axis);
+    double scale = SAH_BIN_COUNT / (axisComponent(centroidBounds.maximum, axis) - axisMin);
+    BuildEntry *middle = stable_partition(&entries[begin], &entries[begin] + count, [&](const BuildEntry &entry) {
+        return min(SAH_BIN_COUNT - 1, (int)((axisComponent(entry.centroid, axis) - axisMin) * scale)) < bestSplit;
+    });
+    return middle - &entries[0];
+}
+
+bool BVH::closestHit(const Ray &ray, double tMin, double tMax, HitRecord &hit) const
+{
+    hit.t = tMax;
+    hit.object = nullptr;
+
+    for (size_t i = 0; i < unboundedObjects.size(); i++)
+    {
+        intersectPrimitive(unboundedTypes[i], unboundedObjects[i], ray, tMin, hit.t, hit);
+    }
+
+    if (!nodes.empty())
+    {
+        Vector3D origin = ray.getOrigin();
+        Vector3D direction = ray.getDirection();
+        Vector3D inverseDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+        bool directionNegative[3] = {direction.x < 0, direction.y < 0, direction.z < 0};
+
+        int stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        int nodeIndex = 0;
+        while (true)
+        {
+            const BVHNode &node = nodes[nodeIndex];
+            double tEntry;
+            if (node.bounds.intersect(origin, inverseDirection, tMin, hit.t, tEntry))
+            {
+                if (node.objectCount > 0)
+                {
+                    for (int i = node.secondChildOrFirstObject; i < node.secondChildOrFirstObject + node.objectCount; i++)
+                    {
+                        intersectPrimitive(orderedTypes[i], orderedObjects[i], ray, tMin, hit.t, hit);
+                    }
+                }
+                else
+                {
+                    // Visit the child on the near side of the split plane first
+                    if (directionNegative[node.splitAxis])
+                    {
+                        stack[stackSize++] = nodeIndex + 1;
+                        nodeIndex = node.secondChildOrFirstObject;
+                    }
+                    else
+                    {
+                        stack[stackSize++] = node.secondChildOrFirstObject;
+                        nodeIndex = nodeIndex + 1;
+                    }
+                    continue;
+                }
+            }
+            if (stackSize == 0)
+            {
+                break;
+            }
+            nodeIndex = stack[--stackSize];
+        }
+    }
+
+    return hit.object != nullptr;
+}
+
+bool BVH::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) const
+{
+    if (!closestHit(ray, tMin, tMax, hit))
+    {
+        return false;
+    }
+    hit.object->completeHit(ray, hit);
+    return true;
+}
+
+Object *BVH::anyHit(const Ray &ray, double tMin, double tMax) const
+{
+    HitRecord hit;
+
+    if (!nodes.empty())
+    {
+        Vector3D origin = ray.getOrigin();
+        Vector3D direction = ray.getDirection();
+        Vector3D inverseDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+
+        int stack[MAX_STACK_DEPTH];
+        int stackSize = 0;
+        int nodeIndex = 0;
+        while (true)
+        {
+            const BVHNode &node = nodes[nodeIndex];
+            double tEntry;
+            if (node.bounds.intersect(origin, inverseDirection, tMin, tMax, tEntry))
+            {
+                if (node.objectCount > 0)
+                {
+                    for (int i = node.secondChildOrFirstObject; i < node.secondChildOrFirstObject + node.objectCount; i++)
+                    {
+                        if (intersectPrimitive(orderedTypes[i], orderedObjects[i], ray, tMin, tMax, hit))
+                        {
+                            return orderedObjects[i];
+                        }
+                    }
+                }
+                else
+                {
+                    stack[stackSize++] = node.secondChildOrFirstObject;
+                    nodeIndex = nodeIndex + 1;
+                    continue;
+                }
+            }
+            if (stackSize == 0)
+            {
+                break;
+            }
+            nodeIndex = stack[--stackSize];
+        }
+    }
+
+    // Unbounded quadrics are the most expensive tests, so they go last
+    for (size_t i = 0; i < unboundedObjects.size(); i++)
+    {
+        if (intersectPrimitive(unboundedTypes[i], unboundedObjects[i], ray, tMin, tMax, hit))
+        {
+            return unboundedObjects[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void BVH::closestHitPacket(const RayPacket &packet, PacketHit &hits) const
+{
+    for (Object *object : unboundedObjects)
+    {
+        object->intersectPacket(packet, hits);
+    }
+
+    if (nodes.empty() || packet.activeMask == 0)
+    {
+        return;
+    }
+
+    const PacketKernels &kernels = getPacketKernels();
+
+    // The rays are coherent, so the first live ray decides the traversal order for all of them
+    int leadLane = 0;
+    while (!packet.isActive(leadLane))
+    {
+        leadLane++;
+    }
+    bool directionNegative[3] = {packet.directionX[leadLane] < 0, packet.directionY[leadLane] < 0, packet.directionZ[leadLane] < 0};
+
+    int stack[MAX_STACK_DEPTH];
+    int stackSize = 0;
+    int nodeIndex = 0;
+    while (true)
+    {
+        const BVHNode &node = nodes[nodeIndex];
+        if (kernels.box(packet, node.bounds, hits.t) != 0)
+        {
+            if (node.objectCount > 0)
+            {
+                for (int i = 0; i < node.objectCount; i++)
+                {
+                    orderedObjects[node.secondChildOrFirstObject + i]->intersectPacket(packet, hits);
+                }
+            }
+            else
+            {
+                if (directionNegative[node.splitAxis])
+                {
+                    stack[stackSize++] = nodeIndex + 1;
+                    nodeIndex = node.secondChildOrFirstObject;
+                }
+                else
+                {
+                    stack[stackSize++] = node.secondChildOrFirstObject;
+                    nodeIndex = nodeIndex + 1;
+                }
+                continue;
+            }
+        }
+        if (stackSize == 0)
+        {
+            break;
+        }
+        nodeIndex = stack[--stackSize];
+    }
+}
+
+int BVH::getNodeCount() const
+{
+    return nodes.size();
+}
+
+int BVH::getDepth() const
+{
+    return nodes.empty() ? 0 : depthOf(nodes, 0);
+}
+
+const vector<BVHNode> &BVH::getNodes() const
+{
+    return nodes;
+}
+
+void BVH::getObjectIndices(const vector<Object *> &objects, vector<int> &ordered, vector<int> &unbounded) const
+{
+    unordered_map<const Object *, int> indices;
+    indices.reserve(objects.size());
+    for (size_t k = 0; k < objects.size(); k++)
+    {
+        indices[objects[k]] = k;
+    }
+    ordered.clear();
+    unbounded.clear();
+    for (Object *object : orderedObjects)
+    {
+        ordered.push_back(indices.at(object));
+    }
+    for (Object *object : unboundedObjects)
+    {
+        unbounded.push_back(indices.at(object));
+    }
+}
+
+bool BVH::restore(const vector<Object *> &objects, const BVHNode *storedNodes, int nodeCount, const int *ordered,
+                  int orderedCount, const int *unbounded, int unboundedCount)
+{
+    clear();
+
+    // Checked first, so that a damaged file cannot send a traversal out of
+    // bounds or past its stack. Children always follow their parent, so one
+    // forward pass finds every node's depth.
+    vector<int> depths(nodeCount, 1);
+    for (int k = 0; k < nodeCount; k++)
+    {
+        const BVHNode &node = storedNodes[k];
+        bool valid = node.objectCount > 0
+                         ? node.secondChildOrFirstObject >= 0 && node.secondChildOrFirstObject + node.objectCount <= orderedCount
+                         : node.secondChildOrFirstObject > k + 1 && node.secondChildOrFirstObject < nodeCount && node.splitAxis < 3;
+        if (!valid || depths[k] > MAX_STACK_DEPTH)
+        {
+            return false;
+        }
+        if (node.objectCount == 0)
+        {
+            depths[k + 1] = max(depths[k + 1], depths[k] + 1);
+            depths[node.secondChildOrFirstObject] = max(depths[node.secondChildOrFirstObject], depths[k] + 1);
+        }
+    }
+    for (int k = 0; k < orderedCount + unboundedCount; k++)
+    {
+        int index = k < orderedCount ? ordered[k] : unbounded[k - orderedCount];
+        if (index < 0 || index >= (int)objects.size())
+        {
+            return false;
+        }
+    }
+
+    nodes.assign(storedNodes, storedNodes + nodeCount);
+    orderedObjects.reserve(orderedCount);
+    orderedTypes.reserve(orderedCount);
+    for (int k = 0; k < orderedCount; k++)
+    {
+        orderedObjects.push_back(objects[ordered[k]]);
+        orderedTypes.push_back(classifyPrimitive(orderedObjects.back()));
+    }
+    for (int k = 0; k < unboundedCount; k++)
+    {
+        unboundedObjects.push_back(objects[unbounded[k]]);
+        unboundedTypes.push_back(classifyPrimitive(unboundedObjects.back()));
+    }
+    return true;
+}
+
+const vector<Object *> &BVH::getUnboundedObjects() const
+{
+    return unboundedObjects;
+}
+
+ostream &operator<<(ostream &out, const BVH &bvh)
+{
+    out << "BVH: " << bvh.nodes.size() << " nodes, depth " << bvh.getDepth() << ", "
+        << bvh.orderedObjects.size() << " bounded objects, "
+        << bvh.unboundedObjects.size() << " unbounded objects";
+    return out;
+}
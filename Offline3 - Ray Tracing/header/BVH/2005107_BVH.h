@@ -0,0 +1,80 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include "../AABB/2005107_AABB.h"
+#include "../Object/2005107_Object.h"
+#include "../CompiledScene/2005107_PrimitiveDispatch.h"
+
+// One node of the flattened hierarchy, stored depth first: an interior node's
+// first child directly follows it and only the second child's index is kept
+struct BVHNode
+{
+    AABB bounds;
+    int secondChildOrFirstObject; // interior: index of second child, leaf: first entry in orderedObjects
+    unsigned short objectCount;   // 0 for interior nodes
+    unsigned char splitAxis;
+    unsigned char padding;
+};
+
+// Surface area heuristic bounding volume hierarchy over the scene objects.
+// Objects without finite bounds (e.g. unclipped quadrics) are kept aside and
+// tested linearly on every query.
+class BVH
+{
+private:
+    struct BuildEntry
+    {
+        AABB bounds;
+        Vector3D centroid;
+        Object *object;
+        PrimitiveType type;
+    };
+
+    vector<BVHNode> nodes;
+    vector<Object *> orderedObjects;
+    vector<Object *> unboundedObjects;
+    // Concrete type of each entry above, so leaf loops can call intersect without the vtable
+    vector<PrimitiveType> orderedTypes;
+    vector<PrimitiveType> unboundedTypes;
+
+    int buildRecursive(vector<BuildEntry> &entries, int begin, int end, int depth);
+    int partitionSAH(vector<BuildEntry> &entries, int begin, int end, const AABB &centroidBounds, double parentArea, int depth, int &axis);
+
+public:
+    BVH();
+
+    void build(const vector<Object *> &objects);
+    void clear();
+
+    // Nearest hit with tMin < t < tMax; only hit.t and hit.object are filled
+    bool closestHit(const Ray &ray, double tMin, double tMax, HitRecord &hit) const;
+
+    // Nearest hit with the full record (point, normal, color) filled for shading
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) const;
+
+    // Any hit with tMin < t < tMax, stopping at the first one found; returns the
+    // occluding object or nullptr. Meant for shadow rays, where order does not matter.
+    Object *anyHit(const Ray &ray, double tMin, double tMax) const;
+
+    // Closest hit for every lane of a coherent packet; a node is entered when any
+    // lane overlaps it. On entry hits.t holds each lane's tMax.
+    void closestHitPacket(const RayPacket &packet, PacketHit &hits) const;
+
+    int getNodeCount() const;
+    int getDepth() const;
+    const vector<Object *> &getUnboundedObjects() const;
+
+    // The built hierarchy with every object given as its index in the list it
+    // was built from, which is how the scene cache stores it
+    const vector<BVHNode> &getNodes() const;
+    void getObjectIndices(const vector<Object *> &objects, vector<int> &ordered, vector<int> &unbounded) const;
+    // Takes over a stored hierarchy over objects instead of building one.
+    // Fails, leaving the hierarchy empty, when an index is out of range.
+    bool restore(const vector<Object *> &objects, const BVHNode *storedNodes, int nodeCount, const int *ordered,
+                 int orderedCount, const int *unbounded, int unboundedCount);
+
+    friend ostream &operator<<(ostream &out, const BVH &bvh);
+};
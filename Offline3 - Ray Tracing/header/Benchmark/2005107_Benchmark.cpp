@@ -0,0 +1,139 @@
+#include "2005107_Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+void RayBatch::add(const Ray &ray, double tMin, double tMax)
+{
+    rays.push_back(ray);
+    this->tMin.push_back(tMin);
+    this->tMax.push_back(tMax);
+}
+
+int RayBatch::size() const
+{
+    return rays.size();
+}
+
+double BenchmarkResult::raysPerSecond() const
+{
+    return seconds > 0 ? rays / seconds : 0;
+}
+
+BenchmarkResult benchmarkClosestHit(const string &name, const RayBatch &batch, const ClosestHitQuery &query, int passes)
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.rays = 0;
+    result.hits = 0;
+
+    // Warm-up pass so caches and lazily selected kernels do not count
+    HitRecord hit;
+    for (int i = 0; i < batch.size(); i++)
+    {
+        query(batch.rays[i], batch.tMin[i], batch.tMax[i], hit);
+    }
+
+    auto startTime = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (int i = 0; i < batch.size(); i++)
+        {
+            if (query(batch.rays[i], batch.tMin[i], batch.tMax[i], hit))
+            {
+                result.hits++;
+            }
+        }
+        result.rays += batch.size();
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    return result;
+}
+
+void printBenchmarkTable(ostream &out, const vector<BenchmarkResult> &results)
+{
+    if (results.empty())
+    {
+        return;
+    }
+
+    out << left << setw(28) << "query" << right << setw(12) << "rays" << setw(12) << "hits"
+        << setw(12) << "seconds" << setw(16) << "rays/sec" << setw(10) << "speedup" << endl;
+    for (const BenchmarkResult &result : results)
+    {
+        double speedup = results[0].raysPerSecond() > 0 ? result.raysPerSecond() / results[0].raysPerSecond() : 0;
+        out << left << setw(28) << result.name << right << setw(12) << result.rays << setw(12) << result.hits
+            << setw(12) << fixed << setprecision(4) << result.seconds
+            << setw(16) << setprecision(0) << result.raysPerSecond()
+            << setw(9) << setprecision(2) << speedup << "x" << endl;
+        out.unsetf(ios::floatfield);
+    }
+}
+
+double RenderBenchmarkResult::raysPerSecond() const
+{
+    return renderSeconds > 0 ? stats.rays().total() / renderSeconds : 0;
+}
+
+void printRenderBenchmarkTable(ostream &out, const vector<RenderBenchmarkResult> &results)
+{
+    streamsize precision = out.precision();
+    out << left << setw(18) << "scene" << setw(6) << "accel" << right << setw(9) << "objects" << setw(8) << "lights"
+        << setw(10) << "build s" << setw(10) << "render s" << setw(11) << "primary" << setw(11) << "shadow"
+        << setw(11) << "reflection" << setw(12) << "rays/sec" << endl;
+    for (const RenderBenchmarkResult &result : results)
+    {
+        RayCounts rays = result.stats.rays();
+        out << left << setw(18) << result.scene << setw(6) << result.acceleration << right << setw(9) << result.objects
+            << setw(8) << result.pointLights + result.spotLights
+            << setw(10) << fixed << setprecision(3) << result.buildSeconds << setw(10) << result.renderSeconds
+            << setw(11) << rays.primary << setw(11) << rays.shadow << setw(11) << rays.reflection
+            << setw(12) << setprecision(0) << result.raysPerSecond() << endl;
+        out.unsetf(ios::floatfield);
+    }
+    out.precision(precision);
+}
+
+void writeRenderBenchmarkJson(ostream &out, const vector<RenderBenchmarkResult> &results, bool optimized,
+                              int threads, const string &kernels, int lightSamples)
+{
+    out << "{" << endl;
+    out << "  \"optimized\": " << (optimized ? "true" : "false") << "," << endl;
+    out << "  \"threads\": " << threads << "," << endl;
+    out << "  \"kernels\": \"" << kernels << "\"," << endl;
+    out << "  \"precision\": \"" << realTypeName() << "\"," << endl;
+    out << "  \"vector_math\": \"" << simdMathName() << "\"," << endl;
+    out << "  \"light_samples\": " << lightSamples << "," << endl;
+    out << "  \"runs\": [" << endl;
+    for (size_t k = 0; k < results.size(); k++)
+    {
+        const RenderBenchmarkResult &result = results[k];
+        const RenderStats &stats = result.stats;
+        RayCounts rays = stats.rays();
+        out << "    {\"scene\": \"" << result.scene << "\", \"acceleration\": \"" << result.acceleration << "\", "
+            << "\"objects\": " << result.objects << ", \"point_lights\": " << result.pointLights
+            << ", \"spot_lights\": " << result.spotLights << ", \"recursion_level\": " << result.recursionLevel
+            << ", \"width\": " << result.width << ", \"height\": " << result.height << "," << endl;
+        out << "     \"seconds\": {\"generate\": " << result.generateSeconds << ", \"build\": " << result.buildSeconds
+            << ", \"render\": " << result.renderSeconds << "}," << endl;
+        out << "     \"rays\": {\"primary\": " << rays.primary << ", \"shadow\": " << rays.shadow
+            << ", \"reflection\": " << rays.reflection << ", \"total\": " << rays.total() << "}," << endl;
+        out << "     \"intersection_tests\": {\"sphere\": " << stats.counters[STAT_SPHERE_TESTS]
+            << ", \"triangle\": " << stats.counters[STAT_TRIANGLE_TESTS] << ", \"quadric\": " << stats.counters[STAT_GENERAL_TESTS]
+            << ", \"floor\": " << stats.counters[STAT_FLOOR_TESTS] << "}, \"max_depth\": " << stats.maxDepth << "," << endl;
+        if (arePhaseTimersEnabled())
+        {
+            out << "     \"phase_thread_seconds\": {";
+            for (int phase = 0; phase < PHASE_COUNT; phase++)
+            {
+                string name = statPhaseName((StatPhase)phase);
+                replace(name.begin(), name.end(), ' ', '_');
+                out << (phase > 0 ? ", " : "") << "\"" << name << "\": " << stats.phaseSeconds[phase];
+            }
+            out << "}," << endl;
+        }
+        out << "     \"rays_per_second\": " << (long long)result.raysPerSecond() << "}" << (k + 1 < results.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Ray/2005107_Ray.h"
+#include "../Object/2005107_Object.h"
+#include "../RenderStats/2005107_RenderStats.h"
+
+// Rays to time, each with the (tMin, tMax) interval it is queried over
+struct RayBatch
+{
+    vector<Ray> rays;
+    vector<double> tMin, tMax;
+
+    void add(const Ray &ray, double tMin, double tMax);
+    int size() const;
+};
+
+struct BenchmarkResult
+{
+    string name;
+    long long rays;
+    long long hits;
+    double seconds;
+
+    double raysPerSecond() const;
+};
+
+typedef function<bool(const Ray &ray, double tMin, double tMax, HitRecord &hit)> ClosestHitQuery;
+
+// Runs the query over the whole batch once untimed, then times `passes` more runs
+BenchmarkResult benchmarkClosestHit(const string &name, const RayBatch &batch, const ClosestHitQuery &query, int passes);
+
+// One row per result; speedups are relative to the first row
+void printBenchmarkTable(ostream &out, const vector<BenchmarkResult> &results);
+
+// One full render of a benchmark scene, as the suite reports it
+struct RenderBenchmarkResult
+{
+    string scene;
+    string acceleration;
+    int objects, pointLights, spotLights;
+    int recursionLevel;
+    int width, height;
+    double generateSeconds, buildSeconds, renderSeconds; // wall time of each phase
+    RenderStats stats;
+
+    double raysPerSecond() const;
+};
+
+void printRenderBenchmarkTable(ostream &out, const vector<RenderBenchmarkResult> &results);
+
+// {"optimized": ..., "threads": ..., "kernels": ..., "runs": [...]}, one run object per result
+void writeRenderBenchmarkJson(ostream &out, const vector<RenderBenchmarkResult> &results, bool optimized,
+                              int threads, const string &kernels, int lightSamples);
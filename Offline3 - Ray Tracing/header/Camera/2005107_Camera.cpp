@@ -1,11 +1,13 @@
 #include "2005107_Camera.h"
 
+#ifndef RENDER_ONLY
 #ifdef __linux__
 #include <GL/glut.h>
 #elif WIN32
 #include <glut.h>
 #include <windows.h>
 #endif
+#endif
 
 #include <iostream>
 
@@ -86,6 +88,12 @@ void Camera::setLookAt(const Vector3D& target, const Vector3D& up) {
     updateBasisVectors();
 }
 
+void Camera::setBasis(const Vector3D& look, const Vector3D& up, const Vector3D& right) {
+    lookDirection = look;
+    upDirection = up;
+    rightDirection = right;
+}
+
 // Movement methods
 void Camera::moveForward(float distance) {
     if (distance < 0) distance = movementSpeed;
@@ -171,12 +179,14 @@ void Camera::update() {
 
 // OpenGL specific methods
 void Camera::applyLookAt() const {
+#ifndef RENDER_ONLY
     Vector3D target = position + lookDirection;
     gluLookAt(
         position.x, position.y, position.z,
         target.x, target.y, target.z,
         upDirection.x, upDirection.y, upDirection.z
     );
+#endif
 }
 
 ostream &operator<<(ostream &out, const Camera &camera) {
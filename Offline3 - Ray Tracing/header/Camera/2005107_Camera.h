@@ -41,6 +41,9 @@ public:
     void setRotationSpeed(float speed);
     void setLookAt(const Vector3D& target);
     void setLookAt(const Vector3D& target, const Vector3D& up);
+    // Takes another camera's basis exactly as its getters report it, without
+    // renormalizing, so both trace bit identical rays
+    void setBasis(const Vector3D& look, const Vector3D& up, const Vector3D& right);
 
     // Movement methods
     void moveForward(float distance = -1);
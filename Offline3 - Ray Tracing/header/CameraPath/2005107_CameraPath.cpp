@@ -0,0 +1,110 @@
+#include "2005107_CameraPath.h"
+#include <fstream>
+#include <sstream>
+
+bool CameraPath::load(const string &fileName, string &error)
+{
+    ifstream in(fileName);
+    if (!in)
+    {
+        error = "cannot open " + fileName;
+        return false;
+    }
+
+    keyframes.clear();
+    string line;
+    for (int lineNumber = 1; getline(in, line); lineNumber++)
+    {
+        stringstream fields(line);
+        string first;
+        if (!(fields >> first) || first[0] == '#')
+        {
+            continue;
+        }
+
+        CameraKeyframe keyframe;
+        stringstream frameField(first);
+        string rest;
+        if (!(frameField >> keyframe.frame) || (frameField >> rest) ||
+            !(fields >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z) ||
+            !(fields >> keyframe.look.x >> keyframe.look.y >> keyframe.look.z) ||
+            !(fields >> keyframe.up.x >> keyframe.up.y >> keyframe.up.z) || (fields >> rest))
+        {
+            error = fileName + ":" + to_string(lineNumber) + ": expected \"frame px py pz lx ly lz ux uy uz\"";
+            return false;
+        }
+        if (!keyframes.empty() && keyframe.frame <= keyframes.back().frame)
+        {
+            error = fileName + ":" + to_string(lineNumber) + ": frame numbers must increase";
+            return false;
+        }
+        if (keyframe.look.lengthSquared() == 0 || keyframe.look.cross(keyframe.up).lengthSquared() == 0)
+        {
+            error = fileName + ":" + to_string(lineNumber) + ": look and up must be non-zero and not parallel";
+            return false;
+        }
+        keyframes.push_back(keyframe);
+    }
+
+    if (keyframes.empty())
+    {
+        error = fileName + " has no keyframes";
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::addKeyframe(const CameraKeyframe &keyframe)
+{
+    keyframes.push_back(keyframe);
+}
+
+bool CameraPath::empty() const
+{
+    return keyframes.empty();
+}
+
+int CameraPath::getFirstFrame() const
+{
+    return keyframes.front().frame;
+}
+
+int CameraPath::getLastFrame() const
+{
+    return keyframes.back().frame;
+}
+
+int CameraPath::getKeyframeCount() const
+{
+    return keyframes.size();
+}
+
+Camera CameraPath::cameraAt(int frame) const
+{
+    if (frame <= keyframes.front().frame)
+    {
+        const CameraKeyframe &first = keyframes.front();
+        return Camera(first.position, first.look, first.up);
+    }
+    if (frame >= keyframes.back().frame)
+    {
+        const CameraKeyframe &last = keyframes.back();
+        return Camera(last.position, last.look, last.up);
+    }
+
+    size_t next = 1;
+    while (keyframes[next].frame <= frame)
+    {
+        next++;
+    }
+    const CameraKeyframe &from = keyframes[next - 1];
+    const CameraKeyframe &to = keyframes[next];
+    double t = (double)(frame - from.frame) / (to.frame - from.frame);
+
+    // Directions are blended after normalizing, so keyframes given with different
+    // lengths still carry equal weight
+    Vector3D position = from.position + (to.position - from.position) * t;
+    Vector3D look = from.look.normalized() * (1 - t) + to.look.normalized() * t;
+    Vector3D up = from.up.normalized() * (1 - t) + to.up.normalized() * t;
+    return Camera(position, look, up);
+}
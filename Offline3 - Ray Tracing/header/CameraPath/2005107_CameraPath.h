@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Camera/2005107_Camera.h"
+#include "../Vector3D/2005107_Vector3D.h"
+
+// A camera pose pinned to a frame number
+struct CameraKeyframe
+{
+    int frame;
+    Vector3D position, look, up;
+};
+
+// Camera fly-through described by keyframes. A path file holds one keyframe per
+// line, "frame px py pz lx ly lz ux uy uz", with frame numbers strictly
+// increasing; blank lines and lines starting with '#' are ignored. Frames
+// between two keyframes move the position linearly and blend the look and up
+// directions, which Camera then turns back into an orthonormal basis.
+class CameraPath
+{
+private:
+    vector<CameraKeyframe> keyframes;
+
+public:
+    // Returns false and describes the first problem in error if the file is unusable
+    bool load(const string &fileName, string &error);
+
+    void addKeyframe(const CameraKeyframe &keyframe);
+    bool empty() const;
+    int getFirstFrame() const;
+    int getLastFrame() const;
+    int getKeyframeCount() const;
+
+    // Frames outside the keyframe range hold the nearest keyframe's pose
+    Camera cameraAt(int frame) const;
+};
@@ -1,49 +1,94 @@
 #pragma once
 
 #include <iostream>
+#include <type_traits>
 using namespace std;
 
-class Color
+#include "../Precision/2005107_Precision.h"
+#include "../SimdMath/2005107_SimdMath.h"
+
+// RGB colour over scalar type T; the renderer uses Color, which is ColorT<Real>.
+// Header only, like Vector3D: the channels are combined with Lanes3 operations
+// and copies are compiler generated.
+template <class T>
+class ColorT
 {
 public:
-    double red, green, blue;
+    T red, green, blue;
 
     // Default constructor
-    Color();
-    
+    constexpr ColorT() : red(0), green(0), blue(0)
+    {
+    }
+
     // Parameterized constructor
-    Color(double red, double green, double blue);
-    
-    // Copy constructor
-    Color(const Color& other);
-    
-    // Assignment operator
-    Color& operator=(const Color& other);
-    
+    constexpr ColorT(T red, T green, T blue) : red(red), green(green), blue(blue)
+    {
+    }
+
     // Getters
-    double getRed() const;
-    double getGreen() const;
-    double getBlue() const;
-    
+    constexpr T getRed() const { return red; }
+    constexpr T getGreen() const { return green; }
+    constexpr T getBlue() const { return blue; }
+
     // Setters
-    void setRed(double red);
-    void setGreen(double green);
-    void setBlue(double blue);
-    void setColor(double red, double green, double blue);
-    
+    void setRed(T red) { this->red = red; }
+    void setGreen(T green) { this->green = green; }
+    void setBlue(T blue) { this->blue = blue; }
+    void setColor(T red, T green, T blue)
+    {
+        this->red = red;
+        this->green = green;
+        this->blue = blue;
+    }
+
     // Utility methods
-    Color operator+(const Color& other) const;
-    Color operator-(const Color& other) const;
-    Color operator*(double scalar) const;
-    Color operator/(double scalar) const;
-    Color& operator+=(const Color& other);
-    Color& operator-=(const Color& other);
-    Color& operator*=(double scalar);
-    Color& operator/=(double scalar);
-    
+    ColorT operator+(const ColorT &other) const { return ColorT(lanes() + other.lanes()); }
+    ColorT operator-(const ColorT &other) const { return ColorT(lanes() - other.lanes()); }
+    // Channel by channel product, e.g. light colour filtered by a surface
+    ColorT operator*(const ColorT &other) const { return ColorT(lanes() * other.lanes()); }
+    ColorT operator*(T scalar) const { return ColorT(lanes() * Lanes3<T>::set1(scalar)); }
+    ColorT operator/(T scalar) const
+    {
+        if (scalar != 0.0)
+        {
+            return ColorT(lanes() / Lanes3<T>::set1(scalar));
+        }
+        return *this;
+    }
+    ColorT &operator+=(const ColorT &other) { return *this = *this + other; }
+    ColorT &operator-=(const ColorT &other) { return *this = *this - other; }
+    ColorT &operator*=(T scalar) { return *this = *this * scalar; }
+    ColorT &operator/=(T scalar) { return *this = *this / scalar; }
+
+    // this + color * scalar, e.g. one weighted lighting term added to a pixel
+    ColorT mulAdd(const ColorT &color, T scalar) const
+    {
+        return ColorT(lanes() + color.lanes() * Lanes3<T>::set1(scalar));
+    }
+
     // Clamp color values to [0, 1] range
-    void clamp();
-    
-    // Stream operator
-    friend ostream& operator<<(ostream& out, const Color& color);
+    void clamp()
+    {
+        *this = ColorT(Lanes3<T>::maximum(Lanes3<T>::set1(0), Lanes3<T>::minimum(Lanes3<T>::set1(1), lanes())));
+    }
+
+private:
+    explicit ColorT(const Lanes3<T> &lanes) { lanes.store(&red); }
+    Lanes3<T> lanes() const { return Lanes3<T>::load(&red); }
 };
+
+typedef ColorT<Real> Color;
+
+// lanes() reads red, green and blue as one packed array
+static_assert(sizeof(ColorT<float>) == 3 * sizeof(float) && sizeof(ColorT<double>) == 3 * sizeof(double),
+              "ColorT must be exactly three packed scalars");
+static_assert(is_trivially_copyable<ColorT<Real> >::value, "ColorT copies must stay plain memberwise copies");
+
+// Stream operator
+template <class T>
+ostream &operator<<(ostream &out, const ColorT<T> &color)
+{
+    out << "Color: " << color.red << " " << color.green << " " << color.blue;
+    return out;
+}
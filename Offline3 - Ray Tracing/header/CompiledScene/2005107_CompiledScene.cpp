@@ -0,0 +1,313 @@
+#include "2005107_CompiledScene.h"
+#include "../RenderStats/2005107_RenderStats.h"
+#include <limits>
+
+extern double epsilon;
+
+namespace
+{
+    // Padding entries compare false against everything, so they are never hit
+    void padWithNaN(vector<double> &values, size_t count)
+    {
+        values.resize(count, numeric_limits<double>::quiet_NaN());
+    }
+
+    size_t roundUpToBlock(size_t count)
+    {
+        return (count + PRIMITIVE_BLOCK - 1) / PRIMITIVE_BLOCK * PRIMITIVE_BLOCK;
+    }
+}
+
+CompiledScene::CompiledScene() : mode(ACCELERATION_BVH)
+{
+    updateViews();
+}
+
+void CompiledScene::clear()
+{
+    bvh.clear();
+
+    sphereCenterX.clear();
+    sphereCenterY.clear();
+    sphereCenterZ.clear();
+    sphereRadius.clear();
+    sphereObjects.clear();
+
+    for (int k = 0; k < 3; k++)
+    {
+        triangleVertexX[k].clear();
+        triangleVertexY[k].clear();
+        triangleVertexZ[k].clear();
+        triangleEdgeX[k].clear();
+        triangleEdgeY[k].clear();
+        triangleEdgeZ[k].clear();
+    }
+    triangleNormalX.clear();
+    triangleNormalY.clear();
+    triangleNormalZ.clear();
+    triangleObjects.clear();
+
+    generalObjects.clear();
+    floorObjects.clear();
+    meshObjects.clear();
+    otherObjects.clear();
+    updateViews();
+}
+
+void CompiledScene::compile(const vector<Object *> &objects, AccelerationMode mode)
+{
+    clear();
+    this->mode = mode;
+    if (mode == ACCELERATION_BVH)
+    {
+        bvh.build(objects);
+    }
+    else
+    {
+        compileFlat(objects);
+    }
+}
+
+bool CompiledScene::restore(const vector<Object *> &objects, const BVHNode *nodes, int nodeCount, const int *ordered,
+                            int orderedCount, const int *unbounded, int unboundedCount)
+{
+    clear();
+    mode = ACCELERATION_BVH;
+    return bvh.restore(objects, nodes, nodeCount, ordered, orderedCount, unbounded, unboundedCount);
+}
+
+void CompiledScene::compileFlat(const vector<Object *> &objects)
+{
+    for (Object *object : objects)
+    {
+        PrimitiveType type = classifyPrimitive(object);
+        if (type == PRIMITIVE_SPHERE)
+        {
+            Sphere *sphere = static_cast<Sphere *>(object);
+            Vector3D center = sphere->getCenter();
+            sphereCenterX.push_back(center.x);
+            sphereCenterY.push_back(center.y);
+            sphereCenterZ.push_back(center.z);
+            sphereRadius.push_back(sphere->getRadius());
+            sphereObjects.push_back(object);
+        }
+        else if (type == PRIMITIVE_TRIANGLE)
+        {
+            Triangle *triangle = static_cast<Triangle *>(object);
+            Vector3D vertices[3] = {triangle->getVertexA(), triangle->getVertexB(), triangle->getVertexC()};
+            Vector3D normal = triangle->computeNormal(vertices[0]);
+            for (int k = 0; k < 3; k++)
+            {
+                Vector3D edge = vertices[(k + 1) % 3] - vertices[k];
+                triangleVertexX[k].push_back(vertices[k].x);
+                triangleVertexY[k].push_back(vertices[k].y);
+                triangleVertexZ[k].push_back(vertices[k].z);
+                triangleEdgeX[k].push_back(edge.x);
+                triangleEdgeY[k].push_back(edge.y);
+                triangleEdgeZ[k].push_back(edge.z);
+            }
+            triangleNormalX.push_back(normal.x);
+            triangleNormalY.push_back(normal.y);
+            triangleNormalZ.push_back(normal.z);
+            triangleObjects.push_back(object);
+        }
+        else if (type == PRIMITIVE_GENERAL)
+        {
+            generalObjects.push_back(static_cast<General *>(object));
+        }
+        else if (type == PRIMITIVE_FLOOR)
+        {
+            floorObjects.push_back(static_cast<Floor *>(object));
+        }
+        else if (type == PRIMITIVE_MESH)
+        {
+            meshObjects.push_back(static_cast<TriangleMesh *>(object));
+        }
+        else
+        {
+            otherObjects.push_back(object);
+        }
+    }
+
+    padToBlock();
+    updateViews();
+}
+
+void CompiledScene::padToBlock()
+{
+    size_t sphereCount = roundUpToBlock(sphereObjects.size());
+    padWithNaN(sphereCenterX, sphereCount);
+    padWithNaN(sphereCenterY, sphereCount);
+    padWithNaN(sphereCenterZ, sphereCount);
+    padWithNaN(sphereRadius, sphereCount);
+
+    size_t triangleCount = roundUpToBlock(triangleObjects.size());
+    for (int k = 0; k < 3; k++)
+    {
+        padWithNaN(triangleVertexX[k], triangleCount);
+        padWithNaN(triangleVertexY[k], triangleCount);
+        padWithNaN(triangleVertexZ[k], triangleCount);
+        padWithNaN(triangleEdgeX[k], triangleCount);
+        padWithNaN(triangleEdgeY[k], triangleCount);
+        padWithNaN(triangleEdgeZ[k], triangleCount);
+    }
+    padWithNaN(triangleNormalX, triangleCount);
+    padWithNaN(triangleNormalY, triangleCount);
+    padWithNaN(triangleNormalZ, triangleCount);
+}
+
+// The views hold raw pointers into the vectors, so they are refreshed after every change
+void CompiledScene::updateViews()
+{
+    spheres.centerX = sphereCenterX.data();
+    spheres.centerY = sphereCenterY.data();
+    spheres.centerZ = sphereCenterZ.data();
+    spheres.radius = sphereRadius.data();
+    spheres.count = sphereCenterX.size();
+
+    for (int k = 0; k < 3; k++)
+    {
+        triangles.vertexX[k] = triangleVertexX[k].data();
+        triangles.vertexY[k] = triangleVertexY[k].data();
+        triangles.vertexZ[k] = triangleVertexZ[k].data();
+        triangles.edgeX[k] = triangleEdgeX[k].data();
+        triangles.edgeY[k] = triangleEdgeY[k].data();
+        triangles.edgeZ[k] = triangleEdgeZ[k].data();
+    }
+    triangles.normalX = triangleNormalX.data();
+    triangles.normalY = triangleNormalY.data();
+    triangles.normalZ = triangleNormalZ.data();
+    triangles.count = triangleNormalX.size();
+}
+
+bool CompiledScene::closestHitFlat(const Ray &ray, double tMin, double tMax, HitRecord &hit) const
+{
+    const PacketKernels &kernels = getPacketKernels();
+    double tHit = tMax;
+    Object *nearest = nullptr;
+    countStat(STAT_SPHERE_TESTS, sphereObjects.size());
+    countStat(STAT_TRIANGLE_TESTS, triangleObjects.size());
+
+    int index = kernels.nearestSphere(spheres, ray, tMin, tHit);
+    if (index >= 0)
+    {
+        nearest = sphereObjects[index];
+    }
+    index = kernels.nearestTriangle(triangles, ray, tMin, epsilon, tHit);
+    if (index >= 0)
+    {
+        nearest = triangleObjects[index];
+    }
+
+    hit.t = tHit;
+    hit.object = nearest;
+    closestHitInList(floorObjects, ray, tMin, hit);
+    closestHitInList(meshObjects, ray, tMin, hit);
+    closestHitInList(generalObjects, ray, tMin, hit);
+    closestHitInList(otherObjects, ray, tMin, hit);
+    return hit.object != nullptr;
+}
+
+bool CompiledScene::closestHit(const Ray &ray, double tMin, double tMax, HitRecord &hit) const
+{
+    if (mode == ACCELERATION_BVH)
+    {
+        return bvh.closestHit(ray, tMin, tMax, hit);
+    }
+    return closestHitFlat(ray, tMin, tMax, hit);
+}
+
+bool CompiledScene::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) const
+{
+    if (!closestHit(ray, tMin, tMax, hit))
+    {
+        return false;
+    }
+    hit.object->completeHit(ray, hit);
+    return true;
+}
+
+Object *CompiledScene::anyHit(const Ray &ray, double tMin, double tMax) const
+{
+    if (mode == ACCELERATION_BVH)
+    {
+        return bvh.anyHit(ray, tMin, tMax);
+    }
+
+    // The kernels always scan a whole array, so the only early out is between arrays
+    const PacketKernels &kernels = getPacketKernels();
+    double tHit = tMax;
+    countStat(STAT_SPHERE_TESTS, sphereObjects.size());
+    int index = kernels.nearestSphere(spheres, ray, tMin, tHit);
+    if (index >= 0)
+    {
+        return sphereObjects[index];
+    }
+    countStat(STAT_TRIANGLE_TESTS, triangleObjects.size());
+    index = kernels.nearestTriangle(triangles, ray, tMin, epsilon, tHit);
+    if (index >= 0)
+    {
+        return triangleObjects[index];
+    }
+
+    Object *occluder = anyHitInList(floorObjects, ray, tMin, tMax);
+    if (occluder == nullptr)
+    {
+        occluder = anyHitInList(meshObjects, ray, tMin, tMax);
+    }
+    if (occluder == nullptr)
+    {
+        occluder = anyHitInList(generalObjects, ray, tMin, tMax);
+    }
+    if (occluder == nullptr)
+    {
+        occluder = anyHitInList(otherObjects, ray, tMin, tMax);
+    }
+    return occluder;
+}
+
+void CompiledScene::closestHitPacket(const RayPacket &packet, PacketHit &hits) const
+{
+    if (mode == ACCELERATION_BVH)
+    {
+        bvh.closestHitPacket(packet, hits);
+        return;
+    }
+
+    // Flat mode vectorizes across primitives instead, so lanes are traced one at a time
+    for (int lane = 0; lane < PACKET_SIZE; lane++)
+    {
+        HitRecord hit;
+        if (packet.isActive(lane) && closestHitFlat(packet.getRay(lane), packet.tMin[lane], hits.t[lane], hit))
+        {
+            hits.t[lane] = hit.t;
+            hits.object[lane] = hit.object;
+        }
+    }
+}
+
+AccelerationMode CompiledScene::getMode() const
+{
+    return mode;
+}
+
+const BVH &CompiledScene::getHierarchy() const
+{
+    return bvh;
+}
+
+ostream &operator<<(ostream &out, const CompiledScene &scene)
+{
+    if (scene.mode == ACCELERATION_BVH)
+    {
+        out << scene.bvh;
+    }
+    else
+    {
+        out << "Flat scene: " << scene.sphereObjects.size() << " spheres, "
+            << scene.triangleObjects.size() << " triangles in " << PRIMITIVE_BLOCK << "-wide blocks, "
+            << scene.floorObjects.size() << " floors, " << scene.meshObjects.size() << " meshes, " << scene.generalObjects.size() << " quadrics, "
+            << scene.otherObjects.size() << " other objects";
+    }
+    return out;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include "../BVH/2005107_BVH.h"
+#include "../RayPacket/2005107_RayPacket.h"
+
+enum AccelerationMode
+{
+    ACCELERATION_BVH, // hierarchy over all objects; best for static scenes
+    ACCELERATION_FLAT // no build step, every primitive tested with the SoA kernels
+};
+
+// The scene in the form the renderer queries it. In flat mode spheres and
+// triangles are copied into structure-of-arrays storage and scanned
+// PRIMITIVE_BLOCK at a time, so compiling is a plain copy and edited scenes can
+// be recompiled every frame. The remaining primitives are grouped by concrete
+// type so their loops call intersect directly instead of through the vtable.
+class CompiledScene
+{
+private:
+    AccelerationMode mode;
+    BVH bvh;
+
+    // Entry i of each sphere array belongs to sphereObjects[i]; the same holds for triangles
+    vector<double> sphereCenterX, sphereCenterY, sphereCenterZ, sphereRadius;
+    vector<Object *> sphereObjects;
+
+    vector<double> triangleVertexX[3], triangleVertexY[3], triangleVertexZ[3];
+    vector<double> triangleEdgeX[3], triangleEdgeY[3], triangleEdgeZ[3];
+    vector<double> triangleNormalX, triangleNormalY, triangleNormalZ;
+    vector<Object *> triangleObjects;
+
+    vector<General *> generalObjects;
+    vector<Floor *> floorObjects;
+    vector<TriangleMesh *> meshObjects;
+    vector<Object *> otherObjects; // classes the scene compiler does not know
+
+    SphereArrays spheres;
+    TriangleArrays triangles;
+
+    void compileFlat(const vector<Object *> &objects);
+    void padToBlock();
+    void updateViews();
+    bool closestHitFlat(const Ray &ray, double tMin, double tMax, HitRecord &hit) const;
+
+public:
+    CompiledScene();
+
+    void compile(const vector<Object *> &objects, AccelerationMode mode);
+    // BVH mode with a hierarchy the scene cache saved; see BVH::restore
+    bool restore(const vector<Object *> &objects, const BVHNode *nodes, int nodeCount, const int *ordered,
+                 int orderedCount, const int *unbounded, int unboundedCount);
+    void clear();
+
+    // Same contracts as the BVH queries of the same name
+    bool closestHit(const Ray &ray, double tMin, double tMax, HitRecord &hit) const;
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) const;
+    Object *anyHit(const Ray &ray, double tMin, double tMax) const;
+    void closestHitPacket(const RayPacket &packet, PacketHit &hits) const;
+
+    AccelerationMode getMode() const;
+    const BVH &getHierarchy() const;
+
+    friend ostream &operator<<(ostream &out, const CompiledScene &scene);
+};
@@ -0,0 +1,26 @@
+#include "2005107_PrimitiveDispatch.h"
+
+PrimitiveType classifyPrimitive(Object *object)
+{
+    if (dynamic_cast<Sphere *>(object) != nullptr)
+    {
+        return PRIMITIVE_SPHERE;
+    }
+    if (dynamic_cast<Triangle *>(object) != nullptr)
+    {
+        return PRIMITIVE_TRIANGLE;
+    }
+    if (dynamic_cast<General *>(object) != nullptr)
+    {
+        return PRIMITIVE_GENERAL;
+    }
+    if (dynamic_cast<Floor *>(object) != nullptr)
+    {
+        return PRIMITIVE_FLOOR;
+    }
+    if (dynamic_cast<TriangleMesh *>(object) != nullptr)
+    {
+        return PRIMITIVE_MESH;
+    }
+    return PRIMITIVE_OTHER;
+}
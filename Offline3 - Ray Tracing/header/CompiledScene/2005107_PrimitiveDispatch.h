@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "../Object/2005107_Object.h"
+#include "../Sphere/2005107_Sphere.h"
+#include "../Triangle/2005107_Triangle.h"
+#include "../General/2005107_General.h"
+#include "../Floor/2005107_Floor.h"
+#include "../TriangleMesh/2005107_TriangleMesh.h"
+
+// Concrete primitive types the compiled scene knows about. Objects of any other
+// class keep working through the virtual Object interface.
+enum PrimitiveType
+{
+    PRIMITIVE_SPHERE,
+    PRIMITIVE_TRIANGLE,
+    PRIMITIVE_GENERAL,
+    PRIMITIVE_FLOOR,
+    PRIMITIVE_MESH,
+    PRIMITIVE_OTHER
+};
+
+PrimitiveType classifyPrimitive(Object *object);
+
+// The primitive classes are final, so a call through T * is resolved at compile
+// time: each instantiation is a direct call the compiler is free to inline
+template <class T>
+inline bool intersectAs(Object *object, const Ray &ray, double tMin, double tMax, HitRecord &hit)
+{
+    return static_cast<T *>(object)->intersect(ray, tMin, tMax, hit);
+}
+
+inline bool intersectPrimitive(PrimitiveType type, Object *object, const Ray &ray, double tMin, double tMax, HitRecord &hit)
+{
+    switch (type)
+    {
+    case PRIMITIVE_SPHERE:
+        return intersectAs<Sphere>(object, ray, tMin, tMax, hit);
+    case PRIMITIVE_TRIANGLE:
+        return intersectAs<Triangle>(object, ray, tMin, tMax, hit);
+    case PRIMITIVE_GENERAL:
+        return intersectAs<General>(object, ray, tMin, tMax, hit);
+    case PRIMITIVE_FLOOR:
+        return intersectAs<Floor>(object, ray, tMin, tMax, hit);
+    case PRIMITIVE_MESH:
+        return intersectAs<TriangleMesh>(object, ray, tMin, tMax, hit);
+    default:
+        return object->intersect(ray, tMin, tMax, hit);
+    }
+}
+
+// Nearest hit over a list holding a single type; lowers hit.t as it goes.
+// Instantiated with Object, these fall back to ordinary virtual calls.
+template <class T>
+inline bool closestHitInList(const vector<T *> &list, const Ray &ray, double tMin, HitRecord &hit)
+{
+    bool found = false;
+    for (T *object : list)
+    {
+        found |= object->intersect(ray, tMin, hit.t, hit);
+    }
+    return found;
+}
+
+template <class T>
+inline Object *anyHitInList(const vector<T *> &list, const Ray &ray, double tMin, double tMax)
+{
+    HitRecord hit;
+    for (T *object : list)
+    {
+        if (object->intersect(ray, tMin, tMax, hit))
+        {
+            return object;
+        }
+    }
+    return nullptr;
+}
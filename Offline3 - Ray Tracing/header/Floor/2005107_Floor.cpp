@@ -1,11 +1,17 @@
 #include "2005107_Floor.h"
+#include "../RenderStats/2005107_RenderStats.h"
 
+#ifndef RENDER_ONLY
 #ifdef __linux__
 #include <GL/glut.h>
 #elif WIN32
 #include <glut.h>
 #include <windows.h>
 #endif
+#endif
+
+extern double fieldOfViewY;
+extern double imageHeight;
 
 Floor::Floor(double tileCount, double tileSize, double height) : Object(), tileCount(tileCount), tileSize(tileSize)
 {
@@ -15,20 +21,17 @@ Floor::Floor(double tileCount, double tileSize, double height) : Object(), tileC
     length = tileCount * tileSize;
     tileColor1 = Color(1, 1, 1);
     tileColor2 = Color(0, 0, 0);
-    textureImage = nullptr;
+    textureFilter = TEXTURE_TRILINEAR;
     useTexture = false;
 }
 
 Floor::~Floor()
 {
-    if (textureImage != nullptr) {
-        delete textureImage;
-        textureImage = nullptr;
-    }
 }
 
 void Floor::draw()
 {
+#ifndef RENDER_ONLY
     int startX = -tileCount * tileSize / 2;
     int startY = -tileCount * tileSize / 2;
     glBegin(GL_QUADS);
@@ -54,6 +57,7 @@ void Floor::draw()
         }
     }
     glEnd();
+#endif
 }
 
 Vector3D Floor::computeNormal(Vector3D point)
@@ -61,111 +65,146 @@ Vector3D Floor::computeNormal(Vector3D point)
     return Vector3D::forward();
 }
 
-double Floor::intersect(Ray *ray)
+bool Floor::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit)
 {
-    double t = (height - ray->getOrigin().z) / ray->getDirection().z;
-    if (t < 0)
+    countStat(STAT_FLOOR_TESTS);
+    double t = (height - ray.getOrigin().z) / ray.getDirection().z;
+    if (t <= tMin || t >= tMax)
     {
-        return -1.0;
+        return false;
     }
-    Vector3D intersectionPoint = ray->getOrigin() + ray->getDirection() * t;
+    Vector3D intersectionPoint = ray.getOrigin().mulAdd(ray.getDirection(), t);
     if (intersectionPoint.x < referencePoint.x || intersectionPoint.x > referencePoint.x + width || intersectionPoint.y < referencePoint.y || intersectionPoint.y > referencePoint.y + length)
     {
-        return -1.0;
+        return false;
+    }
+    hit.t = t;
+    hit.object = this;
+    return true;
+}
+
+void Floor::completeHit(const Ray &ray, HitRecord &hit)
+{
+    hit.point = ray.getOrigin().mulAdd(ray.getDirection(), hit.t);
+    hit.normal = computeNormal(hit.point);
+    computeTileCoordinates(hit.point, hit.u, hit.v);
+    if (useTexture && !texture.empty()) {
+        hit.color = sampleTexture(hit.u, hit.v, sampleFootprint(ray, hit.t));
+    } else {
+        hit.color = checkerColor(hit.point);
     }
-    return t;
+}
+
+void Floor::intersectPacket(const RayPacket &packet, PacketHit &hits)
+{
+    countStat(STAT_FLOOR_TESTS, packet.activeCount());
+    double minimumXY[2] = {referencePoint.x, referencePoint.y};
+    double maximumXY[2] = {referencePoint.x + width, referencePoint.y + length};
+    hits.setObject(getPacketKernels().floor(packet, height, minimumXY, maximumXY, hits.t), this);
+}
+
+AABB Floor::getBounds()
+{
+    return AABB(Vector3D(referencePoint.x, referencePoint.y, height), Vector3D(referencePoint.x + width, referencePoint.y + length, height));
 }
 
 Color Floor::getSurfaceColor(Vector3D point)
 {
-    if (useTexture && textureImage != nullptr) {
-        // Calculate which tile we're in
-        int tileX = (int)((point.x - referencePoint.x) / tileSize);
-        int tileY = (int)((point.y - referencePoint.y) / tileSize);
-        
-        // Calculate position within the tile (0 to 1)
-        double localX = (point.x - referencePoint.x) - tileX * tileSize;
-        double localY = (point.y - referencePoint.y) - tileY * tileSize;
-        
-        // Convert to texture coordinates (0 to 1) within the tile
-        double u = localX / tileSize;
-        double v = localY / tileSize;
-        
-        // Clamp u and v to [0, 1] range
-        u = max(0.0, min(1.0, u));
-        v = max(0.0, min(1.0, v));
-        
+    if (useTexture && !texture.empty()) {
+        double u, v;
+        computeTileCoordinates(point, u, v);
         return sampleTexture(u, v);
     } else {
-        // Default checkerboard pattern
-        int x = (point.x - referencePoint.x) / tileSize;
-        int y = (point.y - referencePoint.y) / tileSize;
-        if ((x + y) % 2 == 0) {
-            return tileColor1;
-        } else {
-            return tileColor2;
-        }
+        return checkerColor(point);
     }
 }
 
-void Floor::setTexture(const string& texturePath)
+// Texture coordinates (0 to 1) of a point within the tile containing it
+void Floor::computeTileCoordinates(Vector3D point, double &u, double &v)
 {
-    // Clean up existing texture if any
-    if (textureImage != nullptr) {
-        delete textureImage;
-        textureImage = nullptr;
-    }
+    // Calculate which tile we're in
+    int tileX = (int)((point.x - referencePoint.x) / tileSize);
+    int tileY = (int)((point.y - referencePoint.y) / tileSize);
     
-    // Load new texture
-    textureImage = new bitmap_image(texturePath);
+    // Calculate position within the tile (0 to 1)
+    double localX = (point.x - referencePoint.x) - tileX * tileSize;
+    double localY = (point.y - referencePoint.y) - tileY * tileSize;
+    
+    // Convert to texture coordinates (0 to 1) within the tile
+    u = localX / tileSize;
+    v = localY / tileSize;
+    
+    // Clamp u and v to [0, 1] range
+    u = max(0.0, min(1.0, u));
+    v = max(0.0, min(1.0, v));
+}
+
+// Default checkerboard pattern
+Color Floor::checkerColor(Vector3D point)
+{
+    int x = (point.x - referencePoint.x) / tileSize;
+    int y = (point.y - referencePoint.y) / tileSize;
+    if ((x + y) % 2 == 0) {
+        return tileColor1;
+    } else {
+        return tileColor2;
+    }
+}
+
+void Floor::setTexture(const string& texturePath)
+{
+    // The bitmap is only needed while the float pyramid is built
+    bitmap_image image(texturePath);
     
     // Check if texture loaded successfully
-    if (textureImage->width() > 0 && textureImage->height() > 0) {
+    if (image.width() > 0 && image.height() > 0) {
+        texture.build(image);
         useTexture = true;
-        cout << "Texture loaded successfully: " << texturePath << " (" << textureImage->width() << "x" << textureImage->height() << ")" << endl;
+        cout << "Texture loaded successfully: " << texturePath << " (" << image.width() << "x" << image.height() << ", "
+             << texture.getLevelCount() << " mip levels, " << texture.getMemoryUsage() / 1024 << " KiB, "
+             << textureFilterName(textureFilter) << " filtering)" << endl;
     } else {
         cout << "Failed to load texture: " << texturePath << endl;
-        delete textureImage;
-        textureImage = nullptr;
+        texture.clear();
         useTexture = false;
     }
 }
 
+void Floor::setTextureFilter(TextureFilter filter)
+{
+    textureFilter = filter;
+}
+
 void Floor::disableTexture()
 {
     useTexture = false;
-    if (textureImage != nullptr) {
-        delete textureImage;
-        textureImage = nullptr;
-    }
+    texture.clear();
 }
 
-Color Floor::sampleTexture(double u, double v)
+// Width of one pixel's footprint on the floor, in tile units. The spread of a
+// primary pixel grows with distance and stretches by 1 / cos(incidence) along
+// the view direction; the geometric mean of the two axes is used, which keeps
+// grazing views from blurring as much as the longer axis would. Reflected rays
+// only count their own segment, so they pick a slightly sharper level.
+double Floor::sampleFootprint(const Ray &ray, double t)
 {
-    if (!textureImage || textureImage->width() <= 0 || textureImage->height() <= 0) {
+    double pixelSpread = 2.0 * tan(degreeToRadian(fieldOfViewY / 2.0)) / imageHeight;
+    double cosine = max(fabs((double)ray.getDirection().z), 1e-3);
+    return t * pixelSpread / sqrt(cosine) / tileSize;
+}
+
+Color Floor::sampleTexture(double u, double v, double footprint)
+{
+    if (texture.empty()) {
         return Color(0.5, 0.5, 0.5); // Gray fallback
     }
     
-    // Clamp u and v to [0,1]
-    u = max(0.0, min(1.0, u));
-    v = max(0.0, min(1.0, v));
-    
-    // Normalized -> pixel coords
-    int pixelX = (int)(u * (textureImage->width() - 1));
-    int pixelY = (int)((1.0 - v) * (textureImage->height() - 1)); // Flip Y
-    
-    // Safety clamp
-    pixelX = max(0, min((int)textureImage->width() - 1, pixelX));
-    pixelY = max(0, min((int)textureImage->height() - 1, pixelY));
-    
-    // Get pixel color
-    unsigned char r, g, b;
-    textureImage->get_pixel(pixelX, pixelY, r, g, b);
-    
-    Color color;
-    color.red = r / 255.0;
-    color.green = g / 255.0;
-    color.blue = b / 255.0;
-    
-    return color;
+    switch (textureFilter) {
+    case TEXTURE_NEAREST:
+        return texture.sampleNearest(u, v);
+    case TEXTURE_BILINEAR:
+        return texture.sampleBilinear(u, v);
+    default:
+        return texture.sampleTrilinear(u, v, texture.levelOfDetail(footprint));
+    }
 }
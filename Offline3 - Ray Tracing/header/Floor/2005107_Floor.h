@@ -5,12 +5,13 @@ using namespace std;
 
 #include "../Object/2005107_Object.h"
 #include "../Color/2005107_Color.h"
-#include "../../bitmap_image.hpp"
+#include "../MipmapTexture/2005107_MipmapTexture.h"
 
-class Floor : public Object
+class Floor final : public Object
 {
     double tileCount, tileSize;
-    bitmap_image* textureImage;
+    MipmapTexture texture;
+    TextureFilter textureFilter;
     bool useTexture;
 
 public:
@@ -19,11 +20,19 @@ public:
     ~Floor();
     void draw();
     Vector3D computeNormal(Vector3D point);
-    double intersect(Ray *ray);
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit);
+    void completeHit(const Ray &ray, HitRecord &hit);
+    void intersectPacket(const RayPacket &packet, PacketHit &hits);
+    AABB getBounds();
     Color getSurfaceColor(Vector3D point);
     void setTexture(const string& texturePath);
+    void setTextureFilter(TextureFilter filter);
     void disableTexture();
     
 private:
-    Color sampleTexture(double u, double v);
+    // footprint is the width of the sample on the floor in tile units; 0 means unknown
+    Color sampleTexture(double u, double v, double footprint = 0);
+    double sampleFootprint(const Ray &ray, double t);
+    void computeTileCoordinates(Vector3D point, double &u, double &v);
+    Color checkerColor(Vector3D point);
 };
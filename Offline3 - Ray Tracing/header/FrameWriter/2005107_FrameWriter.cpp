@@ -0,0 +1,83 @@
+#include "2005107_FrameWriter.h"
+#include <chrono>
+
+FrameWriter::FrameWriter(size_t maxQueued)
+    : maxQueued(maxQueued > 0 ? maxQueued : 1), stopping(false), framesWritten(0), writeSeconds(0), blockedSeconds(0)
+{
+    worker = thread(&FrameWriter::run, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+    finish();
+}
+
+void FrameWriter::submit(unique_ptr<bitmap_image> image, const string &fileName)
+{
+    auto startTime = chrono::steady_clock::now();
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this] { return queue.size() < maxQueued; });
+    blockedSeconds += chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    queue.push_back(PendingFrame{move(image), fileName});
+    changed.notify_all();
+}
+
+void FrameWriter::finish()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void FrameWriter::run()
+{
+    while (true)
+    {
+        PendingFrame frame;
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [this] { return !queue.empty() || stopping; });
+            if (queue.empty())
+            {
+                return;
+            }
+            frame = move(queue.front());
+            queue.pop_front();
+        }
+        // Frees a slot as soon as the frame is taken, so the renderer is not held up by this save
+        changed.notify_all();
+
+        auto startTime = chrono::steady_clock::now();
+        frame.image->save_image(frame.fileName);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+        lock_guard<mutex> guard(lock);
+        framesWritten++;
+        writeSeconds += seconds;
+    }
+}
+
+int FrameWriter::getFramesWritten()
+{
+    lock_guard<mutex> guard(lock);
+    return framesWritten;
+}
+
+double FrameWriter::getWriteSeconds()
+{
+    lock_guard<mutex> guard(lock);
+    return writeSeconds;
+}
+
+double FrameWriter::getBlockedSeconds()
+{
+    lock_guard<mutex> guard(lock);
+    return blockedSeconds;
+}
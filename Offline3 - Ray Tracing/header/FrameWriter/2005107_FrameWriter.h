@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+using namespace std;
+
+#include "../../bitmap_image.hpp"
+
+// Saves images on a background thread, so encoding and writing one frame
+// overlaps with rendering the next. At most maxQueued frames wait to be written;
+// submit() blocks beyond that, which bounds memory when the disk falls behind.
+class FrameWriter
+{
+private:
+    struct PendingFrame
+    {
+        unique_ptr<bitmap_image> image;
+        string fileName;
+    };
+
+    size_t maxQueued;
+    deque<PendingFrame> queue;
+    mutex lock;
+    condition_variable changed;
+    bool stopping;
+    int framesWritten;
+    double writeSeconds;   // time the writer thread spent saving
+    double blockedSeconds; // time submit() spent waiting for room in the queue
+    thread worker;
+
+    void run();
+
+public:
+    explicit FrameWriter(size_t maxQueued = 2);
+    ~FrameWriter();
+
+    void submit(unique_ptr<bitmap_image> image, const string &fileName);
+
+    // Blocks until every submitted frame is on disk, then stops the thread
+    void finish();
+
+    int getFramesWritten();
+    double getWriteSeconds();
+    double getBlockedSeconds();
+};
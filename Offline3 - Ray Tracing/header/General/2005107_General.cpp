@@ -1,19 +1,51 @@
 #include "2005107_General.h"
+#include "../RenderStats/2005107_RenderStats.h"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
+#ifndef RENDER_ONLY
 #ifdef __linux__
 #include <GL/glut.h>
 #elif WIN32
 #include <glut.h>
 #include <windows.h>
 #endif
+#endif
 
 extern double epsilon;
 
+namespace
+{
+    // Relative tolerance for coefficients that should be equal, and for a cone's
+    // constant term, which must vanish
+    const double SHAPE_TOLERANCE = 1e-12;
+
+    bool nearlyEqual(double x, double y)
+    {
+        return fabs(x - y) <= SHAPE_TOLERANCE * max(fabs(x), fabs(y));
+    }
+}
+
+const char* quadricShapeName(QuadricShape shape)
+{
+    switch (shape) {
+    case QUADRIC_SPHERE:
+        return "sphere";
+    case QUADRIC_CYLINDER:
+        return "cylinder";
+    case QUADRIC_CONE:
+        return "cone";
+    default:
+        return "general";
+    }
+}
+
 General::General() : Object(), a(0), b(0), c(0), d(0), e(0), f(0), g(0), h(0), i(0), j(0)
 {
     initializeDimensions();
+    classifyShape();
+    updateBounds();
 }
 
 General::General(double a, double b, double c, double d, double e, double f, 
@@ -21,6 +53,8 @@ General::General(double a, double b, double c, double d, double e, double f,
                  a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h), i(i), j(j)
 {
     initializeDimensions();
+    classifyShape();
+    updateBounds();
 }
 
 void General::initializeDimensions()
@@ -37,6 +71,103 @@ void General::setBoundingBox(Vector3D referencePoint, double height, double widt
     this->height = height;
     this->width = width;
     this->length = length;
+    updateBounds();
+}
+
+// Without cross terms the quadric is axis aligned, and completing the square
+// on every axis with a squared term gives sum q_k (x_k - centre_k)^2 = constant.
+// The shape follows from which q_k are equal, zero or of opposite sign.
+void General::classifyShape()
+{
+    shape = QUADRIC_GENERAL;
+    shapeAxis = 0;
+    shapeRadiusSquared = shapeSlopeSquared = 0;
+    hasNaturalBounds = false;
+    naturalBounds = AABB::infinite();
+    double squared[3] = {a, b, c};
+    double linear[3] = {g, h, i};
+    for (int k = 0; k < 3; k++) {
+        shapeCentre[k] = 0;
+    }
+
+    if (d != 0 || e != 0 || f != 0) {
+        return;
+    }
+
+    double constant = -j, magnitude = fabs(j);
+    for (int k = 0; k < 3; k++) {
+        if (squared[k] != 0) {
+            shapeCentre[k] = -linear[k] / (2 * squared[k]);
+            constant += squared[k] * shapeCentre[k] * shapeCentre[k];
+            magnitude = max(magnitude, fabs(squared[k] * shapeCentre[k] * shapeCentre[k]));
+        } else if (linear[k] != 0) {
+            return; // parabolic along this axis
+        }
+    }
+
+    // When every squared term has the constant's sign, none can exceed it
+    hasNaturalBounds = constant != 0;
+    for (int k = 0; k < 3; k++) {
+        if (squared[k] != 0 && !(squared[k] * constant > 0)) {
+            hasNaturalBounds = false;
+        }
+    }
+    if (hasNaturalBounds) {
+        double minimum[3] = {naturalBounds.minimum.x, naturalBounds.minimum.y, naturalBounds.minimum.z};
+        double maximum[3] = {naturalBounds.maximum.x, naturalBounds.maximum.y, naturalBounds.maximum.z};
+        for (int k = 0; k < 3; k++) {
+            if (squared[k] != 0) {
+                double halfExtent = sqrt(constant / squared[k]);
+                minimum[k] = shapeCentre[k] - halfExtent;
+                maximum[k] = shapeCentre[k] + halfExtent;
+            }
+        }
+        naturalBounds = AABB(Vector3D(minimum[0], minimum[1], minimum[2]), Vector3D(maximum[0], maximum[1], maximum[2]));
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        double across = squared[u];
+        if (across == 0 || !nearlyEqual(across, squared[v])) {
+            continue;
+        }
+        if (nearlyEqual(squared[axis], across) && constant / across > 0) {
+            shape = QUADRIC_SPHERE;
+            shapeRadiusSquared = constant / across;
+            return;
+        }
+        if (squared[axis] == 0 && constant / across > 0) {
+            shape = QUADRIC_CYLINDER;
+            shapeAxis = axis;
+            shapeRadiusSquared = constant / across;
+            return;
+        }
+        if (squared[axis] * across < 0 && fabs(constant) <= SHAPE_TOLERANCE * magnitude) {
+            shape = QUADRIC_CONE;
+            shapeAxis = axis;
+            shapeSlopeSquared = -squared[axis] / across;
+            return;
+        }
+    }
+}
+
+void General::updateBounds()
+{
+    bounds = computeBounds();
+    boundsRejectRays = bounds.minimum.x > -numeric_limits<double>::infinity() || bounds.minimum.y > -numeric_limits<double>::infinity() ||
+                       bounds.minimum.z > -numeric_limits<double>::infinity() || bounds.maximum.x < numeric_limits<double>::infinity() ||
+                       bounds.maximum.y < numeric_limits<double>::infinity() || bounds.maximum.z < numeric_limits<double>::infinity();
+
+    // Hit points are rounded, so one on the surface may land just outside the
+    // exact box; the padding keeps the early rejection from losing such hits
+    double magnitude = 0;
+    double corners[6] = {bounds.minimum.x, bounds.minimum.y, bounds.minimum.z, bounds.maximum.x, bounds.maximum.y, bounds.maximum.z};
+    for (double coordinate : corners) {
+        if (std::isfinite(coordinate)) {
+            magnitude = max(magnitude, fabs(coordinate));
+        }
+    }
+    bounds.pad(max(epsilon, magnitude * 64 * numeric_limits<Real>::epsilon()));
 }
 
 bool General::isWithinDimension(double value, double minBound, double maxBound) const
@@ -152,52 +283,165 @@ double General::calculateCoefficientC(const Vector3D& origin) const
            j;
 }
 
-// Find valid intersection within bounding box
+// Coefficients of the closed-form shapes, relative to their centre; the same
+// roots as the full quadric, which is the shape scaled by a constant
+bool General::solveShape(const Vector3D& origin, const Vector3D& direction, QuadraticSolution& solution) const
+{
+    double o[3] = {origin.x - shapeCentre[0], origin.y - shapeCentre[1], origin.z - shapeCentre[2]};
+    double dir[3] = {direction.x, direction.y, direction.z};
+    double A, B, C;
+    if (shape == QUADRIC_SPHERE) {
+        A = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+        B = 2 * (o[0] * dir[0] + o[1] * dir[1] + o[2] * dir[2]);
+        C = o[0] * o[0] + o[1] * o[1] + o[2] * o[2] - shapeRadiusSquared;
+    } else {
+        int k = shapeAxis, u = (k + 1) % 3, v = (k + 2) % 3;
+        A = dir[u] * dir[u] + dir[v] * dir[v];
+        B = 2 * (o[u] * dir[u] + o[v] * dir[v]);
+        C = o[u] * o[u] + o[v] * o[v];
+        if (shape == QUADRIC_CYLINDER) {
+            C -= shapeRadiusSquared;
+        } else {
+            A -= shapeSlopeSquared * dir[k] * dir[k];
+            B -= 2 * shapeSlopeSquared * o[k] * dir[k];
+            C -= shapeSlopeSquared * o[k] * o[k];
+        }
+    }
+    solution = solveQuadraticEquation(A, B, C);
+    return solution.hasRealRoots;
+}
+
+// Find valid intersection within bounding box and (tMin, tMax)
 double General::findValidIntersection(const Vector3D& origin, const Vector3D& direction, 
-                                     double t1, double t2) const
+                                     double t1, double t2, double tMin, double tMax) const
 {
-    // Both intersection points are behind the ray origin
-    if (t2 < epsilon) {
-        return -1.0;
+    // Check the closest root first; roots behind the ray origin are skipped
+    double roots[2] = {t1, t2};
+    for (double t : roots) {
+        if (!(t >= epsilon && t > tMin && t < tMax)) {
+            continue;
+        }
+        Vector3D intersectionPoint = origin + direction * t;
+        if (insideBoundingBox(intersectionPoint)) {
+            return t;
+        }
     }
     
-    // First intersection is behind, check second
-    if (t1 < epsilon) {
-        Vector3D intersectionPoint2 = origin + direction * t2;
-        return insideBoundingBox(intersectionPoint2) ? t2 : -1.0;
+    return -1.0;
+}
+
+bool General::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit)
+{
+    countStat(STAT_GENERAL_TESTS);
+    Vector3D rayOrigin = ray.getOrigin();
+    Vector3D rayDirection = ray.getDirection();
+
+    // Rays that miss the clipped extent never reach the solve
+    if (boundsRejectRays) {
+        Vector3D inverseDirection(1.0 / rayDirection.x, 1.0 / rayDirection.y, 1.0 / rayDirection.z);
+        double tEntry;
+        if (!bounds.intersect(rayOrigin, inverseDirection, tMin, tMax, tEntry)) {
+            return false;
+        }
     }
-    
-    // Both intersections are in front, check closest first
-    Vector3D intersectionPoint1 = origin + direction * t1;
-    if (insideBoundingBox(intersectionPoint1)) {
-        return t1;
+
+    QuadraticSolution solution;
+    if (shape != QUADRIC_GENERAL) {
+        if (!solveShape(rayOrigin, rayDirection, solution)) {
+            return false;
+        }
+    } else {
+        // Calculate quadratic equation coefficients: At^2 + Bt + C = 0
+        double A = calculateCoefficientA(rayDirection);
+        double B = calculateCoefficientB(rayOrigin, rayDirection);
+        double C = calculateCoefficientC(rayOrigin);
+
+        // Solve quadratic equation
+        solution = solveQuadraticEquation(A, B, C);
+        if (!solution.hasRealRoots) {
+            return false;
+        }
     }
     
-    Vector3D intersectionPoint2 = origin + direction * t2;
-    if (insideBoundingBox(intersectionPoint2)) {
-        return t2;
+    // Find valid intersection point within bounding box
+    double t = findValidIntersection(rayOrigin, rayDirection, solution.t1, solution.t2, tMin, tMax);
+    if (t < 0) {
+        return false;
     }
-    
-    return -1.0;
+    hit.t = t;
+    hit.object = this;
+    return true;
 }
 
-double General::intersect(Ray *ray)
+void General::intersectPacket(const RayPacket &packet, PacketHit &hits)
 {
-    Vector3D rayOrigin = ray->getOrigin();
-    Vector3D rayDirection = ray->getDirection();
-    
-    // Calculate quadratic equation coefficients: At^2 + Bt + C = 0
-    double A = calculateCoefficientA(rayDirection);
-    double B = calculateCoefficientB(rayOrigin, rayDirection);
-    double C = calculateCoefficientC(rayOrigin);
-    
-    // Solve quadratic equation
-    QuadraticSolution solution = solveQuadraticEquation(A, B, C);
-    
-    if (!solution.hasRealRoots) {
-        return -1.0;
+    countStat(STAT_GENERAL_TESTS, packet.activeCount());
+    double coefficients[10] = {a, b, c, d, e, f, g, h, i, j};
+
+    // Same clipping rule as insideBoundingBox(): unclipped axes accept everything
+    double inf = numeric_limits<double>::infinity();
+    double boxMinimum[3] = {-inf, -inf, -inf};
+    double boxMaximum[3] = {inf, inf, inf};
+    if (fabs(width) > epsilon) {
+        boxMinimum[0] = referencePoint.x;
+        boxMaximum[0] = referencePoint.x + width;
     }
-    
-    // Find valid intersection point within bounding box
-    return findValidIntersection(rayOrigin, rayDirection, solution.t1, solution.t2);
+    if (fabs(height) > epsilon) {
+        boxMinimum[1] = referencePoint.y;
+        boxMaximum[1] = referencePoint.y + height;
+    }
+    if (fabs(length) > epsilon) {
+        boxMinimum[2] = referencePoint.z;
+        boxMaximum[2] = referencePoint.z + length;
+    }
+
+    hits.setObject(getPacketKernels().quadric(packet, coefficients, boxMinimum, boxMaximum, epsilon, hits.t), this);
+}
+
+AABB General::getBounds()
+{
+    return bounds;
+}
+
+// A zero dimension means the quadric is not clipped along that axis; the
+// result is tightened to the quadric's own extent when it has one
+AABB General::computeBounds() const
+{
+    AABB bounds = AABB::infinite();
+    if (fabs(width) > epsilon) {
+        bounds.minimum.x = min((double)referencePoint.x, referencePoint.x + width);
+        bounds.maximum.x = max((double)referencePoint.x, referencePoint.x + width);
+    }
+    if (fabs(height) > epsilon) {
+        bounds.minimum.y = min((double)referencePoint.y, referencePoint.y + height);
+        bounds.maximum.y = max((double)referencePoint.y, referencePoint.y + height);
+    }
+    if (fabs(length) > epsilon) {
+        bounds.minimum.z = min((double)referencePoint.z, referencePoint.z + length);
+        bounds.maximum.z = max((double)referencePoint.z, referencePoint.z + length);
+    }
+    if (hasNaturalBounds) {
+        bounds.minimum = Vector3D(max(bounds.minimum.x, naturalBounds.minimum.x), max(bounds.minimum.y, naturalBounds.minimum.y),
+                                  max(bounds.minimum.z, naturalBounds.minimum.z));
+        bounds.maximum = Vector3D(min(bounds.maximum.x, naturalBounds.maximum.x), min(bounds.maximum.y, naturalBounds.maximum.y),
+                                  min(bounds.maximum.z, naturalBounds.maximum.z));
+    }
+    return bounds;
+}
+
+QuadricShape General::getShape() const
+{
+    return shape;
+}
+
+void General::getDefinition(double coefficients[10], double box[6]) const
+{
+    double values[10] = {a, b, c, d, e, f, g, h, i, j};
+    copy(values, values + 10, coefficients);
+    box[0] = referencePoint.x;
+    box[1] = referencePoint.y;
+    box[2] = referencePoint.z;
+    box[3] = height;
+    box[4] = width;
+    box[5] = length;
 }
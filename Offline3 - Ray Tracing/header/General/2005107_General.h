@@ -8,20 +8,49 @@ struct QuadraticSolution {
     double t1, t2;
 };
 
-class General : public Object
+// What a quadric turns out to be once its coefficients are known. Axis
+// aligned spheres, cylinders and cones are intersected in closed form around
+// their centre, which needs far fewer operations than the full 10-term quadric.
+enum QuadricShape {
+    QUADRIC_GENERAL,
+    QUADRIC_SPHERE,   // |p - centre|^2 = radius^2
+    QUADRIC_CYLINDER, // distance from the axis through centre = radius
+    QUADRIC_CONE      // distance from the axis = slope * distance along it from the apex (centre)
+};
+
+const char* quadricShapeName(QuadricShape shape);
+
+class General final : public Object
 {
 private:
     double a, b, c, d, e, f, g, h, i, j; // Quadric coefficients
-    
+
+    // Set from the coefficients at construction
+    QuadricShape shape;
+    double shapeCentre[3];        // sphere centre, a point on the cylinder axis, cone apex
+    int shapeAxis;                // cylinder and cone axis (0 = x, 1 = y, 2 = z)
+    double shapeRadiusSquared;    // sphere and cylinder
+    double shapeSlopeSquared;     // cone
+    bool hasNaturalBounds;        // ellipsoids and elliptic cylinders are finite across their axes
+    AABB naturalBounds;
+    // The clipping box, tightened to the natural bounds and padded for rounding;
+    // rays that miss it are rejected before any quadric is solved
+    AABB bounds;
+    bool boundsRejectRays;        // false when bounds is infinite on every axis
+
     // Helper methods
     void initializeDimensions();
+    void classifyShape();
+    void updateBounds();
+    AABB computeBounds() const;
+    bool solveShape(const Vector3D& origin, const Vector3D& direction, QuadraticSolution& solution) const;
     bool isWithinDimension(double value, double minBound, double maxBound) const;
     QuadraticSolution solveQuadraticEquation(double A, double B, double C) const;
     double calculateCoefficientA(const Vector3D& direction) const;
     double calculateCoefficientB(const Vector3D& origin, const Vector3D& direction) const;
     double calculateCoefficientC(const Vector3D& origin) const;
     double findValidIntersection(const Vector3D& origin, const Vector3D& direction, 
-                               double t1, double t2) const;
+                               double t1, double t2, double tMin, double tMax) const;
 
 public:
     General();
@@ -33,5 +62,11 @@ public:
     
     void draw() override;
     Vector3D computeNormal(Vector3D point) override;
-    double intersect(Ray *ray) override;
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) override;
+    void intersectPacket(const RayPacket &packet, PacketHit &hits) override;
+    AABB getBounds() override;
+    QuadricShape getShape() const;
+    // The numbers the scene file gives: the ten coefficients, then the
+    // reference point, height, width and length of the clipping box
+    void getDefinition(double coefficients[10], double box[6]) const;
 };
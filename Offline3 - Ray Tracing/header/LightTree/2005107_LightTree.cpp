@@ -0,0 +1,261 @@
+#include "2005107_LightTree.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Slack on the cone test, so rounding never culls a light sampleLight() would accept at its cutoff
+    const double CONE_TOLERANCE = 1e-6;
+    // Largest u that stays below 1 after rescaling at each level
+    const double LARGEST_BELOW_ONE = 1 - 1e-12;
+
+    double clampUnit(double value)
+    {
+        return min(1.0, max(-1.0, value));
+    }
+
+    double colorPower(const Color &color)
+    {
+        return (color.getRed() + color.getGreen() + color.getBlue()) / 3;
+    }
+
+    int depthOf(const vector<LightNode> &nodes, int nodeIndex)
+    {
+        const LightNode &node = nodes[nodeIndex];
+        if (node.light >= 0)
+        {
+            return 1;
+        }
+        return 1 + max(depthOf(nodes, nodeIndex + 1), depthOf(nodes, node.secondChild));
+    }
+}
+
+LightCone LightCone::everywhere()
+{
+    LightCone cone;
+    cone.axis = Vector3D::forward();
+    cone.spread = M_PI;
+    cone.cutoff = 0;
+    return cone;
+}
+
+// Smallest cone around both, as in Conty Estevez and Kulla's light trees
+LightCone LightCone::merge(const LightCone &a, const LightCone &b)
+{
+    LightCone merged = a;
+    merged.cutoff = max(a.cutoff, b.cutoff);
+    if (a.spread >= M_PI || b.spread >= M_PI)
+    {
+        merged.spread = M_PI;
+        return merged;
+    }
+
+    double between = acos(clampUnit(a.axis * b.axis));
+    if (min(between + b.spread, M_PI) <= a.spread)
+    {
+        return merged;
+    }
+    if (min(between + a.spread, M_PI) <= b.spread)
+    {
+        merged.axis = b.axis;
+        merged.spread = b.spread;
+        return merged;
+    }
+
+    double spread = (a.spread + between + b.spread) / 2;
+    Vector3D turnAxis = a.axis.cross(b.axis);
+    if (spread >= M_PI || turnAxis.length() < CONE_TOLERANCE)
+    {
+        merged.spread = M_PI;
+        return merged;
+    }
+
+    // a's axis turned towards b's until the cone just covers both
+    turnAxis.normalize();
+    double turn = spread - a.spread;
+    merged.axis = a.axis * cos(turn) + turnAxis.cross(a.axis) * sin(turn);
+    merged.axis.normalize();
+    merged.spread = spread;
+    return merged;
+}
+
+LightTree::LightTree() : lightCount(0)
+{
+}
+
+void LightTree::clear()
+{
+    nodes.clear();
+    lightCount = 0;
+}
+
+void LightTree::build(const vector<PointLight *> &pointLights, const vector<SpotLight *> &spotLights)
+{
+    clear();
+
+    vector<BuildEntry> entries;
+    for (PointLight *light : pointLights)
+    {
+        BuildEntry entry;
+        entry.position = light->getLightPosition();
+        entry.cone = LightCone::everywhere();
+        entry.power = colorPower(light->getColor());
+        entry.light = entries.size();
+        entries.push_back(entry);
+    }
+    for (SpotLight *light : spotLights)
+    {
+        BuildEntry entry;
+        entry.position = light->getLightPosition();
+        entry.cone.axis = light->getLightDirection();
+        entry.cone.spread = 0;
+        entry.cone.cutoff = min(degreeToRadian(fabs(light->getCutoffAngle())), M_PI);
+        entry.power = colorPower(light->getColor());
+        entry.light = entries.size();
+        entries.push_back(entry);
+    }
+
+    lightCount = entries.size();
+    if (!entries.empty())
+    {
+        nodes.reserve(2 * entries.size() - 1);
+        buildRecursive(entries, 0, entries.size());
+    }
+}
+
+// Median split along the longest axis of the light positions; one light per leaf,
+// so a leaf's probability is exactly the chance of picking that light
+int LightTree::buildRecursive(vector<BuildEntry> &entries, int begin, int end)
+{
+    int nodeIndex = nodes.size();
+    nodes.push_back(LightNode());
+
+    AABB bounds;
+    LightCone cone = entries[begin].cone;
+    double power = 0;
+    for (int k = begin; k < end; k++)
+    {
+        bounds.expand(entries[k].position);
+        if (k > begin)
+        {
+            cone = LightCone::merge(cone, entries[k].cone);
+        }
+        power += entries[k].power;
+    }
+
+    LightNode node;
+    node.bounds = bounds;
+    node.cone = cone;
+    node.power = power;
+    node.secondChild = -1;
+    node.light = -1;
+    if (end - begin == 1)
+    {
+        node.light = entries[begin].light;
+        nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+
+    int axis = bounds.longestAxis();
+    int middle = (begin + end) / 2;
+    nth_element(entries.begin() + begin, entries.begin() + middle, entries.begin() + end,
+                [axis](const BuildEntry &a, const BuildEntry &b) {
+                    return axisComponent(a.position, axis) < axisComponent(b.position, axis);
+                });
+
+    buildRecursive(entries, begin, middle);
+    node.secondChild = buildRecursive(entries, middle, end);
+    nodes[nodeIndex] = node;
+    return nodeIndex;
+}
+
+// Power over squared distance, with the distance clamped to the node's radius
+// so that a point inside a cluster does not overrate it, and zero when the
+// point is outside every spot cone in the node even allowing for the spread of
+// positions. Surface orientation is left out: the specular term can be lit
+// from behind the normal, and culling there would bias the estimate.
+double LightTree::importance(const LightNode &node, const Vector3D &point) const
+{
+    Vector3D toPoint = point - node.bounds.centroid();
+    double distanceSquared = toPoint * toPoint;
+    double radius = node.bounds.extent().length() / 2;
+
+    if (node.cone.spread < M_PI)
+    {
+        double distance = sqrt(distanceSquared);
+        if (distance > radius)
+        {
+            double angle = acos(clampUnit((toPoint * node.cone.axis) / distance));
+            double uncertainty = asin(radius / distance);
+            if (angle - node.cone.spread - uncertainty > node.cone.cutoff + CONE_TOLERANCE)
+            {
+                return 0;
+            }
+        }
+    }
+    return node.power / max(max(distanceSquared, radius * radius), CONE_TOLERANCE);
+}
+
+int LightTree::sample(const Vector3D &point, double u, double &probability) const
+{
+    probability = 0;
+    if (nodes.empty())
+    {
+        return -1;
+    }
+
+    int nodeIndex = 0;
+    double chance = 1;
+    while (nodes[nodeIndex].light < 0)
+    {
+        int first = nodeIndex + 1, second = nodes[nodeIndex].secondChild;
+        double firstImportance = importance(nodes[first], point);
+        double secondImportance = importance(nodes[second], point);
+        double total = firstImportance + secondImportance;
+        if (!(total > 0))
+        {
+            return -1;
+        }
+
+        // The part of u that chose the child is stretched back to [0, 1) for the next level
+        double firstChance = firstImportance / total;
+        if (u < firstChance)
+        {
+            u /= firstChance;
+            chance *= firstChance;
+            nodeIndex = first;
+        }
+        else
+        {
+            u = (u - firstChance) / (1 - firstChance);
+            chance *= 1 - firstChance;
+            nodeIndex = second;
+        }
+        u = min(u, LARGEST_BELOW_ONE);
+    }
+
+    probability = chance;
+    return nodes[nodeIndex].light;
+}
+
+int LightTree::getLightCount() const
+{
+    return lightCount;
+}
+
+int LightTree::getNodeCount() const
+{
+    return nodes.size();
+}
+
+int LightTree::getDepth() const
+{
+    return nodes.empty() ? 0 : depthOf(nodes, 0);
+}
+
+ostream &operator<<(ostream &out, const LightTree &tree)
+{
+    out << "Light tree: " << tree.nodes.size() << " nodes, depth " << tree.getDepth() << ", "
+        << tree.lightCount << " lights";
+    return out;
+}
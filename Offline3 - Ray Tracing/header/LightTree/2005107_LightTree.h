@@ -0,0 +1,81 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include "../AABB/2005107_AABB.h"
+#include "../Vector3D/2005107_Vector3D.h"
+#include "../PointLight/2005107_PointLight.h"
+#include "../SpotLight/2005107_SpotLight.h"
+
+// Most lights a shading point may sample; bounds the per-hit arrays on the stack
+const int MAX_LIGHT_SAMPLES = 64;
+
+// Bound on where a group of lights shines: every light's own axis lies within
+// spread of axis, and each light reaches up to cutoff around its own axis
+// (both in radians). Point lights shine everywhere, a spread of pi.
+struct LightCone
+{
+    Vector3D axis;
+    double spread;
+    double cutoff;
+
+    static LightCone everywhere();
+    static LightCone merge(const LightCone &a, const LightCone &b);
+};
+
+// One node of the flattened hierarchy, stored depth first like BVHNode: an
+// interior node's first child directly follows it
+struct LightNode
+{
+    AABB bounds; // of the light positions
+    LightCone cone;
+    double power;    // summed colour intensity of the lights below
+    int secondChild; // interior nodes only
+    int light;       // leaf: index in the renderer's light order (point lights first), -1 for interior nodes
+};
+
+// Light hierarchy over the point and spot lights, for scenes with too many
+// lights to test every one at every shading point. Each node bounds the
+// positions, total power and spot cone directions of the lights below it, so
+// a cheap estimate of how much light the whole group can send to a point is
+// available at every level. sample() walks from the root choosing a child in
+// proportion to that estimate and reports the probability of the light it
+// ends at, so the caller can weight the light's contribution by 1 / probability
+// and keep the expected image unchanged.
+class LightTree
+{
+private:
+    struct BuildEntry
+    {
+        Vector3D position;
+        LightCone cone;
+        double power;
+        int light;
+    };
+
+    vector<LightNode> nodes;
+    int lightCount;
+
+    int buildRecursive(vector<BuildEntry> &entries, int begin, int end);
+    // Estimated light the node's group sends to point; 0 when none of its cones can reach it
+    double importance(const LightNode &node, const Vector3D &point) const;
+
+public:
+    LightTree();
+
+    void build(const vector<PointLight *> &pointLights, const vector<SpotLight *> &spotLights);
+    void clear();
+
+    // One light for point, picked with u in [0, 1) with probability roughly
+    // proportional to its contribution; returns -1 when no light can reach the
+    // point. probability is set to the chance of this pick.
+    int sample(const Vector3D &point, double u, double &probability) const;
+
+    int getLightCount() const;
+    int getNodeCount() const;
+    int getDepth() const;
+
+    friend ostream &operator<<(ostream &out, const LightTree &tree);
+};
@@ -0,0 +1,101 @@
+#include "2005107_MappedFile.h"
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP
+#endif
+
+MappedFile::MappedFile() : data(nullptr), size(0), mapping(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const string &fileName, string &error)
+{
+    close();
+
+#ifdef MAPPED_FILE_MMAP
+    int descriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        error = "cannot open " + fileName + ": " + strerror(errno);
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        error = "cannot stat " + fileName + ": " + strerror(errno);
+        ::close(descriptor);
+        return false;
+    }
+
+    size = status.st_size;
+    if (size > 0)
+    {
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            mapping = nullptr;
+            size = 0;
+            error = "cannot map " + fileName + ": " + strerror(errno);
+            ::close(descriptor);
+            return false;
+        }
+        // Parsers walk the file front to back
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(descriptor);
+    return true;
+#else
+    ifstream in(fileName, ios::binary);
+    if (!in)
+    {
+        error = "cannot open " + fileName;
+        return false;
+    }
+    buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef MAPPED_FILE_MMAP
+    if (mapping != nullptr)
+    {
+        munmap(mapping, size);
+    }
+#endif
+    mapping = nullptr;
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+}
+
+const char *MappedFile::begin() const
+{
+    return data;
+}
+
+const char *MappedFile::end() const
+{
+    return data + size;
+}
+
+size_t MappedFile::getSize() const
+{
+    return size;
+}
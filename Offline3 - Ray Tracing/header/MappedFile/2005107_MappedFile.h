@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+// Read-only view of a whole file. On POSIX systems the file is memory mapped, so
+// parsers read it in place without copying it through a stream; elsewhere it is
+// read into memory once. The data is not null terminated.
+class MappedFile
+{
+private:
+    const char *data;
+    size_t size;
+    void *mapping;        // mmap base, nullptr when the file is empty or was read
+    vector<char> buffer;  // file contents when mapping is not available
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns false and describes the problem in error when the file cannot be read
+    bool open(const string &fileName, string &error);
+    void close();
+
+    const char *begin() const;
+    const char *end() const;
+    size_t getSize() const;
+};
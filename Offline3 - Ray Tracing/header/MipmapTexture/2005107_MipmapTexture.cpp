@@ -0,0 +1,208 @@
+#include "2005107_MipmapTexture.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const int TEXTURE_TILE = 4; // texels per block side; a power of two
+
+    int wrap(int coordinate, int size)
+    {
+        coordinate %= size;
+        return coordinate < 0 ? coordinate + size : coordinate;
+    }
+}
+
+bool parseTextureFilter(const string &name, TextureFilter &filter)
+{
+    if (name == "nearest")
+    {
+        filter = TEXTURE_NEAREST;
+    }
+    else if (name == "bilinear")
+    {
+        filter = TEXTURE_BILINEAR;
+    }
+    else if (name == "trilinear")
+    {
+        filter = TEXTURE_TRILINEAR;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char *textureFilterName(TextureFilter filter)
+{
+    switch (filter)
+    {
+    case TEXTURE_NEAREST:
+        return "nearest";
+    case TEXTURE_BILINEAR:
+        return "bilinear";
+    default:
+        return "trilinear";
+    }
+}
+
+MipmapTexture::MipmapTexture()
+{
+}
+
+void MipmapTexture::build(const bitmap_image &image)
+{
+    clear();
+    if (image.width() == 0 || image.height() == 0)
+    {
+        return;
+    }
+
+    addLevel(image);
+    bitmap_image current(image);
+    while (current.width() > 1 || current.height() > 1)
+    {
+        bitmap_image half;
+        current.subsample(half);
+        addLevel(half);
+        current = half;
+    }
+}
+
+void MipmapTexture::addLevel(const bitmap_image &image)
+{
+    Level level;
+    level.width = image.width();
+    level.height = image.height();
+    level.tilesPerRow = (level.width + TEXTURE_TILE - 1) / TEXTURE_TILE;
+    int tileRows = (level.height + TEXTURE_TILE - 1) / TEXTURE_TILE;
+    level.texels.resize(level.tilesPerRow * tileRows * TEXTURE_TILE * TEXTURE_TILE);
+
+    for (int y = 0; y < level.height; y++)
+    {
+        for (int x = 0; x < level.width; x++)
+        {
+            unsigned char r, g, b;
+            image.get_pixel(x, y, r, g, b);
+            Texel &target = level.texels[texelIndex(level, x, y)];
+            target.red = r / 255.0f;
+            target.green = g / 255.0f;
+            target.blue = b / 255.0f;
+        }
+    }
+    levels.push_back(level);
+}
+
+void MipmapTexture::clear()
+{
+    levels.clear();
+}
+
+bool MipmapTexture::empty() const
+{
+    return levels.empty();
+}
+
+// Block-major: the TEXTURE_TILE x TEXTURE_TILE block first, then the texel within it
+int MipmapTexture::texelIndex(const Level &level, int x, int y) const
+{
+    int block = (y / TEXTURE_TILE) * level.tilesPerRow + x / TEXTURE_TILE;
+    int offset = (y % TEXTURE_TILE) * TEXTURE_TILE + x % TEXTURE_TILE;
+    return block * TEXTURE_TILE * TEXTURE_TILE + offset;
+}
+
+const MipmapTexture::Texel &MipmapTexture::texel(const Level &level, int x, int y) const
+{
+    return level.texels[texelIndex(level, x, y)];
+}
+
+int MipmapTexture::getLevelCount() const
+{
+    return levels.size();
+}
+
+int MipmapTexture::getWidth() const
+{
+    return levels.empty() ? 0 : levels[0].width;
+}
+
+int MipmapTexture::getHeight() const
+{
+    return levels.empty() ? 0 : levels[0].height;
+}
+
+size_t MipmapTexture::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const Level &level : levels)
+    {
+        bytes += level.texels.size() * sizeof(Texel);
+    }
+    return bytes;
+}
+
+double MipmapTexture::levelOfDetail(double footprint) const
+{
+    if (levels.empty() || !(footprint > 0))
+    {
+        return 0.0;
+    }
+    double texels = footprint * max(levels[0].width, levels[0].height);
+    return max(0.0, min((double)levels.size() - 1, log2(texels)));
+}
+
+// Same texel choice as the original bitmap lookup, so unfiltered renders do not change
+Color MipmapTexture::sampleNearest(double u, double v) const
+{
+    const Level &level = levels[0];
+    u = max(0.0, min(1.0, u));
+    v = max(0.0, min(1.0, v));
+    int x = max(0, min(level.width - 1, (int)(u * (level.width - 1))));
+    int y = max(0, min(level.height - 1, (int)((1.0 - v) * (level.height - 1))));
+    const Texel &sample = texel(level, x, y);
+    return Color(sample.red, sample.green, sample.blue);
+}
+
+Color MipmapTexture::bilinear(const Level &level, double u, double v) const
+{
+    // Texel centres sit at half-integer coordinates; image rows run top to bottom
+    double x = u * level.width - 0.5;
+    double y = (1.0 - v) * level.height - 0.5;
+    double floorX = floor(x), floorY = floor(y);
+    double fractionX = x - floorX, fractionY = y - floorY;
+
+    int x0 = wrap((int)floorX, level.width), x1 = wrap(x0 + 1, level.width);
+    int y0 = wrap((int)floorY, level.height), y1 = wrap(y0 + 1, level.height);
+    const Texel &a = texel(level, x0, y0);
+    const Texel &b = texel(level, x1, y0);
+    const Texel &c = texel(level, x0, y1);
+    const Texel &d = texel(level, x1, y1);
+
+    double weightA = (1 - fractionX) * (1 - fractionY);
+    double weightB = fractionX * (1 - fractionY);
+    double weightC = (1 - fractionX) * fractionY;
+    double weightD = fractionX * fractionY;
+    return Color(a.red * weightA + b.red * weightB + c.red * weightC + d.red * weightD,
+                 a.green * weightA + b.green * weightB + c.green * weightC + d.green * weightD,
+                 a.blue * weightA + b.blue * weightB + c.blue * weightC + d.blue * weightD);
+}
+
+Color MipmapTexture::sampleBilinear(double u, double v) const
+{
+    return bilinear(levels[0], u, v);
+}
+
+Color MipmapTexture::sampleTrilinear(double u, double v, double levelOfDetail) const
+{
+    int lower = min((int)levelOfDetail, (int)levels.size() - 1);
+    int upper = min(lower + 1, (int)levels.size() - 1);
+    double blend = levelOfDetail - lower;
+    Color fine = bilinear(levels[lower], u, v);
+    if (upper == lower || blend <= 0.0)
+    {
+        return fine;
+    }
+    Color coarse = bilinear(levels[upper], u, v);
+    return fine * (1.0 - blend) + coarse * blend;
+}
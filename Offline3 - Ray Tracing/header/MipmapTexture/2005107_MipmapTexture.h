@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Color/2005107_Color.h"
+#include "../../bitmap_image.hpp"
+
+enum TextureFilter
+{
+    TEXTURE_NEAREST,   // one texel of the full resolution image
+    TEXTURE_BILINEAR,  // four texels of the full resolution image
+    TEXTURE_TRILINEAR  // bilinear on the two mip levels around the footprint, blended
+};
+
+bool parseTextureFilter(const string &name, TextureFilter &filter);
+const char *textureFilterName(TextureFilter filter);
+
+// A texture converted once into float RGB and a full mip pyramid, so samples
+// never touch the bitmap again. Texels are stored in TEXTURE_TILE x
+// TEXTURE_TILE blocks, so the four texels of a bilinear fetch usually share
+// a block (and a cache line or two). Coordinates wrap, so the texture repeats
+// seamlessly from one floor tile to the next.
+class MipmapTexture
+{
+private:
+    struct Texel
+    {
+        float red, green, blue;
+    };
+
+    struct Level
+    {
+        int width, height;
+        int tilesPerRow;
+        vector<Texel> texels;
+    };
+
+    vector<Level> levels;
+
+    void addLevel(const bitmap_image &image);
+    int texelIndex(const Level &level, int x, int y) const;
+    const Texel &texel(const Level &level, int x, int y) const;
+    Color bilinear(const Level &level, double u, double v) const;
+
+public:
+    MipmapTexture();
+
+    // Converts image into level 0 and halves it with bitmap_image::subsample down to 1x1
+    void build(const bitmap_image &image);
+    void clear();
+    bool empty() const;
+
+    int getLevelCount() const;
+    int getWidth() const;
+    int getHeight() const;
+    size_t getMemoryUsage() const;
+
+    // Level of detail for a sample covering footprint texture units (1 = the whole texture)
+    double levelOfDetail(double footprint) const;
+
+    // u runs left to right and v bottom to top, as on the floor
+    Color sampleNearest(double u, double v) const;
+    Color sampleBilinear(double u, double v) const;
+    Color sampleTrilinear(double u, double v, double levelOfDetail) const;
+};
@@ -1,15 +1,20 @@
 #include "2005107_Object.h"
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <vector>
 using namespace std;
 
 // Include the specific light headers
 #include "../PointLight/2005107_PointLight.h"
 #include "../SpotLight/2005107_SpotLight.h"
-
-// Forward declaration for radianToDegree function
-double radianToDegree(double radian);
+#include "../CompiledScene/2005107_CompiledScene.h"
+#include "../RenderStats/2005107_RenderStats.h"
+#include "../ScratchArena/2005107_ScratchArena.h"
+#include "../LightTree/2005107_LightTree.h"
 
 extern double epsilon;
 extern double recursionLevel;
@@ -17,10 +22,57 @@ extern double zNear, zFar;
 extern vector<Object *> objects;
 extern vector<PointLight *> pointLights;
 extern vector<SpotLight *> spotLights;
+extern CompiledScene compiledScene;
+extern LightTree lightTree;
+extern int lightSampleBudget;
 
 extern Vector3D initialCameraPosition;
 extern Vector3D initialCameraLook;
 
+// Last object that blocked each light on this thread, indexed by light
+// (point lights first, then spot lights). Neighbouring shading points are
+// usually shadowed by the same object, so it is tested before the BVH. The
+// cache lives outside the tile arenas, so it carries over from tile to tile;
+// prepareOccluderCache() sizes it before tracing, where allocating is allowed.
+static thread_local vector<Object *> lastOccluders;
+static thread_local unsigned long long lastOccluderEpoch = 0;
+// Bumped by clearOccluderCache(); threads still holding an older epoch start empty
+static atomic<unsigned long long> occluderEpoch(1);
+
+// How far secondary rays keep from the surface point they start or end at, so
+// that rounding in the point does not register as a hit on its own surface.
+// The rounding grows with the magnitudes involved (coordinates and the ray
+// distance the point was computed at); in double builds this is just epsilon.
+static double surfaceOffset(const Vector3D &point, double distance)
+{
+    double magnitude = max(max(fabs((double)point.x), fabs((double)point.y)), max(fabs((double)point.z), distance));
+    return max(epsilon, magnitude * 16 * numeric_limits<Real>::epsilon());
+}
+
+// Where the light samples at point start in [0, 1). A hash of the point rather
+// than a random number, so every thread, tile order and executor picks the
+// same lights at the same point and renders stay reproducible.
+static double lightSampleOffset(const Vector3D &point)
+{
+    unsigned long long hash = 0x9E3779B97F4A7C15ULL;
+    double components[3] = {(double)point.x, (double)point.y, (double)point.z};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        unsigned long long bits;
+        memcpy(&bits, &components[axis], sizeof(bits));
+        // SplitMix64 finaliser
+        hash ^= bits;
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+        hash ^= hash >> 31;
+    }
+    return (hash >> 11) * (1.0 / 9007199254740992.0);
+}
+
+HitRecord::HitRecord() : t(numeric_limits<double>::infinity()), u(0), v(0), object(nullptr), primitive(-1)
+{
+}
+
 Object::Object() : referencePoint(Vector3D::zero()), height(0), width(0), length(0), shine(0)
 {
     color = Color(0, 0, 0);
@@ -55,6 +107,16 @@ Coefficients Object::getCoefficients()
     return materialCoefficients;
 }
 
+Color Object::getColor() const
+{
+    return color;
+}
+
+int Object::getShine() const
+{
+    return shine;
+}
+
 Vector3D Object::computeNormal(Vector3D point)
 {
     return Vector3D(-1.0, -1.0, -1.0);
@@ -65,190 +127,293 @@ void Object::draw()
     cout << "Object " << *this << endl;
 }
 
-double Object::intersect(Ray *ray)
+bool Object::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit)
 {
-    return -1.0;
+    return false;
 }
 
-void Object::phongLighting(Ray *ray, Color *color, int level)
+void Object::completeHit(const Ray &ray, HitRecord &hit)
 {
-    double tmin = intersect(ray);
-    if (tmin < 0)
+    hit.point = ray.getOrigin().mulAdd(ray.getDirection(), hit.t);
+    hit.normal = computeNormal(hit.point);
+    hit.color = getSurfaceColor(hit.point);
+}
+
+// Scalar fallback: one ray at a time through intersect()
+void Object::intersectPacket(const RayPacket &packet, PacketHit &hits)
+{
+    for (int lane = 0; lane < PACKET_SIZE; lane++)
     {
-        return;
+        if (!packet.isActive(lane))
+        {
+            continue;
+        }
+        HitRecord hit;
+        if (intersect(packet.getRay(lane), packet.tMin[lane], hits.t[lane], hit))
+        {
+            hits.t[lane] = hit.t;
+            hits.object[lane] = this;
+        }
     }
-    Vector3D intersectionPoint = ray->getOrigin() + ray->getDirection() * tmin;
-    Color intersectionPointColor = getSurfaceColor(intersectionPoint);
+}
 
-    color->setRed(intersectionPointColor.getRed() * materialCoefficients.getAmbient());
-    color->setGreen(intersectionPointColor.getGreen() * materialCoefficients.getAmbient());
-    color->setBlue(intersectionPointColor.getBlue() * materialCoefficients.getAmbient());
+AABB Object::getBounds()
+{
+    return AABB::infinite();
+}
 
-    Ray normalRay = Ray(intersectionPoint, computeNormal(intersectionPoint));
-    Ray observerRay = *ray;
+void Object::phongLighting(const Ray &ray, const HitRecord &hit, Color *color, int level)
+{
+    ScopedPhase phase(PHASE_SHADING);
+    recordDepth(level);
 
-    // Point lights contribution
-    computePointLightContribution(intersectionPoint, &observerRay, color, intersectionPointColor);
-    
-    // Spot lights contribution
-    computeSpotLightContribution(intersectionPoint, &observerRay, color, intersectionPointColor);
+    *color = hit.color * materialCoefficients.getAmbient();
+
+    if (usesLightSampling())
+    {
+        computeSampledLightContribution(hit, ray, color);
+    }
+    else
+    {
+        // Point lights contribution
+        computePointLightContribution(hit, ray, color);
+
+        // Spot lights contribution
+        computeSpotLightContribution(hit, ray, color);
+    }
     
     // Recursive reflection
-    computeReflection(intersectionPoint, &observerRay, color, level);
+    computeReflection(hit, ray, color, level);
 }
 
 // Helper method implementations
-void Object::computePointLightContribution(Vector3D intersectionPoint, Ray *observerRay, Color *color, Color intersectionPointColor)
+void Object::computePointLightContribution(const HitRecord &hit, const Ray &observerRay, Color *color)
 {
-    Ray normalRay = Ray(intersectionPoint, computeNormal(intersectionPoint));
-    
-    for (PointLight *pointLight : pointLights)
+    ScopedPhase phase(PHASE_POINT_LIGHTS);
+    LightSample sample;
+    for (int lightIndex = 0; lightIndex < (int)pointLights.size(); lightIndex++)
     {
-        Ray incidentRay = Ray(pointLight->getLightPosition(), intersectionPoint - pointLight->getLightPosition());
-        Vector3D reflectedDirection = getReflectionDirection(incidentRay.getDirection(), normalRay.getDirection());
-        Ray reflectedRay = Ray(intersectionPoint, reflectedDirection);
-
-        double distance = (pointLight->getLightPosition() - intersectionPoint).length();
-        if (distance < epsilon)
+        if (sampleLight(hit, lightIndex, sample) && !isInShadow(hit.point, sample.lightPosition, sample.distance, lightIndex))
         {
-            continue;
+            weighLightSample(hit, observerRay, sample);
+            addLightSample(sample, color);
         }
+    }
+}
 
-        if (!isInShadow(intersectionPoint, pointLight->getLightPosition(), distance))
+void Object::computeSpotLightContribution(const HitRecord &hit, const Ray &observerRay, Color *color)
+{
+    ScopedPhase phase(PHASE_SPOT_LIGHTS);
+    LightSample sample;
+    for (int lightIndex = pointLights.size(); lightIndex < (int)(pointLights.size() + spotLights.size()); lightIndex++)
+    {
+        if (sampleLight(hit, lightIndex, sample) && !isInShadow(hit.point, sample.lightPosition, sample.distance, lightIndex))
         {
-            double diffuse = computeDiffuseComponent(incidentRay.getDirection(), normalRay.getDirection());
-            double specular = computeSpecularComponent(reflectedRay.getDirection(), observerRay->getDirection(), shine);
-
-            // diffuse reflection
-            color->setRed(color->getRed() + pointLight->getColor().getRed() * intersectionPointColor.getRed() * (materialCoefficients.getDiffuse() * diffuse));
-            color->setGreen(color->getGreen() + pointLight->getColor().getGreen() * intersectionPointColor.getGreen() * (materialCoefficients.getDiffuse() * diffuse));
-            color->setBlue(color->getBlue() + pointLight->getColor().getBlue() * intersectionPointColor.getBlue() * (materialCoefficients.getDiffuse() * diffuse));
-
-            // specular reflection
-            color->setRed(color->getRed() + pointLight->getColor().getRed() * intersectionPointColor.getRed() * (materialCoefficients.getSpecular() * pow(specular, shine)));
-            color->setGreen(color->getGreen() + pointLight->getColor().getGreen() * intersectionPointColor.getGreen() * (materialCoefficients.getSpecular() * pow(specular, shine)));
-            color->setBlue(color->getBlue() + pointLight->getColor().getBlue() * intersectionPointColor.getBlue() * (materialCoefficients.getSpecular() * pow(specular, shine)));
+            weighLightSample(hit, observerRay, sample);
+            addLightSample(sample, color);
         }
     }
 }
 
-void Object::computeSpotLightContribution(Vector3D intersectionPoint, Ray *observerRay, Color *color, Color intersectionPointColor)
+void Object::computeSampledLightContribution(const HitRecord &hit, const Ray &observerRay, Color *color)
 {
-    Ray normalRay = Ray(intersectionPoint, computeNormal(intersectionPoint));
-    
-    for (SpotLight *spotLight : spotLights)
+    ScopedPhase phase(PHASE_SAMPLED_LIGHTS);
+    int lightIndices[MAX_LIGHT_SAMPLES];
+    double lightWeights[MAX_LIGHT_SAMPLES];
+    int lightsChosen = chooseLights(hit, lightIndices, lightWeights);
+    LightSample sample;
+    for (int k = 0; k < lightsChosen; k++)
     {
-        Ray incidentRay = Ray(spotLight->getLightPosition(), intersectionPoint - spotLight->getLightPosition());
-        Vector3D reflectedDirection = getReflectionDirection(incidentRay.getDirection(), normalRay.getDirection());
-        Ray reflectedRay = Ray(intersectionPoint, reflectedDirection);
-
-        double distance = (spotLight->getLightPosition() - intersectionPoint).length();
-        if (distance < epsilon)
+        if (sampleLight(hit, lightIndices[k], sample) && !isInShadow(hit.point, sample.lightPosition, sample.distance, lightIndices[k]))
         {
-            continue;
+            weighLightSample(hit, observerRay, sample);
+            scaleLightSample(sample, lightWeights[k]);
+            addLightSample(sample, color);
         }
+    }
+}
 
-        double beta = acos(incidentRay.getDirection() * spotLight->getLightDirection());
-        beta = radianToDegree(beta);
-        if (fabs(beta) > spotLight->getCutoffAngle())
+bool Object::usesLightSampling()
+{
+    return lightSampleBudget > 0 && lightTree.getLightCount() > lightSampleBudget;
+}
+
+int Object::chooseLights(const HitRecord &hit, int *lightIndices, double *lightWeights)
+{
+    // The samples are stratified: one per equal slice of [0, 1), all shifted by the same offset
+    int budget = min(lightSampleBudget, MAX_LIGHT_SAMPLES);
+    double offset = lightSampleOffset(hit.point);
+    int lightsChosen = 0;
+    for (int k = 0; k < budget; k++)
+    {
+        double u = offset + (double)k / budget;
+        double probability;
+        int lightIndex = lightTree.sample(hit.point, u < 1 ? u : u - 1, probability);
+        if (lightIndex < 0)
         {
-            continue;
+            // No light can reach the point, whatever u is
+            break;
         }
+        lightIndices[lightsChosen] = lightIndex;
+        lightWeights[lightsChosen] = 1 / (budget * probability);
+        lightsChosen++;
+    }
+    return lightsChosen;
+}
+
+void Object::scaleLightSample(LightSample &sample, double weight)
+{
+    sample.diffuseWeight *= weight;
+    sample.specularWeight *= weight;
+}
 
-        if (!isInShadow(intersectionPoint, spotLight->getLightPosition(), distance))
+bool Object::sampleLight(const HitRecord &hit, int lightIndex, LightSample &sample)
+{
+    bool spot = lightIndex >= (int)pointLights.size();
+    SpotLight *spotLight = spot ? spotLights[lightIndex - pointLights.size()] : nullptr;
+    sample.lightIndex = lightIndex;
+    sample.lightPosition = spot ? spotLight->getLightPosition() : pointLights[lightIndex]->getLightPosition();
+    sample.lightColor = spot ? spotLight->getColor() : pointLights[lightIndex]->getColor();
+
+    // From the light to the point; the same length either way round
+    sample.incidentDirection = hit.point - sample.lightPosition;
+    sample.distance = sample.incidentDirection.length();
+    if (sample.distance < epsilon)
+    {
+        return false;
+    }
+    sample.incidentDirection.normalize();
+
+    if (spot)
+    {
+        double beta = acos(sample.incidentDirection * spotLight->getLightDirection());
+        beta = radianToDegree(beta);
+        if (fabs(beta) > spotLight->getCutoffAngle())
         {
-            double diffuse = computeDiffuseComponent(incidentRay.getDirection(), normalRay.getDirection());
-            double specular = computeSpecularComponent(reflectedRay.getDirection(), observerRay->getDirection(), shine);
-
-            // diffuse reflection
-            color->setRed(color->getRed() + spotLight->getColor().getRed() * intersectionPointColor.getRed() * (materialCoefficients.getDiffuse() * diffuse));
-            color->setGreen(color->getGreen() + spotLight->getColor().getGreen() * intersectionPointColor.getGreen() * (materialCoefficients.getDiffuse() * diffuse));
-            color->setBlue(color->getBlue() + spotLight->getColor().getBlue() * intersectionPointColor.getBlue() * (materialCoefficients.getDiffuse() * diffuse));
-
-            // specular reflection
-            color->setRed(color->getRed() + spotLight->getColor().getRed() * intersectionPointColor.getRed() * (materialCoefficients.getSpecular() * pow(specular, shine)));
-            color->setGreen(color->getGreen() + spotLight->getColor().getGreen() * intersectionPointColor.getGreen() * (materialCoefficients.getSpecular() * pow(specular, shine)));
-            color->setBlue(color->getBlue() + spotLight->getColor().getBlue() * intersectionPointColor.getBlue() * (materialCoefficients.getSpecular() * pow(specular, shine)));
+            return false;
         }
     }
+    return true;
+}
+
+void Object::weighLightSample(const HitRecord &hit, const Ray &observerRay, LightSample &sample)
+{
+    Vector3D reflectedDirection = getReflectionDirection(sample.incidentDirection, hit.normal);
+    double diffuse = computeDiffuseComponent(sample.incidentDirection, hit.normal);
+    double specular = computeSpecularComponent(reflectedDirection, observerRay.getDirection(), shine);
+
+    // Light filtered by the surface, weighted once for each term
+    sample.filtered = sample.lightColor * hit.color;
+    sample.diffuseWeight = materialCoefficients.getDiffuse() * diffuse;
+    sample.specularWeight = materialCoefficients.getSpecular() * pow(specular, shine);
+}
+
+void Object::addLightSample(const LightSample &sample, Color *color)
+{
+    *color = color->mulAdd(sample.filtered, sample.diffuseWeight);
+    *color = color->mulAdd(sample.filtered, sample.specularWeight);
 }
 
-void Object::computeReflection(Vector3D intersectionPoint, Ray *observerRay, Color *color, int level)
+void Object::computeReflection(const HitRecord &hit, const Ray &observerRay, Color *color, int level)
 {
     if (level >= recursionLevel)
     {
         return;
     }
-    
-    Ray normalRay = Ray(intersectionPoint, computeNormal(intersectionPoint));
-    Vector3D reflectedDirection = getReflectionDirection(observerRay->getDirection(), normalRay.getDirection());
-    Ray reflectedViewRay = Ray(intersectionPoint, reflectedDirection);
-    reflectedViewRay.setOrigin(reflectedViewRay.getOrigin() + reflectedViewRay.getDirection() * epsilon);
-
-    Color *reflectedColor = new Color(0, 0, 0);
-    double tmin2 = -1;
-    Object *nearestObject = nullptr;
 
-    for (auto obj : objects)
+    // Each level keeps its reflected colour in its own stack frame, so the
+    // recursion needs no heap and at most recursionLevel frames.
+    countStat(STAT_REFLECTION_RAYS);
+    Ray reflectedViewRay;
+    double tMin, tMax;
+    HitRecord reflectedHit;
+    bool reflectedHitFound;
     {
-        double t = obj->intersect(&reflectedViewRay);
-        if ((t > 0) && (t < tmin2 || (nearestObject == nullptr)))
-        {
-            tmin2 = t;
-            nearestObject = obj;
-        }
+        ScopedPhase phase(PHASE_REFLECTION_RAYS);
+        reflectedHitFound = getReflectedRay(hit, observerRay, reflectedViewRay, tMin, tMax) &&
+                            compiledScene.intersect(reflectedViewRay, tMin, tMax, reflectedHit);
     }
 
-    if (nearestObject != nullptr && isPointVisible(reflectedViewRay.getOrigin() + reflectedViewRay.getDirection() * tmin2))
+    if (reflectedHitFound)
     {
-        nearestObject->phongLighting(&reflectedViewRay, reflectedColor, level + 1);
-        color->setRed(color->getRed() + reflectedColor->getRed() * materialCoefficients.getReflection());
-        color->setGreen(color->getGreen() + reflectedColor->getGreen() * materialCoefficients.getReflection());
-        color->setBlue(color->getBlue() + reflectedColor->getBlue() * materialCoefficients.getReflection());
+        Color reflectedColor(0, 0, 0);
+        reflectedHit.object->phongLighting(reflectedViewRay, reflectedHit, &reflectedColor, level + 1);
+        addReflection(reflectedColor, color);
     }
 
-    color->red = std::min(1.0, color->red);
-    color->green = std::min(1.0, color->green);
-    color->blue = std::min(1.0, color->blue);
-    color->red = std::max(0.0, color->red);
-    color->green = std::max(0.0, color->green);
-    color->blue = std::max(0.0, color->blue);
+    color->clamp();
+}
+
+bool Object::getReflectedRay(const HitRecord &hit, const Ray &observerRay, Ray &reflectedRay, double &tMin, double &tMax)
+{
+    Vector3D reflectedDirection = getReflectionDirection(observerRay.getDirection(), hit.normal);
+    reflectedRay = Ray(hit.point, reflectedDirection);
+    reflectedRay.setOrigin(reflectedRay.getOrigin().mulAdd(reflectedRay.getDirection(), surfaceOffset(hit.point, hit.t)));
+
+    // Hits outside the initial view's depth range are culled during traversal
+    tMin = 0;
+    tMax = numeric_limits<double>::infinity();
+    return reflectedRay.clipToDepthRange(initialCameraPosition, initialCameraLook, zNear, zFar, tMin, tMax);
 }
 
-bool Object::isInShadow(Vector3D intersectionPoint, Vector3D lightPosition, double lightDistance)
+void Object::addReflection(const Color &reflectedColor, Color *color)
 {
+    *color = color->mulAdd(reflectedColor, materialCoefficients.getReflection());
+}
+
+bool Object::isInShadow(Vector3D intersectionPoint, Vector3D lightPosition, double lightDistance, int lightIndex)
+{
+    ScopedPhase phase(PHASE_SHADOW_RAYS);
+    countStat(STAT_SHADOW_RAYS);
     Ray shadowRay = Ray(lightPosition, intersectionPoint - lightPosition);
-    
-    for (Object *object : objects)
+    double tMax = lightDistance - surfaceOffset(intersectionPoint, lightDistance);
+
+    assert(lastOccluders.size() == pointLights.size() + spotLights.size() && "prepareOccluderCache() was not called on this thread");
+    Object *cachedOccluder = lastOccluders[lightIndex];
+    HitRecord occluderHit;
+    if (cachedOccluder != nullptr && cachedOccluder->intersect(shadowRay, 0.0, tMax, occluderHit))
     {
-        double t = object->intersect(&shadowRay);
-        if (t > 0 && t + epsilon < lightDistance)
-        {
-            return true;
-        }
+        return true;
+    }
+
+    Object *occluder = compiledScene.anyHit(shadowRay, 0.0, tMax);
+    if (occluder != nullptr)
+    {
+        lastOccluders[lightIndex] = occluder;
+        return true;
     }
     return false;
 }
 
-double Object::computeDiffuseComponent(Vector3D incidentDirection, Vector3D normalDirection)
+void Object::prepareOccluderCache()
 {
-    return std::max(-(incidentDirection * normalDirection), 0.0);
+    size_t lightCount = pointLights.size() + spotLights.size();
+    unsigned long long epoch = occluderEpoch.load();
+    if (lastOccluders.size() != lightCount || lastOccluderEpoch != epoch)
+    {
+        lastOccluders.assign(lightCount, nullptr);
+        lastOccluderEpoch = epoch;
+    }
 }
 
-double Object::computeSpecularComponent(Vector3D reflectedDirection, Vector3D observerDirection, int shininess)
+void Object::clearOccluderCache()
+{
+    occluderEpoch++;
+}
+
+double Object::computeDiffuseComponent(Vector3D incidentDirection, Vector3D normalDirection)
 {
-    return std::max(-(reflectedDirection * observerDirection), 0.0);
+    return std::max(-(incidentDirection * normalDirection), Real(0));
 }
 
-bool Object::isPointVisible(Vector3D point)
+double Object::computeSpecularComponent(Vector3D reflectedDirection, Vector3D observerDirection, int shininess)
 {
-    double tAlongLook = (point - initialCameraPosition) * initialCameraLook;
-    return (tAlongLook >= zNear && tAlongLook <= zFar);
+    return std::max(-(reflectedDirection * observerDirection), Real(0));
 }
 
 Vector3D Object::getReflectionDirection(Vector3D incidentDirection, Vector3D normalDirection)
 {
-    return incidentDirection - normalDirection * (2 * (incidentDirection * normalDirection));
+    return incidentDirection.reflect(normalDirection);
 }
 
 ostream &operator<<(ostream &out, const Object &o)
@@ -7,6 +7,40 @@ using namespace std;
 #include "../Color/2005107_Color.h"
 #include "../Coefficients/2005107_Coefficients.h"
 #include "../Ray/2005107_Ray.h"
+#include "../AABB/2005107_AABB.h"
+#include "../RayPacket/2005107_RayPacket.h"
+
+class Object;
+
+// Everything shading needs to know about a ray/object intersection.
+// Primitive intersect() fills t and object; completeHit() fills the rest
+// once the nearest hit is known.
+struct HitRecord
+{
+    double t;
+    Vector3D point;
+    Vector3D normal;
+    Color color;
+    double u, v;
+    Object *object;
+    int primitive; // face within a mesh object, -1 when unknown or not a mesh
+
+    HitRecord();
+};
+
+// What one light adds at a hit. sampleLight() fills the geometry and
+// weighLightSample() the shading terms, so the shadow test can run in between
+// (or, in the wavefront renderer, be queued with the finished sample).
+struct LightSample
+{
+    int lightIndex; // point lights first, then spot lights
+    Vector3D lightPosition;
+    Vector3D incidentDirection; // unit, from the light to the point
+    double distance;
+    Color lightColor;
+    Color filtered; // light colour times surface colour
+    double diffuseWeight, specularWeight;
+};
 
 class Object
 {
@@ -20,25 +54,56 @@ public:
     double height, width, length;
 
     Object();
+    // Meshes and textured floors own buffers, so deleting through Object * must reach them
+    virtual ~Object() {}
     Object setColor(Color color);
     Object setShine(int shine);
     Object setCoefficients(Coefficients coefficients);
     Coefficients getCoefficients();
+    Color getColor() const;
+    int getShine() const;
     virtual Color getSurfaceColor(Vector3D point);
     virtual Vector3D computeNormal(Vector3D point);
     virtual void draw();
-    virtual double intersect(Ray *ray);
-    void phongLighting(Ray *ray, Color *color, int level);
+    // Records a hit in (tMin, tMax) into hit.t/hit.object; returns false when there is none
+    virtual bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit);
+    virtual void completeHit(const Ray &ray, HitRecord &hit);
+    // Lowers hits.t / sets hits.object for every packet lane this object hits first
+    virtual void intersectPacket(const RayPacket &packet, PacketHit &hits);
+    virtual AABB getBounds();
+    void phongLighting(const Ray &ray, const HitRecord &hit, Color *color, int level);
     
     // New helper methods
-    void computePointLightContribution(Vector3D intersectionPoint, Ray *observerRay, Color *color, Color intersectionPointColor);
-    void computeSpotLightContribution(Vector3D intersectionPoint, Ray *observerRay, Color *color, Color intersectionPointColor);
-    void computeReflection(Vector3D intersectionPoint, Ray *observerRay, Color *color, int level);
-    bool isInShadow(Vector3D intersectionPoint, Vector3D lightPosition, double lightDistance);
+    void computePointLightContribution(const HitRecord &hit, const Ray &observerRay, Color *color);
+    void computeSpotLightContribution(const HitRecord &hit, const Ray &observerRay, Color *color);
+    // Many-light mode: only the lights the light tree picks, each weighted to stand in for the rest
+    void computeSampledLightContribution(const HitRecord &hit, const Ray &observerRay, Color *color);
+    void computeReflection(const HitRecord &hit, const Ray &observerRay, Color *color, int level);
+    // False when the light cannot reach the point: too close, or outside a spot light's cone
+    bool sampleLight(const HitRecord &hit, int lightIndex, LightSample &sample);
+    void weighLightSample(const HitRecord &hit, const Ray &observerRay, LightSample &sample);
+    static void addLightSample(const LightSample &sample, Color *color);
+    // True when --light-samples is set and the scene has more lights than that budget
+    static bool usesLightSampling();
+    // The lights sampled at hit and the weight 1 / (count * probability) of each;
+    // returns how many were picked, at most the budget
+    static int chooseLights(const HitRecord &hit, int *lightIndices, double *lightWeights);
+    static void scaleLightSample(LightSample &sample, double weight);
+    // The mirror ray leaving hit and its (tMin, tMax) range; false when that range is empty
+    bool getReflectedRay(const HitRecord &hit, const Ray &observerRay, Ray &reflectedRay, double &tMin, double &tMax);
+    void addReflection(const Color &reflectedColor, Color *color);
+    static bool isInShadow(Vector3D intersectionPoint, Vector3D lightPosition, double lightDistance, int lightIndex);
     double computeDiffuseComponent(Vector3D incidentDirection, Vector3D normalDirection);
     double computeSpecularComponent(Vector3D reflectedDirection, Vector3D observerDirection, int shininess);
-    bool isPointVisible(Vector3D point);
     Vector3D getReflectionDirection(Vector3D incidentDirection, Vector3D normalDirection);
+
+    // Sizes the calling thread's cache of shadow occluders for the current
+    // lights, keeping what it holds; every thread calls it before tracing a
+    // tile, outside its NoAllocationScope, as the first call allocates
+    static void prepareOccluderCache();
+    // Forgets every thread's cached shadow occluders; needed before the next
+    // render once the objects they point to have been deleted
+    static void clearOccluderCache();
     
     friend ostream &operator<<(ostream &out, const Object &o);
 };
@@ -1,11 +1,13 @@
 #include "2005107_PointLight.h"
 
+#ifndef RENDER_ONLY
 #ifdef __linux__
 #include <GL/glut.h>
 #elif WIN32
 #include <glut.h>
 #include <windows.h>
 #endif
+#endif
 
 PointLight::PointLight() : lightPosition(Vector3D::zero())
 {
@@ -38,6 +40,7 @@ Color PointLight::getColor() const
 
 void PointLight::draw()
 {
+#ifndef RENDER_ONLY
     glPushMatrix();
     {
         glColor3f(color.getRed(), color.getGreen(), color.getBlue());
@@ -45,6 +48,7 @@ void PointLight::draw()
         glutSolidSphere(5, 200, 200);
     }
     glPopMatrix();
+#endif
 }
 
 ostream &operator<<(ostream &out, const PointLight &p)
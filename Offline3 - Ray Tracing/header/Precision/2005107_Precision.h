@@ -0,0 +1,17 @@
+#pragma once
+
+// Scalar type of the geometry, colour and intersection math. Builds default to
+// double; compiling every file with -DRENDER_FLOAT switches the renderer to
+// single precision, which halves the size of vectors, rays and colours.
+// Ray distances (HitRecord::t) and the SIMD packet kernels stay double.
+#ifdef RENDER_FLOAT
+typedef float Real;
+#else
+typedef double Real;
+#endif
+
+// Name of the active precision, for logs and benchmark output
+inline const char *realTypeName()
+{
+    return sizeof(Real) == sizeof(float) ? "float" : "double";
+}
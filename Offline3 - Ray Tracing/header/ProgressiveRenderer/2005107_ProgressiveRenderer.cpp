@@ -0,0 +1,263 @@
+#include "2005107_ProgressiveRenderer.h"
+#include "../ScratchArena/2005107_ScratchArena.h"
+#include "../AllocationCheck/2005107_AllocationCheck.h"
+#include "../Object/2005107_Object.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    const int COARSEST_BLOCK = 16;
+
+    int firstMultipleAtOrAfter(int value, int step)
+    {
+        return (value + step - 1) / step * step;
+    }
+}
+
+ProgressiveRenderer::ProgressiveRenderer()
+    : imageWidth(0), imageHeight(0), tileSize(1), threadCount(1), previewChanged(false),
+      cancelRequested(false), running(false), completedPasses(0)
+{
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    cancel();
+}
+
+void ProgressiveRenderer::planPasses(int extraSamples)
+{
+    passes.clear();
+    for (int blockSize = COARSEST_BLOCK; blockSize >= 1; blockSize /= 2)
+    {
+        passes.push_back(Pass{blockSize, 0});
+    }
+    for (int sample = 1; sample <= extraSamples; sample++)
+    {
+        passes.push_back(Pass{0, sample});
+    }
+}
+
+void ProgressiveRenderer::start(int width, int height, int tileSize, int threadCount, int extraSamples,
+                                PixelSampler sampler, FrameCallback onFinished)
+{
+    cancel();
+
+    imageWidth = width;
+    imageHeight = height;
+    this->tileSize = tileSize;
+    this->threadCount = threadCount;
+    planPasses(extraSamples);
+
+    sums.assign(3 * width * height, 0.0);
+    sampleCounts.assign(width * height, 0);
+    {
+        lock_guard<mutex> guard(previewLock);
+        preview.assign(3 * width * height, 0);
+        previewChanged = true;
+    }
+
+    cancelRequested = false;
+    completedPasses = 0;
+    running = true;
+    worker = thread(&ProgressiveRenderer::run, this, sampler, onFinished);
+}
+
+void ProgressiveRenderer::cancel()
+{
+    cancelRequested = true;
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+    running = false;
+}
+
+void ProgressiveRenderer::run(PixelSampler sampler, FrameCallback onFinished)
+{
+    auto startTime = chrono::steady_clock::now();
+    TileScheduler scheduler(imageWidth, imageHeight, tileSize, threadCount);
+
+    for (const Pass &pass : passes)
+    {
+        // Tiles that start after a cancel return at once, so the pass winds down quickly
+        scheduler.run([&](const Tile &tile) {
+            if (cancelRequested)
+            {
+                return;
+            }
+            if (pass.blockSize > 0)
+            {
+                renderGridPass(pass, tile, sampler);
+            }
+            else
+            {
+                renderSamplePass(pass, tile, sampler);
+            }
+        });
+        if (cancelRequested)
+        {
+            cout << "Render cancelled after " << completedPasses << " of " << passes.size() << " passes" << endl;
+            running = false;
+            return;
+        }
+
+        completedPasses++;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        if (pass.blockSize > 0)
+        {
+            cout << "Pass " << completedPasses << "/" << passes.size() << ": " << pass.blockSize << "x" << pass.blockSize
+                 << " blocks, " << seconds << " s" << endl;
+        }
+        else
+        {
+            cout << "Pass " << completedPasses << "/" << passes.size() << ": " << pass.sampleIndex + 1
+                 << " samples per pixel, " << seconds << " s" << endl;
+        }
+    }
+
+    assertNoScopedAllocations("a progressive render");
+
+    vector<unsigned char> finalImage;
+    {
+        lock_guard<mutex> guard(previewLock);
+        finalImage = preview;
+    }
+    onFinished(finalImage);
+    running = false;
+}
+
+// Traces the pixels on this pass's grid that coarser passes skipped and paints
+// each one over its whole block, so the preview never shows holes
+void ProgressiveRenderer::renderGridPass(const Pass &pass, const Tile &tile, const PixelSampler &sampler)
+{
+    int blockSize = pass.blockSize;
+    bool coarsest = blockSize == COARSEST_BLOCK;
+
+    // The pixels traced in this tile, kept in the thread's scratch arena
+    ScratchArena &arena = threadScratchArena();
+    arena.reset((tile.x1 - tile.x0) * (tile.y1 - tile.y0) * sizeof(int));
+    int *traced = arena.allocate<int>((tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+    int tracedCount = 0;
+
+    Object::prepareOccluderCache();
+    NoAllocationScope noAllocation;
+    for (int y = firstMultipleAtOrAfter(tile.y0, blockSize); y < tile.y1; y += blockSize)
+    {
+        for (int x = firstMultipleAtOrAfter(tile.x0, blockSize); x < tile.x1; x += blockSize)
+        {
+            if (!coarsest && x % (2 * blockSize) == 0 && y % (2 * blockSize) == 0)
+            {
+                continue;
+            }
+            int pixel = y * imageWidth + x;
+            Color color = sampler(x, y);
+            sums[3 * pixel] = color.getRed();
+            sums[3 * pixel + 1] = color.getGreen();
+            sums[3 * pixel + 2] = color.getBlue();
+            sampleCounts[pixel] = 1;
+            traced[tracedCount++] = pixel;
+        }
+    }
+
+    lock_guard<mutex> guard(previewLock);
+    for (int k = 0; k < tracedCount; k++)
+    {
+        int pixel = traced[k];
+        unsigned char rgb[3];
+        toBytes(pixel, rgb);
+        int x0 = pixel % imageWidth, y0 = pixel / imageWidth;
+        for (int y = y0; y < min(y0 + blockSize, imageHeight); y++)
+        {
+            for (int x = x0; x < min(x0 + blockSize, imageWidth); x++)
+            {
+                copy(rgb, rgb + 3, &preview[3 * (y * imageWidth + x)]);
+            }
+        }
+    }
+    previewChanged = true;
+}
+
+// Adds one more sample to every pixel of the tile at a jittered offset shared by the pass
+void ProgressiveRenderer::renderSamplePass(const Pass &pass, const Tile &tile, const PixelSampler &sampler)
+{
+    double offsetX, offsetY;
+    subpixelOffset(pass.sampleIndex, offsetX, offsetY);
+
+    threadScratchArena().reset();
+    Object::prepareOccluderCache();
+    NoAllocationScope noAllocation;
+
+    for (int y = tile.y0; y < tile.y1; y++)
+    {
+        for (int x = tile.x0; x < tile.x1; x++)
+        {
+            int pixel = y * imageWidth + x;
+            Color color = sampler(x + offsetX, y + offsetY);
+            sums[3 * pixel] += color.getRed();
+            sums[3 * pixel + 1] += color.getGreen();
+            sums[3 * pixel + 2] += color.getBlue();
+            sampleCounts[pixel]++;
+        }
+    }
+
+    lock_guard<mutex> guard(previewLock);
+    for (int y = tile.y0; y < tile.y1; y++)
+    {
+        for (int x = tile.x0; x < tile.x1; x++)
+        {
+            toBytes(y * imageWidth + x, &preview[3 * (y * imageWidth + x)]);
+        }
+    }
+    previewChanged = true;
+}
+
+// Same rounding as capture(), so a single sample per pixel gives identical bytes
+void ProgressiveRenderer::toBytes(int pixel, unsigned char rgb[3]) const
+{
+    for (int channel = 0; channel < 3; channel++)
+    {
+        double value = sums[3 * pixel + channel] / sampleCounts[pixel];
+        rgb[channel] = (unsigned char)max(0.0, min(255.0, round(value * 255)));
+    }
+}
+
+bool ProgressiveRenderer::isRunning() const
+{
+    return running;
+}
+
+int ProgressiveRenderer::getCompletedPasses() const
+{
+    return completedPasses;
+}
+
+int ProgressiveRenderer::getPassCount() const
+{
+    return passes.size();
+}
+
+int ProgressiveRenderer::getWidth() const
+{
+    return imageWidth;
+}
+
+int ProgressiveRenderer::getHeight() const
+{
+    return imageHeight;
+}
+
+bool ProgressiveRenderer::takePreview(vector<unsigned char> &rgb)
+{
+    lock_guard<mutex> guard(previewLock);
+    if (!previewChanged)
+    {
+        return false;
+    }
+    rgb = preview;
+    previewChanged = false;
+    return true;
+}
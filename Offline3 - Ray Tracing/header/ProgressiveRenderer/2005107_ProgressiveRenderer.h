@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "../Color/2005107_Color.h"
+#include "../Sampling/2005107_Sampling.h"
+#include "../TileScheduler/2005107_TileScheduler.h"
+
+// Receives the finished image as RGB bytes, row 0 at the top
+typedef function<void(const vector<unsigned char> &rgb)> FrameCallback;
+
+// Renders a frame on a background thread in passes of increasing quality:
+// coarse blocks first (each block shows the colour of its corner pixel), then
+// every remaining pixel centre, then extra jittered samples averaged into each
+// pixel. The preview is a complete image after every pass, so a viewer can show
+// it at any time. After the full resolution pass it matches capture() exactly.
+class ProgressiveRenderer
+{
+private:
+    struct Pass
+    {
+        int blockSize;   // grid passes: pixels on this grid are traced, 1 for full resolution
+        int sampleIndex; // extra sample passes: which jittered offset to use, 0 for grid passes
+    };
+
+    int imageWidth, imageHeight;
+    int tileSize, threadCount;
+    vector<Pass> passes;
+
+    vector<double> sums; // per pixel RGB sum of every sample taken
+    vector<int> sampleCounts;
+
+    mutex previewLock;
+    vector<unsigned char> preview;
+    bool previewChanged;
+
+    thread worker;
+    atomic<bool> cancelRequested;
+    atomic<bool> running;
+    atomic<int> completedPasses;
+
+    void planPasses(int extraSamples);
+    void run(PixelSampler sampler, FrameCallback onFinished);
+    void renderGridPass(const Pass &pass, const Tile &tile, const PixelSampler &sampler);
+    void renderSamplePass(const Pass &pass, const Tile &tile, const PixelSampler &sampler);
+    void toBytes(int pixel, unsigned char rgb[3]) const;
+
+public:
+    ProgressiveRenderer();
+    ~ProgressiveRenderer();
+
+    // Cancels any render in progress, then starts a new one in the background
+    void start(int width, int height, int tileSize, int threadCount, int extraSamples,
+               PixelSampler sampler, FrameCallback onFinished);
+
+    // Stops the current render and waits for its worker; tiles already started finish first
+    void cancel();
+
+    bool isRunning() const;
+    int getCompletedPasses() const;
+    int getPassCount() const;
+    int getWidth() const;
+    int getHeight() const;
+
+    // Copies the preview into rgb if it changed since the last call
+    bool takePreview(vector<unsigned char> &rgb);
+};
@@ -1,4 +1,6 @@
 #include "2005107_Ray.h"
+#include <algorithm>
+#include <cmath>
 
 Ray::Ray() : origin(Vector3D::zero()), direction(Vector3D::one())
 {
@@ -32,6 +34,33 @@ Vector3D Ray::getDirection() const
     return direction;
 }
 
+Vector3D Ray::at(double t) const
+{
+    return origin + direction * t;
+}
+
+bool Ray::clipToDepthRange(const Vector3D &eye, const Vector3D &look, double nearDistance, double farDistance, double &tMin, double &tMax) const
+{
+    // Depth is linear along the ray: depth(t) = startDepth + t * depthRate
+    double startDepth = (origin - eye) * look;
+    double depthRate = direction * look;
+
+    if (fabs(depthRate) < 1e-12)
+    {
+        return startDepth >= nearDistance && startDepth <= farDistance && tMin < tMax;
+    }
+
+    double tNear = (nearDistance - startDepth) / depthRate;
+    double tFar = (farDistance - startDepth) / depthRate;
+    if (tNear > tFar)
+    {
+        swap(tNear, tFar);
+    }
+    tMin = max(tMin, tNear);
+    tMax = min(tMax, tFar);
+    return tMin < tMax;
+}
+
 ostream &operator<<(ostream &out, const Ray &r)
 {
     out << "Origin: " << r.getOrigin() << " Direction: " << r.getDirection();
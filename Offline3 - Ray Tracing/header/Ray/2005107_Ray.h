@@ -15,5 +15,10 @@ public:
     Ray setDirection(Vector3D directionParam);
     Vector3D getOrigin() const;
     Vector3D getDirection() const;
+    Vector3D at(double t) const;
+
+    // Narrows (tMin, tMax) to the part of the ray whose depth along the view's look
+    // direction lies in [nearDistance, farDistance]; false when nothing is left
+    bool clipToDepthRange(const Vector3D &eye, const Vector3D &look, double nearDistance, double farDistance, double &tMin, double &tMax) const;
     friend ostream &operator<<(ostream &out, const Ray &r);
 };
\ No newline at end of file
@@ -0,0 +1,420 @@
+// Packet intersection kernels written once against a "lanes" policy L, which
+// wraps one SIMD register of L::WIDTH doubles:
+//   L::Vec, L::Mask, L::WIDTH
+//   load, store, set1, add, sub, mul, div, sqrt, negate, minimum, maximum, absolute
+//   lessThan, lessEqual, greaterThan, greaterEqual, maskAnd, maskOr, select, bits
+//
+// Every ISA translation unit includes this file inside its own anonymous
+// namespace after defining its lanes type, so the templates are compiled with
+// that unit's target options. The arithmetic mirrors the scalar intersect()
+// code operation for operation, so packet and single-ray results agree exactly.
+
+// 0, 1, 2, ... added to a block's first index to number its lanes
+static const double laneOffsets[PRIMITIVE_BLOCK] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+template <class L>
+static inline typename L::Vec dot3(typename L::Vec ax, typename L::Vec ay, typename L::Vec az,
+                                   typename L::Vec bx, typename L::Vec by, typename L::Vec bz)
+{
+    return L::add(L::add(L::mul(ax, bx), L::mul(ay, by)), L::mul(az, bz));
+}
+
+template <class L>
+static int sphereKernel(const RayPacket &packet, const double center[3], double radius, double *tHit)
+{
+    typedef typename L::Vec Vec;
+    typedef typename L::Mask Mask;
+    int hitMask = 0;
+    for (int lane = 0; lane < PACKET_SIZE; lane += L::WIDTH)
+    {
+        Vec ox = L::sub(L::load(packet.originX + lane), L::set1(center[0]));
+        Vec oy = L::sub(L::load(packet.originY + lane), L::set1(center[1]));
+        Vec oz = L::sub(L::load(packet.originZ + lane), L::set1(center[2]));
+        Vec dx = L::load(packet.directionX + lane);
+        Vec dy = L::load(packet.directionY + lane);
+        Vec dz = L::load(packet.directionZ + lane);
+        Vec tMin = L::load(packet.tMin + lane);
+        Vec tMax = L::load(tHit + lane);
+
+        Vec b = L::mul(L::set1(2.0), dot3<L>(dx, dy, dz, ox, oy, oz));
+        Vec c = L::sub(dot3<L>(ox, oy, oz, ox, oy, oz), L::set1(radius * radius));
+        Vec discriminant = L::sub(L::mul(b, b), L::mul(L::set1(4.0), c));
+        Mask hasRoots = L::greaterEqual(discriminant, L::set1(0.0));
+
+        Vec sqrtDiscriminant = L::sqrt(L::maximum(discriminant, L::set1(0.0)));
+        Vec tNear = L::div(L::sub(L::negate(b), sqrtDiscriminant), L::set1(2.0));
+        Vec tFar = L::div(L::add(L::negate(b), sqrtDiscriminant), L::set1(2.0));
+        Mask nearValid = L::maskAnd(L::greaterThan(tNear, tMin), L::lessThan(tNear, tMax));
+        Mask farValid = L::maskAnd(L::greaterThan(tFar, tMin), L::lessThan(tFar, tMax));
+
+        Mask accept = L::maskAnd(hasRoots, L::maskOr(nearValid, farValid));
+        Vec t = L::select(nearValid, tNear, tFar);
+        L::store(tHit + lane, L::select(accept, t, tMax));
+        hitMask |= L::bits(accept) << lane;
+    }
+    return hitMask;
+}
+
+template <class L>
+static int triangleKernel(const RayPacket &packet, const double vertices[9], const double normal[3], double epsilon, double *tHit)
+{
+    typedef typename L::Vec Vec;
+    typedef typename L::Mask Mask;
+    const double *a = vertices, *b = vertices + 3, *c = vertices + 6;
+    double edgeAB[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double edgeBC[3] = {c[0] - b[0], c[1] - b[1], c[2] - b[2]};
+    double edgeCA[3] = {a[0] - c[0], a[1] - c[1], a[2] - c[2]};
+
+    int hitMask = 0;
+    for (int lane = 0; lane < PACKET_SIZE; lane += L::WIDTH)
+    {
+        Vec ox = L::load(packet.originX + lane);
+        Vec oy = L::load(packet.originY + lane);
+        Vec oz = L::load(packet.originZ + lane);
+        Vec dx = L::load(packet.directionX + lane);
+        Vec dy = L::load(packet.directionY + lane);
+        Vec dz = L::load(packet.directionZ + lane);
+        Vec tMin = L::load(packet.tMin + lane);
+        Vec tMax = L::load(tHit + lane);
+        Vec nx = L::set1(normal[0]), ny = L::set1(normal[1]), nz = L::set1(normal[2]);
+
+        Vec denominator = dot3<L>(nx, ny, nz, dx, dy, dz);
+        Mask notParallel = L::greaterEqual(L::absolute(denominator), L::set1(epsilon));
+        Vec numerator = dot3<L>(L::sub(L::set1(a[0]), ox), L::sub(L::set1(a[1]), oy), L::sub(L::set1(a[2]), oz), nx, ny, nz);
+        Vec t = L::div(numerator, denominator);
+        Mask inRange = L::maskAnd(L::greaterThan(t, tMin), L::lessThan(t, tMax));
+
+        Vec px = L::add(ox, L::mul(dx, t));
+        Vec py = L::add(oy, L::mul(dy, t));
+        Vec pz = L::add(oz, L::mul(dz, t));
+
+        // Cross products of each edge with the vector to the hit point
+        Vec cross[3][3];
+        const double *edges[3] = {edgeAB, edgeBC, edgeCA};
+        const double *starts[3] = {a, b, c};
+        for (int k = 0; k < 3; k++)
+        {
+            Vec ex = L::set1(edges[k][0]), ey = L::set1(edges[k][1]), ez = L::set1(edges[k][2]);
+            Vec wx = L::sub(px, L::set1(starts[k][0]));
+            Vec wy = L::sub(py, L::set1(starts[k][1]));
+            Vec wz = L::sub(pz, L::set1(starts[k][2]));
+            cross[k][0] = L::sub(L::mul(ey, wz), L::mul(ez, wy));
+            cross[k][1] = L::sub(L::mul(ez, wx), L::mul(ex, wz));
+            cross[k][2] = L::sub(L::mul(ex, wy), L::mul(ey, wx));
+        }
+        Mask inside = L::maskAnd(
+            L::greaterEqual(dot3<L>(cross[0][0], cross[0][1], cross[0][2], cross[1][0], cross[1][1], cross[1][2]), L::set1(0.0)),
+            L::greaterEqual(dot3<L>(cross[1][0], cross[1][1], cross[1][2], cross[2][0], cross[2][1], cross[2][2]), L::set1(0.0)));
+
+        Mask accept = L::maskAnd(L::maskAnd(notParallel, inRange), inside);
+        L::store(tHit + lane, L::select(accept, t, tMax));
+        hitMask |= L::bits(accept) << lane;
+    }
+    return hitMask;
+}
+
+template <class L>
+static int floorKernel(const RayPacket &packet, double height, const double minimumXY[2], const double maximumXY[2], double *tHit)
+{
+    typedef typename L::Vec Vec;
+    typedef typename L::Mask Mask;
+    int hitMask = 0;
+    for (int lane = 0; lane < PACKET_SIZE; lane += L::WIDTH)
+    {
+        Vec tMin = L::load(packet.tMin + lane);
+        Vec tMax = L::load(tHit + lane);
+        Vec t = L::div(L::sub(L::set1(height), L::load(packet.originZ + lane)), L::load(packet.directionZ + lane));
+        Vec px = L::add(L::load(packet.originX + lane), L::mul(L::load(packet.directionX + lane), t));
+        Vec py = L::add(L::load(packet.originY + lane), L::mul(L::load(packet.directionY + lane), t));
+
+        Mask inRange = L::maskAnd(L::greaterThan(t, tMin), L::lessThan(t, tMax));
+        Mask insideX = L::maskAnd(L::greaterEqual(px, L::set1(minimumXY[0])), L::lessEqual(px, L::set1(maximumXY[0])));
+        Mask insideY = L::maskAnd(L::greaterEqual(py, L::set1(minimumXY[1])), L::lessEqual(py, L::set1(maximumXY[1])));
+
+        Mask accept = L::maskAnd(inRange, L::maskAnd(insideX, insideY));
+        L::store(tHit + lane, L::select(accept, t, tMax));
+        hitMask |= L::bits(accept) << lane;
+    }
+    return hitMask;
+}
+
+template <class L>
+static int quadricKernel(const RayPacket &packet, const double coefficients[10], const double boxMinimum[3], const double boxMaximum[3], double epsilon, double *tHit)
+{
+    typedef typename L::Vec Vec;
+    typedef typename L::Mask Mask;
+    Vec a = L::set1(coefficients[0]), b = L::set1(coefficients[1]), c = L::set1(coefficients[2]);
+    Vec d = L::set1(coefficients[3]), e = L::set1(coefficients[4]), f = L::set1(coefficients[5]);
+    Vec g = L::set1(coefficients[6]), h = L::set1(coefficients[7]), i = L::set1(coefficients[8]);
+    Vec j = L::set1(coefficients[9]);
+
+    int hitMask = 0;
+    for (int lane = 0; lane < PACKET_SIZE; lane += L::WIDTH)
+    {
+        Vec ox = L::load(packet.originX + lane);
+        Vec oy = L::load(packet.originY + lane);
+        Vec oz = L::load(packet.originZ + lane);
+        Vec dx = L::load(packet.directionX + lane);
+        Vec dy = L::load(packet.directionY + lane);
+        Vec dz = L::load(packet.directionZ + lane);
+        Vec tMin = L::load(packet.tMin + lane);
+        Vec tMax = L::load(tHit + lane);
+
+        // Same term order as General::calculateCoefficientA/B/C
+        Vec A = L::mul(L::mul(a, dx), dx);
+        A = L::add(A, L::mul(L::mul(b, dy), dy));
+        A = L::add(A, L::mul(L::mul(c, dz), dz));
+        A = L::add(A, L::mul(L::mul(d, dx), dy));
+        A = L::add(A, L::mul(L::mul(e, dy), dz));
+        A = L::add(A, L::mul(L::mul(f, dz), dx));
+
+        Vec squareTerms = L::add(L::add(L::mul(L::mul(a, dx), ox), L::mul(L::mul(b, dy), oy)), L::mul(L::mul(c, dz), oz));
+        Vec B = L::mul(L::set1(2.0), squareTerms);
+        B = L::add(B, L::mul(d, L::add(L::mul(dx, oy), L::mul(dy, ox))));
+        B = L::add(B, L::mul(e, L::add(L::mul(dy, oz), L::mul(dz, oy))));
+        B = L::add(B, L::mul(f, L::add(L::mul(dz, ox), L::mul(dx, oz))));
+        B = L::add(B, L::mul(g, dx));
+        B = L::add(B, L::mul(h, dy));
+        B = L::add(B, L::mul(i, dz));
+
+        Vec C = L::mul(L::mul(a, ox), ox);
+        C = L::add(C, L::mul(L::mul(b, oy), oy));
+        C = L::add(C, L::mul(L::mul(c, oz), oz));
+        C = L::add(C, L::mul(L::mul(d, ox), oy));
+        C = L::add(C, L::mul(L::mul(e, oy), oz));
+        C = L::add(C, L::mul(L::mul(f, oz), ox));
+        C = L::add(C, L::mul(g, ox));
+        C = L::add(C, L::mul(h, oy));
+        C = L::add(C, L::mul(i, oz));
+        C = L::add(C, j);
+
+        Vec discriminant = L::sub(L::mul(B, B), L::mul(L::mul(L::set1(4.0), A), C));
+        Mask hasRoots = L::greaterEqual(discriminant, L::set1(0.0));
+        Vec sqrtDiscriminant = L::sqrt(L::maximum(discriminant, L::set1(0.0)));
+        Vec twoA = L::mul(L::set1(2.0), A);
+        Vec t1 = L::div(L::sub(L::negate(B), sqrtDiscriminant), twoA);
+        Vec t2 = L::div(L::add(L::negate(B), sqrtDiscriminant), twoA);
+        Mask swapped = L::greaterThan(t1, t2);
+        Vec tLow = L::select(swapped, t2, t1);
+        Vec tHigh = L::select(swapped, t1, t2);
+
+        Mask valid[2];
+        Vec roots[2] = {tLow, tHigh};
+        for (int k = 0; k < 2; k++)
+        {
+            Vec t = roots[k];
+            Mask inRange = L::maskAnd(L::greaterEqual(t, L::set1(epsilon)),
+                                      L::maskAnd(L::greaterThan(t, tMin), L::lessThan(t, tMax)));
+            Vec px = L::add(ox, L::mul(dx, t));
+            Vec py = L::add(oy, L::mul(dy, t));
+            Vec pz = L::add(oz, L::mul(dz, t));
+            Mask inside = L::maskAnd(L::greaterEqual(px, L::set1(boxMinimum[0])), L::lessEqual(px, L::set1(boxMaximum[0])));
+            inside = L::maskAnd(inside, L::maskAnd(L::greaterEqual(py, L::set1(boxMinimum[1])), L::lessEqual(py, L::set1(boxMaximum[1]))));
+            inside = L::maskAnd(inside, L::maskAnd(L::greaterEqual(pz, L::set1(boxMinimum[2])), L::lessEqual(pz, L::set1(boxMaximum[2]))));
+            valid[k] = L::maskAnd(inRange, inside);
+        }
+
+        Mask accept = L::maskAnd(hasRoots, L::maskOr(valid[0], valid[1]));
+        Vec t = L::select(valid[0], tLow, tHigh);
+        L::store(tHit + lane, L::select(accept, t, tMax));
+        hitMask |= L::bits(accept) << lane;
+    }
+    return hitMask;
+}
+
+template <class L>
+static int boxKernel(const RayPacket &packet, const AABB &box, const double *tHit)
+{
+    typedef typename L::Vec Vec;
+    int hitMask = 0;
+    for (int lane = 0; lane < PACKET_SIZE; lane += L::WIDTH)
+    {
+        Vec tMin = L::load(packet.tMin + lane);
+        Vec tMax = L::load(tHit + lane);
+
+        Vec ox = L::load(packet.originX + lane);
+        Vec t1 = L::mul(L::sub(L::set1(box.minimum.x), ox), L::load(packet.inverseDirectionX + lane));
+        Vec t2 = L::mul(L::sub(L::set1(box.maximum.x), ox), L::load(packet.inverseDirectionX + lane));
+        tMin = L::maximum(tMin, L::minimum(t1, t2));
+        tMax = L::minimum(tMax, L::maximum(t1, t2));
+
+        Vec oy = L::load(packet.originY + lane);
+        t1 = L::mul(L::sub(L::set1(box.minimum.y), oy), L::load(packet.inverseDirectionY + lane));
+        t2 = L::mul(L::sub(L::set1(box.maximum.y), oy), L::load(packet.inverseDirectionY + lane));
+        tMin = L::maximum(tMin, L::minimum(t1, t2));
+        tMax = L::minimum(tMax, L::maximum(t1, t2));
+
+        Vec oz = L::load(packet.originZ + lane);
+        t1 = L::mul(L::sub(L::set1(box.minimum.z), oz), L::load(packet.inverseDirectionZ + lane));
+        t2 = L::mul(L::sub(L::set1(box.maximum.z), oz), L::load(packet.inverseDirectionZ + lane));
+        tMin = L::maximum(tMin, L::minimum(t1, t2));
+        tMax = L::minimum(tMax, L::maximum(t1, t2));
+
+        hitMask |= L::bits(L::lessEqual(tMin, tMax)) << lane;
+    }
+    return hitMask;
+}
+
+// Picks the nearest of the per-lane winners; ties go to the lower primitive index
+static inline int reduceNearest(const double *laneT, const double *laneIndex, int laneCount, double &tHit)
+{
+    int nearest = -1;
+    for (int lane = 0; lane < laneCount; lane++)
+    {
+        if (laneIndex[lane] < 0)
+        {
+            continue;
+        }
+        if (nearest < 0 || laneT[lane] < tHit || (laneT[lane] == tHit && laneIndex[lane] < nearest))
+        {
+            tHit = laneT[lane];
+            nearest = (int)laneIndex[lane];
+        }
+    }
+    return nearest;
+}
+
+template <class L>
+static int nearestSphereKernel(const SphereArrays &spheres, const Ray &ray, double tMin, double &tHit)
+{
+    typedef typename L::Vec Vec;
+    typedef typename L::Mask Mask;
+    const int registers = PRIMITIVE_BLOCK / L::WIDTH;
+
+    Vec ox = L::set1(ray.origin.x), oy = L::set1(ray.origin.y), oz = L::set1(ray.origin.z);
+    Vec dx = L::set1(ray.direction.x), dy = L::set1(ray.direction.y), dz = L::set1(ray.direction.z);
+    Vec rayTMin = L::set1(tMin);
+
+    // Every lane keeps its own nearest t (also its tMax) and the index that produced it
+    Vec bestT[registers], bestIndex[registers];
+    for (int r = 0; r < registers; r++)
+    {
+        bestT[r] = L::set1(tHit);
+        bestIndex[r] = L::set1(-1.0);
+    }
+
+    for (int block = 0; block < spheres.count; block += PRIMITIVE_BLOCK)
+    {
+        for (int r = 0; r < registers; r++)
+        {
+            int first = block + r * L::WIDTH;
+            Vec cx = L::sub(ox, L::load(spheres.centerX + first));
+            Vec cy = L::sub(oy, L::load(spheres.centerY + first));
+            Vec cz = L::sub(oz, L::load(spheres.centerZ + first));
+            Vec radius = L::load(spheres.radius + first);
+
+            Vec b = L::mul(L::set1(2.0), dot3<L>(dx, dy, dz, cx, cy, cz));
+            Vec c = L::sub(dot3<L>(cx, cy, cz, cx, cy, cz), L::mul(radius, radius));
+            Vec discriminant = L::sub(L::mul(b, b), L::mul(L::set1(4.0), c));
+            Mask hasRoots = L::greaterEqual(discriminant, L::set1(0.0));
+
+            Vec sqrtDiscriminant = L::sqrt(L::maximum(discriminant, L::set1(0.0)));
+            Vec tNear = L::div(L::sub(L::negate(b), sqrtDiscriminant), L::set1(2.0));
+            Vec tFar = L::div(L::add(L::negate(b), sqrtDiscriminant), L::set1(2.0));
+            Mask nearValid = L::maskAnd(L::greaterThan(tNear, rayTMin), L::lessThan(tNear, bestT[r]));
+            Mask farValid = L::maskAnd(L::greaterThan(tFar, rayTMin), L::lessThan(tFar, bestT[r]));
+
+            Mask accept = L::maskAnd(hasRoots, L::maskOr(nearValid, farValid));
+            Vec t = L::select(nearValid, tNear, tFar);
+            Vec index = L::add(L::set1((double)first), L::load(laneOffsets));
+            bestT[r] = L::select(accept, t, bestT[r]);
+            bestIndex[r] = L::select(accept, index, bestIndex[r]);
+        }
+    }
+
+    double laneT[PRIMITIVE_BLOCK], laneIndex[PRIMITIVE_BLOCK];
+    for (int r = 0; r < registers; r++)
+    {
+        L::store(laneT + r * L::WIDTH, bestT[r]);
+        L::store(laneIndex + r * L::WIDTH, bestIndex[r]);
+    }
+    return reduceNearest(laneT, laneIndex, PRIMITIVE_BLOCK, tHit);
+}
+
+template <class L>
+static int nearestTriangleKernel(const TriangleArrays &triangles, const Ray &ray, double tMin, double epsilon, double &tHit)
+{
+    typedef typename L::Vec Vec;
+    typedef typename L::Mask Mask;
+    const int registers = PRIMITIVE_BLOCK / L::WIDTH;
+
+    Vec ox = L::set1(ray.origin.x), oy = L::set1(ray.origin.y), oz = L::set1(ray.origin.z);
+    Vec dx = L::set1(ray.direction.x), dy = L::set1(ray.direction.y), dz = L::set1(ray.direction.z);
+    Vec rayTMin = L::set1(tMin);
+
+    Vec bestT[registers], bestIndex[registers];
+    for (int r = 0; r < registers; r++)
+    {
+        bestT[r] = L::set1(tHit);
+        bestIndex[r] = L::set1(-1.0);
+    }
+
+    for (int block = 0; block < triangles.count; block += PRIMITIVE_BLOCK)
+    {
+        for (int r = 0; r < registers; r++)
+        {
+            int first = block + r * L::WIDTH;
+            Vec nx = L::load(triangles.normalX + first);
+            Vec ny = L::load(triangles.normalY + first);
+            Vec nz = L::load(triangles.normalZ + first);
+
+            Vec denominator = dot3<L>(nx, ny, nz, dx, dy, dz);
+            Mask notParallel = L::greaterEqual(L::absolute(denominator), L::set1(epsilon));
+            Vec numerator = dot3<L>(L::sub(L::load(triangles.vertexX[0] + first), ox),
+                                    L::sub(L::load(triangles.vertexY[0] + first), oy),
+                                    L::sub(L::load(triangles.vertexZ[0] + first), oz), nx, ny, nz);
+            Vec t = L::div(numerator, denominator);
+            Mask inRange = L::maskAnd(L::greaterThan(t, rayTMin), L::lessThan(t, bestT[r]));
+
+            Vec px = L::add(ox, L::mul(dx, t));
+            Vec py = L::add(oy, L::mul(dy, t));
+            Vec pz = L::add(oz, L::mul(dz, t));
+
+            Vec cross[3][3];
+            for (int k = 0; k < 3; k++)
+            {
+                Vec ex = L::load(triangles.edgeX[k] + first);
+                Vec ey = L::load(triangles.edgeY[k] + first);
+                Vec ez = L::load(triangles.edgeZ[k] + first);
+                Vec wx = L::sub(px, L::load(triangles.vertexX[k] + first));
+                Vec wy = L::sub(py, L::load(triangles.vertexY[k] + first));
+                Vec wz = L::sub(pz, L::load(triangles.vertexZ[k] + first));
+                cross[k][0] = L::sub(L::mul(ey, wz), L::mul(ez, wy));
+                cross[k][1] = L::sub(L::mul(ez, wx), L::mul(ex, wz));
+                cross[k][2] = L::sub(L::mul(ex, wy), L::mul(ey, wx));
+            }
+            Mask inside = L::maskAnd(
+                L::greaterEqual(dot3<L>(cross[0][0], cross[0][1], cross[0][2], cross[1][0], cross[1][1], cross[1][2]), L::set1(0.0)),
+                L::greaterEqual(dot3<L>(cross[1][0], cross[1][1], cross[1][2], cross[2][0], cross[2][1], cross[2][2]), L::set1(0.0)));
+
+            Mask accept = L::maskAnd(L::maskAnd(notParallel, inRange), inside);
+            Vec index = L::add(L::set1((double)first), L::load(laneOffsets));
+            bestT[r] = L::select(accept, t, bestT[r]);
+            bestIndex[r] = L::select(accept, index, bestIndex[r]);
+        }
+    }
+
+    double laneT[PRIMITIVE_BLOCK], laneIndex[PRIMITIVE_BLOCK];
+    for (int r = 0; r < registers; r++)
+    {
+        L::store(laneT + r * L::WIDTH, bestT[r]);
+        L::store(laneIndex + r * L::WIDTH, bestIndex[r]);
+    }
+    return reduceNearest(laneT, laneIndex, PRIMITIVE_BLOCK, tHit);
+}
+
+template <class L>
+static PacketKernels makePacketKernels(const char *name)
+{
+    PacketKernels kernels;
+    kernels.name = name;
+    kernels.width = L::WIDTH;
+    kernels.sphere = sphereKernel<L>;
+    kernels.triangle = triangleKernel<L>;
+    kernels.floor = floorKernel<L>;
+    kernels.quadric = quadricKernel<L>;
+    kernels.box = boxKernel<L>;
+    kernels.nearestSphere = nearestSphereKernel<L>;
+    kernels.nearestTriangle = nearestTriangleKernel<L>;
+    return kernels;
+}
@@ -0,0 +1,61 @@
+#include "2005107_RayPacket.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+// Only this file is compiled for AVX2; it is never called unless the CPU reports
+// support. FMA is deliberately left out so results stay identical to the scalar path.
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace
+{
+    // Four doubles per register; a packet is one register wide
+    struct AVX2Lanes
+    {
+        typedef __m256d Vec;
+        typedef __m256d Mask;
+        static const int WIDTH = 4;
+
+        static inline Vec load(const double *source) { return _mm256_loadu_pd(source); }
+        static inline void store(double *destination, Vec value) { _mm256_storeu_pd(destination, value); }
+        static inline Vec set1(double value) { return _mm256_set1_pd(value); }
+        static inline Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+        static inline Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+        static inline Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+        static inline Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+        static inline Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+        static inline Vec negate(Vec a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+        static inline Vec minimum(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+        static inline Vec maximum(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+        static inline Vec absolute(Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+        static inline Mask lessThan(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+        static inline Mask lessEqual(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+        static inline Mask greaterThan(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+        static inline Mask greaterEqual(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+        static inline Mask maskAnd(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+        static inline Mask maskOr(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+        static inline Vec select(Mask mask, Vec a, Vec b) { return _mm256_blendv_pd(b, a, mask); }
+        static inline int bits(Mask mask) { return _mm256_movemask_pd(mask); }
+    };
+
+#include "2005107_PacketKernels.h"
+
+    const PacketKernels avx2Kernels = makePacketKernels<AVX2Lanes>("avx2");
+}
+
+#pragma GCC pop_options
+
+const PacketKernels *avx2PacketKernels()
+{
+    return &avx2Kernels;
+}
+
+#else
+
+const PacketKernels *avx2PacketKernels()
+{
+    return nullptr;
+}
+
+#endif
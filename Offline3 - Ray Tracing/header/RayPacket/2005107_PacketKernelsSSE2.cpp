@@ -0,0 +1,59 @@
+#include "2005107_RayPacket.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <emmintrin.h>
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+namespace
+{
+    // Two doubles per register; a packet is processed in two halves
+    struct SSE2Lanes
+    {
+        typedef __m128d Vec;
+        typedef __m128d Mask;
+        static const int WIDTH = 2;
+
+        static inline Vec load(const double *source) { return _mm_loadu_pd(source); }
+        static inline void store(double *destination, Vec value) { _mm_storeu_pd(destination, value); }
+        static inline Vec set1(double value) { return _mm_set1_pd(value); }
+        static inline Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+        static inline Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+        static inline Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+        static inline Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+        static inline Vec sqrt(Vec a) { return _mm_sqrt_pd(a); }
+        static inline Vec negate(Vec a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+        static inline Vec minimum(Vec a, Vec b) { return _mm_min_pd(a, b); }
+        static inline Vec maximum(Vec a, Vec b) { return _mm_max_pd(a, b); }
+        static inline Vec absolute(Vec a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+        static inline Mask lessThan(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+        static inline Mask lessEqual(Vec a, Vec b) { return _mm_cmple_pd(a, b); }
+        static inline Mask greaterThan(Vec a, Vec b) { return _mm_cmpgt_pd(a, b); }
+        static inline Mask greaterEqual(Vec a, Vec b) { return _mm_cmpge_pd(a, b); }
+        static inline Mask maskAnd(Mask a, Mask b) { return _mm_and_pd(a, b); }
+        static inline Mask maskOr(Mask a, Mask b) { return _mm_or_pd(a, b); }
+        static inline Vec select(Mask mask, Vec a, Vec b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+        static inline int bits(Mask mask) { return _mm_movemask_pd(mask); }
+    };
+
+#include "2005107_PacketKernels.h"
+
+    const PacketKernels sse2Kernels = makePacketKernels<SSE2Lanes>("sse2");
+}
+
+#pragma GCC pop_options
+
+const PacketKernels *sse2PacketKernels()
+{
+    return &sse2Kernels;
+}
+
+#else
+
+const PacketKernels *sse2PacketKernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,213 @@
+#include "2005107_RayPacket.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+RayPacket::RayPacket() : activeMask(0)
+{
+}
+
+void RayPacket::setRay(int lane, const Ray &ray, double tMin)
+{
+    originX[lane] = ray.origin.x;
+    originY[lane] = ray.origin.y;
+    originZ[lane] = ray.origin.z;
+    directionX[lane] = ray.direction.x;
+    directionY[lane] = ray.direction.y;
+    directionZ[lane] = ray.direction.z;
+    inverseDirectionX[lane] = 1.0 / ray.direction.x;
+    inverseDirectionY[lane] = 1.0 / ray.direction.y;
+    inverseDirectionZ[lane] = 1.0 / ray.direction.z;
+    this->tMin[lane] = tMin;
+    activeMask |= 1 << lane;
+}
+
+void RayPacket::finalize()
+{
+    int source = 0;
+    while (source < PACKET_SIZE && !isActive(source))
+    {
+        source++;
+    }
+
+    // Inactive lanes copy a live ray (so no NaNs appear) with an interval nothing can fall in
+    for (int lane = 0; lane < PACKET_SIZE; lane++)
+    {
+        if (isActive(lane))
+        {
+            continue;
+        }
+        int from = source < PACKET_SIZE ? source : lane;
+        originX[lane] = originX[from];
+        originY[lane] = originY[from];
+        originZ[lane] = originZ[from];
+        directionX[lane] = directionX[from];
+        directionY[lane] = directionY[from];
+        directionZ[lane] = directionZ[from];
+        inverseDirectionX[lane] = inverseDirectionX[from];
+        inverseDirectionY[lane] = inverseDirectionY[from];
+        inverseDirectionZ[lane] = inverseDirectionZ[from];
+        tMin[lane] = numeric_limits<double>::infinity();
+    }
+}
+
+Ray RayPacket::getRay(int lane) const
+{
+    Ray ray;
+    ray.origin = Vector3D(originX[lane], originY[lane], originZ[lane]);
+    ray.direction = Vector3D(directionX[lane], directionY[lane], directionZ[lane]);
+    return ray;
+}
+
+bool RayPacket::isActive(int lane) const
+{
+    return (activeMask >> lane) & 1;
+}
+
+int RayPacket::activeCount() const
+{
+    int count = 0;
+    for (int lane = 0; lane < PACKET_SIZE; lane++)
+    {
+        count += isActive(lane);
+    }
+    return count;
+}
+
+PacketHit::PacketHit()
+{
+    for (int lane = 0; lane < PACKET_SIZE; lane++)
+    {
+        t[lane] = numeric_limits<double>::infinity();
+        object[lane] = nullptr;
+    }
+}
+
+void PacketHit::setObject(int laneMask, Object *object)
+{
+    for (int lane = 0; lane < PACKET_SIZE; lane++)
+    {
+        if ((laneMask >> lane) & 1)
+        {
+            this->object[lane] = object;
+        }
+    }
+}
+
+namespace
+{
+    // One double per "register"; the portable fallback and the reference for the SIMD versions
+    struct ScalarLanes
+    {
+        typedef double Vec;
+        typedef bool Mask;
+        static const int WIDTH = 1;
+
+        static inline Vec load(const double *source) { return *source; }
+        static inline void store(double *destination, Vec value) { *destination = value; }
+        static inline Vec set1(double value) { return value; }
+        static inline Vec add(Vec a, Vec b) { return a + b; }
+        static inline Vec sub(Vec a, Vec b) { return a - b; }
+        static inline Vec mul(Vec a, Vec b) { return a * b; }
+        static inline Vec div(Vec a, Vec b) { return a / b; }
+        static inline Vec sqrt(Vec a) { return std::sqrt(a); }
+        static inline Vec negate(Vec a) { return -a; }
+        static inline Vec minimum(Vec a, Vec b) { return min(a, b); }
+        static inline Vec maximum(Vec a, Vec b) { return max(a, b); }
+        static inline Vec absolute(Vec a) { return fabs(a); }
+        static inline Mask lessThan(Vec a, Vec b) { return a < b; }
+        static inline Mask lessEqual(Vec a, Vec b) { return a <= b; }
+        static inline Mask greaterThan(Vec a, Vec b) { return a > b; }
+        static inline Mask greaterEqual(Vec a, Vec b) { return a >= b; }
+        static inline Mask maskAnd(Mask a, Mask b) { return a && b; }
+        static inline Mask maskOr(Mask a, Mask b) { return a || b; }
+        static inline Vec select(Mask mask, Vec a, Vec b) { return mask ? a : b; }
+        static inline int bits(Mask mask) { return mask ? 1 : 0; }
+    };
+
+#include "2005107_PacketKernels.h"
+
+    const PacketKernels scalarKernels = makePacketKernels<ScalarLanes>("scalar");
+    const PacketKernels *activeKernels = nullptr;
+}
+
+const PacketKernels *scalarPacketKernels()
+{
+    return &scalarKernels;
+}
+
+SimdLevel detectSimdLevel()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && avx2PacketKernels() != nullptr)
+    {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2") && sse2PacketKernels() != nullptr)
+    {
+        return SIMD_SSE2;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_AVX2:
+        return "avx2";
+    case SIMD_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+bool parseSimdLevel(const string &name, SimdLevel &level)
+{
+    if (name == "avx2")
+    {
+        level = SIMD_AVX2;
+    }
+    else if (name == "sse2")
+    {
+        level = SIMD_SSE2;
+    }
+    else if (name == "scalar")
+    {
+        level = SIMD_SCALAR;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void selectPacketKernels(SimdLevel level)
+{
+    level = min(level, detectSimdLevel());
+    if (level == SIMD_AVX2)
+    {
+        activeKernels = avx2PacketKernels();
+    }
+    else if (level == SIMD_SSE2)
+    {
+        activeKernels = sse2PacketKernels();
+    }
+    else
+    {
+        activeKernels = scalarPacketKernels();
+    }
+}
+
+const PacketKernels &getPacketKernels()
+{
+    if (activeKernels == nullptr)
+    {
+        selectPacketKernels(detectSimdLevel());
+    }
+    return *activeKernels;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <iostream>
+using namespace std;
+
+#include "../Vector3D/2005107_Vector3D.h"
+#include "../Ray/2005107_Ray.h"
+#include "../AABB/2005107_AABB.h"
+
+class Object;
+
+const int PACKET_SIZE = 4;
+
+// Coherent rays (a 2x2 pixel block) traced together, stored as structure of arrays.
+// Inactive lanes get an empty interval, so kernels can process every lane blindly.
+struct RayPacket
+{
+    alignas(32) double originX[PACKET_SIZE];
+    alignas(32) double originY[PACKET_SIZE];
+    alignas(32) double originZ[PACKET_SIZE];
+    alignas(32) double directionX[PACKET_SIZE];
+    alignas(32) double directionY[PACKET_SIZE];
+    alignas(32) double directionZ[PACKET_SIZE];
+    alignas(32) double inverseDirectionX[PACKET_SIZE];
+    alignas(32) double inverseDirectionY[PACKET_SIZE];
+    alignas(32) double inverseDirectionZ[PACKET_SIZE];
+    alignas(32) double tMin[PACKET_SIZE];
+    int activeMask;
+
+    RayPacket();
+    void setRay(int lane, const Ray &ray, double tMin);
+    void finalize(); // fills inactive lanes once every active lane is set
+    Ray getRay(int lane) const;
+    bool isActive(int lane) const;
+    int activeCount() const;
+};
+
+// Per-lane nearest hit; t doubles as each lane's current tMax
+struct PacketHit
+{
+    alignas(32) double t[PACKET_SIZE];
+    Object *object[PACKET_SIZE];
+
+    PacketHit();
+    void setObject(int laneMask, Object *object);
+};
+
+// Primitives are tested against a single ray in blocks of this many
+const int PRIMITIVE_BLOCK = 8;
+
+// Structure-of-arrays views over compiled primitives. count is padded to a
+// multiple of PRIMITIVE_BLOCK with NaN entries that can never be hit.
+struct SphereArrays
+{
+    const double *centerX, *centerY, *centerZ, *radius;
+    int count;
+};
+
+struct TriangleArrays
+{
+    const double *vertexX[3], *vertexY[3], *vertexZ[3];
+    const double *edgeX[3], *edgeY[3], *edgeZ[3]; // B - A, C - B, A - C
+    const double *normalX, *normalY, *normalZ;
+    int count;
+};
+
+enum SimdLevel
+{
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+// Each kernel tests every lane of the packet against one primitive, lowers
+// tHit for lanes with a closer hit and returns those lanes as a bit mask.
+// Results match the scalar Object::intersect code bit for bit.
+struct PacketKernels
+{
+    const char *name;
+    int width; // doubles per SIMD register
+    int (*sphere)(const RayPacket &packet, const double center[3], double radius, double *tHit);
+    int (*triangle)(const RayPacket &packet, const double vertices[9], const double normal[3], double epsilon, double *tHit);
+    int (*floor)(const RayPacket &packet, double height, const double minimumXY[2], const double maximumXY[2], double *tHit);
+    // boxMinimum/boxMaximum hold the clipping box, with infinities on unclipped axes
+    int (*quadric)(const RayPacket &packet, const double coefficients[10], const double boxMinimum[3], const double boxMaximum[3], double epsilon, double *tHit);
+    // Lanes whose (tMin, tHit) interval overlaps the box
+    int (*box)(const RayPacket &packet, const AABB &box, const double *tHit);
+
+    // One ray against a whole primitive array, PRIMITIVE_BLOCK primitives per step.
+    // Returns the index of the nearest hit in (tMin, tHit) and lowers tHit, or -1.
+    int (*nearestSphere)(const SphereArrays &spheres, const Ray &ray, double tMin, double &tHit);
+    int (*nearestTriangle)(const TriangleArrays &triangles, const Ray &ray, double tMin, double epsilon, double &tHit);
+};
+
+SimdLevel detectSimdLevel();
+const char *simdLevelName(SimdLevel level);
+bool parseSimdLevel(const string &name, SimdLevel &level);
+
+// Chooses the kernels for the given level, clamped to what the CPU supports
+void selectPacketKernels(SimdLevel level);
+const PacketKernels &getPacketKernels();
+
+// Per-ISA kernel tables; each returns nullptr when the ISA was not compiled in
+const PacketKernels *scalarPacketKernels();
+const PacketKernels *sse2PacketKernels();
+const PacketKernels *avx2PacketKernels();
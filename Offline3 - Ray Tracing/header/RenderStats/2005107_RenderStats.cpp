@@ -0,0 +1,176 @@
+#include "2005107_RenderStats.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+
+namespace
+{
+    const char *const PHASE_NAMES[PHASE_COUNT] = {
+        "primary visibility", "shading", "point lights", "spot lights", "sampled lights", "shadow rays", "reflection rays"};
+
+#ifndef NO_RENDER_STATS
+    mutex mergedLock;
+    RenderStats merged;
+    unsigned long long mergedPhaseTicks[PHASE_COUNT];
+
+    // Ticks are converted to seconds with the rate measured over the whole
+    // measurement, which needs no calibration step up front
+    chrono::steady_clock::time_point measurementStart;
+    unsigned long long measurementStartTicks;
+
+    void clearThreadStats(ThreadRenderStats &stats)
+    {
+        fill(stats.counters, stats.counters + STAT_COUNTER_COUNT, 0);
+        fill(stats.phaseTicks, stats.phaseTicks + PHASE_COUNT, 0);
+        stats.maxDepth = 0;
+    }
+#endif
+}
+
+#ifndef NO_RENDER_STATS
+thread_local ThreadRenderStats threadRenderStats = {{0}, {0}, 0, PHASE_NONE, 0};
+bool phaseTimersEnabled = false;
+#endif
+
+// Only change this between renders; workers read it without synchronization
+void setPhaseTimersEnabled(bool enabled)
+{
+#ifndef NO_RENDER_STATS
+    phaseTimersEnabled = enabled;
+#endif
+}
+
+bool arePhaseTimersEnabled()
+{
+#ifndef NO_RENDER_STATS
+    return phaseTimersEnabled;
+#else
+    return false;
+#endif
+}
+
+long long RayCounts::total() const
+{
+    return primary + shadow + reflection;
+}
+
+RenderStats::RenderStats() : maxDepth(0)
+{
+    fill(counters, counters + STAT_COUNTER_COUNT, 0);
+    fill(phaseSeconds, phaseSeconds + PHASE_COUNT, 0.0);
+}
+
+void RenderStats::merge(const RenderStats &other)
+{
+    for (int k = 0; k < STAT_COUNTER_COUNT; k++)
+    {
+        counters[k] += other.counters[k];
+    }
+    for (int k = 0; k < PHASE_COUNT; k++)
+    {
+        phaseSeconds[k] += other.phaseSeconds[k];
+    }
+    maxDepth = max(maxDepth, other.maxDepth);
+}
+
+RayCounts RenderStats::rays() const
+{
+    return RayCounts{counters[STAT_PRIMARY_RAYS], counters[STAT_SHADOW_RAYS], counters[STAT_REFLECTION_RAYS]};
+}
+
+long long RenderStats::intersectionTests() const
+{
+    return counters[STAT_SPHERE_TESTS] + counters[STAT_TRIANGLE_TESTS] + counters[STAT_GENERAL_TESTS] + counters[STAT_FLOOR_TESTS];
+}
+
+const char *statPhaseName(StatPhase phase)
+{
+    return phase < PHASE_COUNT ? PHASE_NAMES[phase] : "none";
+}
+
+void resetRenderStats()
+{
+#ifndef NO_RENDER_STATS
+    lock_guard<mutex> guard(mergedLock);
+    merged = RenderStats();
+    fill(mergedPhaseTicks, mergedPhaseTicks + PHASE_COUNT, 0);
+    clearThreadStats(threadRenderStats);
+    measurementStart = chrono::steady_clock::now();
+    measurementStartTicks = statTicks();
+#endif
+}
+
+void flushThreadRenderStats()
+{
+#ifndef NO_RENDER_STATS
+    ThreadRenderStats &stats = threadRenderStats;
+    lock_guard<mutex> guard(mergedLock);
+    for (int k = 0; k < STAT_COUNTER_COUNT; k++)
+    {
+        merged.counters[k] += stats.counters[k];
+    }
+    for (int k = 0; k < PHASE_COUNT; k++)
+    {
+        mergedPhaseTicks[k] += stats.phaseTicks[k];
+    }
+    merged.maxDepth = max(merged.maxDepth, stats.maxDepth);
+    clearThreadStats(stats);
+#endif
+}
+
+RenderStats collectRenderStats()
+{
+#ifndef NO_RENDER_STATS
+    flushThreadRenderStats();
+
+    lock_guard<mutex> guard(mergedLock);
+    RenderStats result = merged;
+    double elapsedSeconds = chrono::duration<double>(chrono::steady_clock::now() - measurementStart).count();
+    unsigned long long elapsedTicks = statTicks() - measurementStartTicks;
+    double secondsPerTick = elapsedTicks > 0 ? elapsedSeconds / elapsedTicks : 0;
+    for (int k = 0; k < PHASE_COUNT; k++)
+    {
+        result.phaseSeconds[k] = mergedPhaseTicks[k] * secondsPerTick;
+    }
+    return result;
+#else
+    return RenderStats();
+#endif
+}
+
+ostream &operator<<(ostream &out, const RenderStats &stats)
+{
+#ifdef NO_RENDER_STATS
+    return out << "Render statistics: compiled out (NO_RENDER_STATS)";
+#else
+    const long long *counters = stats.counters;
+    out << "Render statistics:" << endl;
+    out << "  Rays: " << counters[STAT_PRIMARY_RAYS] << " primary, " << counters[STAT_SHADOW_RAYS] << " shadow, "
+        << counters[STAT_REFLECTION_RAYS] << " reflection; max reflection depth " << stats.maxDepth << endl;
+    out << "  Intersection tests: " << counters[STAT_SPHERE_TESTS] << " sphere, " << counters[STAT_TRIANGLE_TESTS]
+        << " triangle, " << counters[STAT_GENERAL_TESTS] << " quadric, " << counters[STAT_FLOOR_TESTS] << " floor" << endl;
+
+    if (!phaseTimersEnabled)
+    {
+        return out << "  Phase time: not measured (enable with --phase-timers)";
+    }
+
+    double totalSeconds = 0;
+    for (int k = 0; k < PHASE_COUNT; k++)
+    {
+        totalSeconds += stats.phaseSeconds[k];
+    }
+    streamsize precision = out.precision();
+    out << "  Phase time (thread seconds):";
+    for (int k = 0; k < PHASE_COUNT; k++)
+    {
+        double share = totalSeconds > 0 ? 100 * stats.phaseSeconds[k] / totalSeconds : 0;
+        out << (k > 0 ? "," : "") << " " << PHASE_NAMES[k] << " " << fixed << setprecision(3) << stats.phaseSeconds[k]
+            << " (" << setprecision(1) << share << "%)";
+    }
+    out.unsetf(ios::floatfield);
+    out.precision(precision);
+    return out;
+#endif
+}
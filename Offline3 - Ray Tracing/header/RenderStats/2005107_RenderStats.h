@@ -0,0 +1,177 @@
+#pragma once
+
+#include <iostream>
+using namespace std;
+
+#if !defined(NO_RENDER_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Render statistics: event counters and per-phase timers, kept per thread and
+// merged when a TileScheduler worker finishes, so the hot paths never share a
+// cache line. Counters are always kept. Timers read the clock twice per phase,
+// which costs more than the shortest phases themselves, so they only run after
+// setPhaseTimersEnabled(true). Building with -DNO_RENDER_STATS compiles every
+// hook below to nothing; collectRenderStats() then returns zeros.
+
+enum StatCounter
+{
+    STAT_PRIMARY_RAYS,    // camera rays, including anti-aliasing samples
+    STAT_SHADOW_RAYS,     // light visibility tests
+    STAT_REFLECTION_RAYS, // secondary rays from reflective surfaces
+    STAT_SPHERE_TESTS,    // ray/primitive intersection tests by type; packet tests count each active lane
+    STAT_TRIANGLE_TESTS,
+    STAT_GENERAL_TESTS,
+    STAT_FLOOR_TESTS,
+    STAT_COUNTER_COUNT
+};
+
+// Shading phases. Timers nest exclusively: time spent in an inner phase is not
+// also charged to the phase around it, so the phases add up to the time spent
+// inside any of them.
+enum StatPhase
+{
+    PHASE_PRIMARY_VISIBILITY, // nearest hit of camera rays
+    PHASE_SHADING,            // phongLighting outside the phases below (ambient, bookkeeping)
+    PHASE_POINT_LIGHTS,       // point light diffuse and specular terms
+    PHASE_SPOT_LIGHTS,        // spot light cone test, diffuse and specular terms
+    PHASE_SAMPLED_LIGHTS,     // light tree sampling and the terms of the sampled lights
+    PHASE_SHADOW_RAYS,        // isInShadow
+    PHASE_REFLECTION_RAYS,    // nearest hit of reflected rays
+    PHASE_COUNT,
+    PHASE_NONE = PHASE_COUNT
+};
+
+// Rays traced by purpose, as the benchmark suite reports them
+struct RayCounts
+{
+    long long primary;
+    long long shadow;
+    long long reflection;
+
+    long long total() const;
+};
+
+struct RenderStats
+{
+    long long counters[STAT_COUNTER_COUNT];
+    double phaseSeconds[PHASE_COUNT]; // summed over threads
+    int maxDepth;                     // deepest reflection level shaded
+
+    RenderStats();
+    void merge(const RenderStats &other);
+    RayCounts rays() const;
+    long long intersectionTests() const;
+};
+
+ostream &operator<<(ostream &out, const RenderStats &stats);
+
+const char *statPhaseName(StatPhase phase);
+
+void setPhaseTimersEnabled(bool enabled);
+bool arePhaseTimersEnabled();
+
+// Starts a new measurement: clears the merged totals and the calling thread's own
+void resetRenderStats();
+
+// Adds the calling thread's numbers to the merged totals and clears them; called by
+// each worker before it exits and by collectRenderStats() for the calling thread
+void flushThreadRenderStats();
+
+// Totals since resetRenderStats(), including the calling thread's
+RenderStats collectRenderStats();
+
+#ifndef NO_RENDER_STATS
+
+// Raw per-thread state behind the inline hooks; timer values are in clock ticks
+struct ThreadRenderStats
+{
+    long long counters[STAT_COUNTER_COUNT];
+    unsigned long long phaseTicks[PHASE_COUNT];
+    int maxDepth;
+    StatPhase currentPhase;
+    unsigned long long phaseStart;
+};
+
+extern thread_local ThreadRenderStats threadRenderStats;
+extern bool phaseTimersEnabled;
+
+// The time stamp counter costs a few cycles to read, far less than a system clock
+inline unsigned long long statTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline void countStat(StatCounter counter, long long amount = 1)
+{
+    threadRenderStats.counters[counter] += amount;
+}
+
+inline void recordDepth(int depth)
+{
+    if (depth > threadRenderStats.maxDepth)
+    {
+        threadRenderStats.maxDepth = depth;
+    }
+}
+
+// Charges the time until it goes out of scope to phase, pausing the enclosing phase meanwhile
+class ScopedPhase
+{
+private:
+    bool timing;
+    StatPhase enclosingPhase;
+
+public:
+    explicit ScopedPhase(StatPhase phase) : timing(phaseTimersEnabled)
+    {
+        if (!timing)
+        {
+            return;
+        }
+        ThreadRenderStats &stats = threadRenderStats;
+        unsigned long long now = statTicks();
+        if (stats.currentPhase != PHASE_NONE)
+        {
+            stats.phaseTicks[stats.currentPhase] += now - stats.phaseStart;
+        }
+        enclosingPhase = stats.currentPhase;
+        stats.currentPhase = phase;
+        stats.phaseStart = now;
+    }
+
+    ~ScopedPhase()
+    {
+        if (!timing)
+        {
+            return;
+        }
+        ThreadRenderStats &stats = threadRenderStats;
+        unsigned long long now = statTicks();
+        stats.phaseTicks[stats.currentPhase] += now - stats.phaseStart;
+        stats.currentPhase = enclosingPhase;
+        stats.phaseStart = now;
+    }
+
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator=(const ScopedPhase &) = delete;
+};
+
+#else
+
+inline void countStat(StatCounter, long long = 1) {}
+inline void recordDepth(int) {}
+
+class ScopedPhase
+{
+public:
+    explicit ScopedPhase(StatPhase) {}
+};
+
+#endif
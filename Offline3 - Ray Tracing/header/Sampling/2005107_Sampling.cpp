@@ -0,0 +1,118 @@
+#include "2005107_Sampling.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Samples per pixel, centre included, taken before deciding whether to go on to the cap
+    const int FIRST_ROUND_SAMPLES = 4;
+
+    double colorDifference(const Color &a, const Color &b)
+    {
+        return max(fabs(a.getRed() - b.getRed()), max(fabs(a.getGreen() - b.getGreen()), fabs(a.getBlue() - b.getBlue())));
+    }
+}
+
+double halton(int index, int base)
+{
+    double result = 0, fraction = 1.0 / base;
+    while (index > 0)
+    {
+        result += fraction * (index % base);
+        index /= base;
+        fraction /= base;
+    }
+    return result;
+}
+
+void subpixelOffset(int index, double &dx, double &dy)
+{
+    dx = halton(index, 2) - 0.5;
+    dy = halton(index, 3) - 0.5;
+}
+
+AdaptiveSampler::AdaptiveSampler(int width, int height, int maxSamples, double contrastThreshold)
+    : width(width), height(height), maxSamples(max(1, maxSamples)), contrastThreshold(contrastThreshold),
+      centreColors(width * height), centreObjects(width * height, nullptr), sampleCounts(width * height, 1)
+{
+}
+
+int AdaptiveSampler::index(int x, int y) const
+{
+    return y * width + x;
+}
+
+void AdaptiveSampler::setCentreSample(int x, int y, const Color &color, const Object *object)
+{
+    centreColors[index(x, y)] = color;
+    centreObjects[index(x, y)] = object;
+}
+
+bool AdaptiveSampler::needsRefinement(int x, int y) const
+{
+    if (maxSamples <= 1)
+    {
+        return false;
+    }
+
+    const int neighbourX[4] = {x - 1, x + 1, x, x};
+    const int neighbourY[4] = {y, y, y - 1, y + 1};
+    int pixel = index(x, y);
+    for (int k = 0; k < 4; k++)
+    {
+        if (neighbourX[k] < 0 || neighbourX[k] >= width || neighbourY[k] < 0 || neighbourY[k] >= height)
+        {
+            continue;
+        }
+        int neighbour = index(neighbourX[k], neighbourY[k]);
+        if (centreObjects[neighbour] != centreObjects[pixel] ||
+            colorDifference(centreColors[neighbour], centreColors[pixel]) > contrastThreshold)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Color AdaptiveSampler::refine(int x, int y, const PixelSampler &sampler)
+{
+    int pixel = index(x, y);
+    Color sum = centreColors[pixel];
+    Color minimum = sum, maximum = sum;
+    int count = 1;
+
+    while (count < maxSamples)
+    {
+        // Stop after the first round when those samples already agree
+        if (count == FIRST_ROUND_SAMPLES && colorDifference(maximum, minimum) <= contrastThreshold)
+        {
+            break;
+        }
+
+        double dx, dy;
+        subpixelOffset(count, dx, dy);
+        Color sample = sampler(x + dx, y + dy);
+        sum += sample;
+        minimum = Color(min(minimum.getRed(), sample.getRed()), min(minimum.getGreen(), sample.getGreen()), min(minimum.getBlue(), sample.getBlue()));
+        maximum = Color(max(maximum.getRed(), sample.getRed()), max(maximum.getGreen(), sample.getGreen()), max(maximum.getBlue(), sample.getBlue()));
+        count++;
+    }
+
+    sampleCounts[pixel] = count;
+    return sum / count;
+}
+
+int AdaptiveSampler::getRefinedPixelCount() const
+{
+    return count_if(sampleCounts.begin(), sampleCounts.end(), [](int count) { return count > 1; });
+}
+
+double AdaptiveSampler::getAverageSamplesPerPixel() const
+{
+    long long total = 0;
+    for (int count : sampleCounts)
+    {
+        total += count;
+    }
+    return sampleCounts.empty() ? 0 : (double)total / sampleCounts.size();
+}
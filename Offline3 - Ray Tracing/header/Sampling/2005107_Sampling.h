@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+using namespace std;
+
+#include "../Color/2005107_Color.h"
+
+class Object;
+
+// Color seen through image position (x, y) in pixel units; integer positions
+// are pixel centres
+typedef function<Color(double x, double y)> PixelSampler;
+
+// Radical inverse of index in the given base: a low-discrepancy sequence in [0, 1)
+double halton(int index, int base);
+
+// Offset from the pixel centre, in [-0.5, 0.5) on both axes, of extra sample
+// number index >= 1. Halton bases 2 and 3 keep any prefix of the sequence stratified.
+void subpixelOffset(int index, double &dx, double &dy);
+
+// Adaptive anti-aliasing for one frame. Every pixel first gets its centre
+// sample; a pixel whose colour differs from a 4-neighbour by more than the
+// contrast threshold, or that sees a different object, is then refined with
+// extra samples, up to maxSamples in total.
+class AdaptiveSampler
+{
+private:
+    int width, height;
+    int maxSamples;
+    double contrastThreshold;
+    vector<Color> centreColors;
+    vector<const Object *> centreObjects;
+    vector<int> sampleCounts;
+
+    int index(int x, int y) const;
+
+public:
+    AdaptiveSampler(int width, int height, int maxSamples, double contrastThreshold);
+
+    void setCentreSample(int x, int y, const Color &color, const Object *object);
+
+    // Only valid once every pixel has its centre sample
+    bool needsRefinement(int x, int y) const;
+
+    // Takes a first round of extra samples and keeps going up to maxSamples only
+    // if they disagree; returns the average of all samples including the centre
+    Color refine(int x, int y, const PixelSampler &sampler);
+
+    int getRefinedPixelCount() const;
+    double getAverageSamplesPerPixel() const;
+};
@@ -0,0 +1,531 @@
+#include "2005107_SceneCache.h"
+#include "../MappedFile/2005107_MappedFile.h"
+#include "../CompiledScene/2005107_PrimitiveDispatch.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace
+{
+    const char CACHE_MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+    const unsigned int CACHE_VERSION = 1;
+    const size_t SECTION_ALIGNMENT = 8;
+
+    // Per field arrays of each primitive, in the order of the scene file's numbers
+    const int SPHERE_FIELDS = 4;    // centre, radius
+    const int TRIANGLE_FIELDS = 9;  // three vertices
+    const int GENERAL_FIELDS = 16;  // ten coefficients, reference point, height, width, length
+
+    enum CachedKind
+    {
+        KIND_SPHERE,
+        KIND_TRIANGLE,
+        KIND_GENERAL
+    };
+
+    struct CacheHeader
+    {
+        char magic[8];
+        unsigned int version;
+        unsigned int realSize; // float builds store other nodes, and round differently
+        unsigned int nodeSize;
+        unsigned int leadingObjects; // added by the caller ahead of the scene's objects
+        unsigned long long sourceHash;
+        double recursionLevel, dimension;
+        unsigned int objectCount, sphereCount, triangleCount, generalCount, materialCount;
+        unsigned int pointLightCount, spotLightCount;
+        unsigned int hasHierarchy, nodeCount, orderedCount, unboundedCount;
+        unsigned int padding;
+    };
+
+    struct CachedMaterial
+    {
+        double color[3];
+        double coefficients[4];
+        long long shine;
+    };
+
+    struct CachedPointLight
+    {
+        double position[3], color[3];
+    };
+
+    struct CachedSpotLight
+    {
+        double position[3], color[3], direction[3], cutoffAngle;
+    };
+
+    // Byte offset of every section, all aligned for their element type
+    struct CacheLayout
+    {
+        size_t kinds, materials;
+        size_t spheres, sphereMaterials, triangles, triangleMaterials, generals, generalMaterials;
+        size_t pointLights, spotLights;
+        size_t nodes, ordered, unbounded;
+        size_t size;
+    };
+
+    CacheLayout layoutOf(const CacheHeader &header)
+    {
+        size_t offset = sizeof(CacheHeader);
+        auto section = [&offset](size_t bytes) {
+            size_t start = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+            offset = start + bytes;
+            return start;
+        };
+
+        CacheLayout layout;
+        layout.kinds = section(header.objectCount);
+        layout.materials = section((size_t)header.materialCount * sizeof(CachedMaterial));
+        layout.spheres = section((size_t)header.sphereCount * SPHERE_FIELDS * sizeof(double));
+        layout.sphereMaterials = section((size_t)header.sphereCount * sizeof(unsigned int));
+        layout.triangles = section((size_t)header.triangleCount * TRIANGLE_FIELDS * sizeof(double));
+        layout.triangleMaterials = section((size_t)header.triangleCount * sizeof(unsigned int));
+        layout.generals = section((size_t)header.generalCount * GENERAL_FIELDS * sizeof(double));
+        layout.generalMaterials = section((size_t)header.generalCount * sizeof(unsigned int));
+        layout.pointLights = section((size_t)header.pointLightCount * sizeof(CachedPointLight));
+        layout.spotLights = section((size_t)header.spotLightCount * sizeof(CachedSpotLight));
+        layout.nodes = section((size_t)header.nodeCount * sizeof(BVHNode));
+        layout.ordered = section((size_t)header.orderedCount * sizeof(int));
+        layout.unbounded = section((size_t)header.unboundedCount * sizeof(int));
+        layout.size = section(0);
+        return layout;
+    }
+
+    struct MaterialHash
+    {
+        size_t operator()(const CachedMaterial &material) const
+        {
+            size_t combined = hash<long long>()(material.shine);
+            for (double value : material.color)
+            {
+                combined = combined * 31 + hash<double>()(value);
+            }
+            for (double value : material.coefficients)
+            {
+                combined = combined * 31 + hash<double>()(value);
+            }
+            return combined;
+        }
+    };
+
+    struct MaterialEqual
+    {
+        bool operator()(const CachedMaterial &a, const CachedMaterial &b) const
+        {
+            return equal(a.color, a.color + 3, b.color) && equal(a.coefficients, a.coefficients + 4, b.coefficients) &&
+                   a.shine == b.shine;
+        }
+    };
+
+    CachedMaterial materialOf(Object *object)
+    {
+        Color color = object->getColor();
+        Coefficients coefficients = object->getCoefficients();
+        CachedMaterial material;
+        material.color[0] = color.getRed();
+        material.color[1] = color.getGreen();
+        material.color[2] = color.getBlue();
+        material.coefficients[0] = coefficients.ambient;
+        material.coefficients[1] = coefficients.diffuse;
+        material.coefficients[2] = coefficients.specular;
+        material.coefficients[3] = coefficients.reflection;
+        material.shine = object->getShine();
+        return material;
+    }
+
+    void applyMaterial(Object &object, const CachedMaterial &material)
+    {
+        object.setColor(Color(material.color[0], material.color[1], material.color[2]));
+        object.setCoefficients(Coefficients(material.coefficients[0], material.coefficients[1], material.coefficients[2],
+                                            material.coefficients[3]));
+        object.setShine(material.shine);
+    }
+
+    void writeSection(ofstream &out, const void *data, size_t bytes, size_t offset)
+    {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        out.write(zeros, offset - (size_t)(streamoff)out.tellp());
+        out.write(static_cast<const char *>(data), bytes);
+    }
+
+    template <class T>
+    const T *sectionAt(const MappedFile &file, size_t offset)
+    {
+        return reinterpret_cast<const T *>(file.begin() + offset);
+    }
+}
+
+// Eight bytes per step, each rotated into the state and multiplied, with a
+// final avalanche; the file is hashed on every run, so it must be cheap
+unsigned long long hashSceneText(const char *begin, const char *end)
+{
+    const unsigned long long MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+    unsigned long long hash = 0xCBF29CE484222325ULL ^ (unsigned long long)(end - begin);
+    const char *p = begin;
+    for (; end - p >= 8; p += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, p, 8);
+        hash ^= word;
+        hash = ((hash << 31) | (hash >> 33)) * MULTIPLIER;
+    }
+    unsigned long long tail = 0;
+    memcpy(&tail, p, end - p);
+    hash ^= tail;
+    hash = ((hash << 31) | (hash >> 33)) * MULTIPLIER;
+
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+string sceneCachePath(const string &scenePath)
+{
+    return scenePath + ".scenecache";
+}
+
+bool saveSceneCache(const string &cachePath, unsigned long long sourceHash, const SceneCacheContents &contents, string &error)
+{
+    const vector<Object *> &objects = contents.objects;
+    size_t leading = contents.leadingObjects;
+
+    vector<unsigned char> kinds;
+    vector<CachedMaterial> materials;
+    unordered_map<CachedMaterial, unsigned int, MaterialHash, MaterialEqual> materialIndices;
+    vector<double> sphereFields[SPHERE_FIELDS], triangleFields[TRIANGLE_FIELDS], generalFields[GENERAL_FIELDS];
+    vector<unsigned int> sphereMaterials, triangleMaterials, generalMaterials;
+    for (size_t k = leading; k < objects.size(); k++)
+    {
+        Object *object = objects[k];
+        if (!contents.store.owns(object))
+        {
+            error = "only scenes of spheres, triangles and quadrics are cached";
+            return false;
+        }
+
+        CachedMaterial material = materialOf(object);
+        auto found = materialIndices.find(material);
+        unsigned int materialIndex;
+        if (found != materialIndices.end())
+        {
+            materialIndex = found->second;
+        }
+        else
+        {
+            materialIndex = materials.size();
+            materialIndices[material] = materialIndex;
+            materials.push_back(material);
+        }
+
+        PrimitiveType type = classifyPrimitive(object);
+        if (type == PRIMITIVE_SPHERE)
+        {
+            Sphere *sphere = static_cast<Sphere *>(object);
+            Vector3D center = sphere->getCenter();
+            double values[SPHERE_FIELDS] = {center.x, center.y, center.z, sphere->getRadius()};
+            for (int f = 0; f < SPHERE_FIELDS; f++)
+            {
+                sphereFields[f].push_back(values[f]);
+            }
+            sphereMaterials.push_back(materialIndex);
+            kinds.push_back(KIND_SPHERE);
+        }
+        else if (type == PRIMITIVE_TRIANGLE)
+        {
+            Triangle *triangle = static_cast<Triangle *>(object);
+            Vector3D vertices[3] = {triangle->getVertexA(), triangle->getVertexB(), triangle->getVertexC()};
+            for (int v = 0; v < 3; v++)
+            {
+                triangleFields[3 * v].push_back(vertices[v].x);
+                triangleFields[3 * v + 1].push_back(vertices[v].y);
+                triangleFields[3 * v + 2].push_back(vertices[v].z);
+            }
+            triangleMaterials.push_back(materialIndex);
+            kinds.push_back(KIND_TRIANGLE);
+        }
+        else
+        {
+            double values[GENERAL_FIELDS];
+            static_cast<General *>(object)->getDefinition(values, values + 10);
+            for (int f = 0; f < GENERAL_FIELDS; f++)
+            {
+                generalFields[f].push_back(values[f]);
+            }
+            generalMaterials.push_back(materialIndex);
+            kinds.push_back(KIND_GENERAL);
+        }
+    }
+
+    vector<CachedPointLight> pointLights;
+    for (PointLight *light : contents.pointLights)
+    {
+        Vector3D position = light->getLightPosition();
+        Color color = light->getColor();
+        pointLights.push_back(CachedPointLight{{position.x, position.y, position.z}, {color.getRed(), color.getGreen(), color.getBlue()}});
+    }
+    vector<CachedSpotLight> spotLights;
+    for (SpotLight *light : contents.spotLights)
+    {
+        Vector3D position = light->getLightPosition(), direction = light->getLightDirection();
+        Color color = light->getColor();
+        spotLights.push_back(CachedSpotLight{{position.x, position.y, position.z},
+                                             {color.getRed(), color.getGreen(), color.getBlue()},
+                                             {direction.x, direction.y, direction.z},
+                                             light->getCutoffAngle()});
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.realSize = sizeof(Real);
+    header.nodeSize = sizeof(BVHNode);
+    header.leadingObjects = leading;
+    header.sourceHash = sourceHash;
+    header.recursionLevel = contents.recursionLevel;
+    header.dimension = contents.dimension;
+    header.objectCount = kinds.size();
+    header.sphereCount = sphereMaterials.size();
+    header.triangleCount = triangleMaterials.size();
+    header.generalCount = generalMaterials.size();
+    header.materialCount = materials.size();
+    header.pointLightCount = pointLights.size();
+    header.spotLightCount = spotLights.size();
+
+    vector<int> ordered, unbounded;
+    const BVH &hierarchy = contents.compiledScene.getHierarchy();
+    if (contents.compiledScene.getMode() == ACCELERATION_BVH)
+    {
+        hierarchy.getObjectIndices(objects, ordered, unbounded);
+        header.hasHierarchy = 1;
+        header.nodeCount = hierarchy.getNodes().size();
+        header.orderedCount = ordered.size();
+        header.unboundedCount = unbounded.size();
+    }
+    CacheLayout layout = layoutOf(header);
+
+    // Written under another name and renamed, so a reader never sees half a file
+    string temporaryPath = cachePath + ".tmp";
+    ofstream out(temporaryPath, ios::binary | ios::trunc);
+    if (!out)
+    {
+        error = "cannot write " + temporaryPath + ": " + strerror(errno);
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeSection(out, kinds.data(), kinds.size(), layout.kinds);
+    writeSection(out, materials.data(), materials.size() * sizeof(CachedMaterial), layout.materials);
+    for (int f = 0; f < SPHERE_FIELDS; f++)
+    {
+        writeSection(out, sphereFields[f].data(), sphereFields[f].size() * sizeof(double),
+                     layout.spheres + f * header.sphereCount * sizeof(double));
+    }
+    writeSection(out, sphereMaterials.data(), sphereMaterials.size() * sizeof(unsigned int), layout.sphereMaterials);
+    for (int f = 0; f < TRIANGLE_FIELDS; f++)
+    {
+        writeSection(out, triangleFields[f].data(), triangleFields[f].size() * sizeof(double),
+                     layout.triangles + f * header.triangleCount * sizeof(double));
+    }
+    writeSection(out, triangleMaterials.data(), triangleMaterials.size() * sizeof(unsigned int), layout.triangleMaterials);
+    for (int f = 0; f < GENERAL_FIELDS; f++)
+    {
+        writeSection(out, generalFields[f].data(), generalFields[f].size() * sizeof(double),
+                     layout.generals + f * header.generalCount * sizeof(double));
+    }
+    writeSection(out, generalMaterials.data(), generalMaterials.size() * sizeof(unsigned int), layout.generalMaterials);
+    writeSection(out, pointLights.data(), pointLights.size() * sizeof(CachedPointLight), layout.pointLights);
+    writeSection(out, spotLights.data(), spotLights.size() * sizeof(CachedSpotLight), layout.spotLights);
+    if (header.hasHierarchy)
+    {
+        writeSection(out, hierarchy.getNodes().data(), header.nodeCount * sizeof(BVHNode), layout.nodes);
+        writeSection(out, ordered.data(), ordered.size() * sizeof(int), layout.ordered);
+        writeSection(out, unbounded.data(), unbounded.size() * sizeof(int), layout.unbounded);
+    }
+    writeSection(out, nullptr, 0, layout.size);
+    out.close();
+    if (!out || rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+    {
+        error = "cannot write " + cachePath + ": " + strerror(errno);
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadSceneCache(const string &cachePath, unsigned long long sourceHash, AccelerationMode mode,
+                    SceneCacheContents &contents, bool &hierarchyBuilt, string &reason)
+{
+    MappedFile file;
+    if (!file.open(cachePath, reason))
+    {
+        if (errno == ENOENT)
+        {
+            reason = "no " + cachePath + " yet";
+        }
+        return false;
+    }
+
+    CacheHeader header;
+    if (file.getSize() < sizeof(header))
+    {
+        reason = cachePath + " is truncated";
+        return false;
+    }
+    memcpy(&header, file.begin(), sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION)
+    {
+        reason = cachePath + " is not a scene cache of this version";
+        return false;
+    }
+    if (header.realSize != sizeof(Real) || header.nodeSize != sizeof(BVHNode))
+    {
+        reason = cachePath + " was written by a build of other precision";
+        return false;
+    }
+    if (header.sourceHash != sourceHash)
+    {
+        reason = "the scene has changed since " + cachePath + " was written";
+        return false;
+    }
+    CacheLayout layout = layoutOf(header);
+    if (layout.size != file.getSize() || header.leadingObjects != contents.leadingObjects ||
+        contents.objects.size() != contents.leadingObjects ||
+        header.objectCount != (unsigned long long)header.sphereCount + header.triangleCount + header.generalCount)
+    {
+        reason = cachePath + " is damaged";
+        return false;
+    }
+
+    // Every index is checked before anything is built, so a damaged file changes nothing
+    const unsigned char *kinds = sectionAt<unsigned char>(file, layout.kinds);
+    const unsigned int *materialSections[3] = {sectionAt<unsigned int>(file, layout.sphereMaterials),
+                                               sectionAt<unsigned int>(file, layout.triangleMaterials),
+                                               sectionAt<unsigned int>(file, layout.generalMaterials)};
+    const unsigned int kindCounts[3] = {header.sphereCount, header.triangleCount, header.generalCount};
+    unsigned int seen[3] = {0, 0, 0};
+    for (unsigned int k = 0; k < header.objectCount; k++)
+    {
+        if (kinds[k] > KIND_GENERAL)
+        {
+            reason = cachePath + " is damaged";
+            return false;
+        }
+        seen[kinds[k]]++;
+    }
+    for (int kind = 0; kind < 3; kind++)
+    {
+        bool valid = seen[kind] == kindCounts[kind];
+        for (unsigned int k = 0; valid && k < kindCounts[kind]; k++)
+        {
+            valid = materialSections[kind][k] < header.materialCount;
+        }
+        if (!valid)
+        {
+            reason = cachePath + " is damaged";
+            return false;
+        }
+    }
+
+    const CachedMaterial *materials = sectionAt<CachedMaterial>(file, layout.materials);
+    const double *spheres = sectionAt<double>(file, layout.spheres);
+    const double *triangles = sectionAt<double>(file, layout.triangles);
+    const double *generals = sectionAt<double>(file, layout.generals);
+    size_t sphereCount = header.sphereCount, triangleCount = header.triangleCount, generalCount = header.generalCount;
+    size_t sphereIndex = 0, triangleIndex = 0, generalIndex = 0;
+    contents.objects.reserve(contents.objects.size() + header.objectCount);
+    for (unsigned int k = 0; k < header.objectCount; k++)
+    {
+        Object *object;
+        if (kinds[k] == KIND_SPHERE)
+        {
+            size_t s = sphereIndex++;
+            object = &contents.store.addSphere(
+                Vector3D(spheres[s], spheres[sphereCount + s], spheres[2 * sphereCount + s]), spheres[3 * sphereCount + s]);
+            applyMaterial(*object, materials[materialSections[KIND_SPHERE][s]]);
+        }
+        else if (kinds[k] == KIND_TRIANGLE)
+        {
+            size_t t = triangleIndex++;
+            Vector3D vertices[3];
+            for (int v = 0; v < 3; v++)
+            {
+                vertices[v] = Vector3D(triangles[3 * v * triangleCount + t], triangles[(3 * v + 1) * triangleCount + t],
+                                       triangles[(3 * v + 2) * triangleCount + t]);
+            }
+            object = &contents.store.addTriangle(vertices[0], vertices[1], vertices[2]);
+            applyMaterial(*object, materials[materialSections[KIND_TRIANGLE][t]]);
+        }
+        else
+        {
+            size_t g = generalIndex++;
+            double values[GENERAL_FIELDS];
+            for (int f = 0; f < GENERAL_FIELDS; f++)
+            {
+                values[f] = generals[f * generalCount + g];
+            }
+            General &general = contents.store.addGeneral(values);
+            general.setBoundingBox(Vector3D(values[10], values[11], values[12]), values[13], values[14], values[15]);
+            applyMaterial(general, materials[materialSections[KIND_GENERAL][g]]);
+            object = &general;
+        }
+        contents.objects.push_back(object);
+    }
+
+    const CachedPointLight *pointLights = sectionAt<CachedPointLight>(file, layout.pointLights);
+    for (unsigned int k = 0; k < header.pointLightCount; k++)
+    {
+        const CachedPointLight &cached = pointLights[k];
+        PointLight *light = new PointLight();
+        light->setLightPosition(cached.position[0], cached.position[1], cached.position[2]);
+        light->setColor(Color(cached.color[0], cached.color[1], cached.color[2]));
+        contents.pointLights.push_back(light);
+    }
+    const CachedSpotLight *spotLights = sectionAt<CachedSpotLight>(file, layout.spotLights);
+    for (unsigned int k = 0; k < header.spotLightCount; k++)
+    {
+        const CachedSpotLight &cached = spotLights[k];
+        SpotLight *light = new SpotLight();
+        light->setLightPosition(cached.position[0], cached.position[1], cached.position[2]);
+        light->setColor(Color(cached.color[0], cached.color[1], cached.color[2]));
+        light->setLightDirection(cached.direction[0], cached.direction[1], cached.direction[2]);
+        light->setCutoffAngle(cached.cutoffAngle);
+        contents.spotLights.push_back(light);
+    }
+    contents.recursionLevel = header.recursionLevel;
+    contents.dimension = header.dimension;
+
+    hierarchyBuilt = false;
+    if (mode == ACCELERATION_BVH && header.hasHierarchy)
+    {
+        if (contents.compiledScene.restore(contents.objects, sectionAt<BVHNode>(file, layout.nodes), header.nodeCount,
+                                           sectionAt<int>(file, layout.ordered), header.orderedCount,
+                                           sectionAt<int>(file, layout.unbounded), header.unboundedCount))
+        {
+            return true;
+        }
+        // Same outcome as a damaged object section: the text is read instead
+        for (PointLight *light : contents.pointLights)
+        {
+            delete light;
+        }
+        for (SpotLight *light : contents.spotLights)
+        {
+            delete light;
+        }
+        contents.pointLights.clear();
+        contents.spotLights.clear();
+        contents.objects.resize(header.leadingObjects);
+        contents.store.clear();
+        contents.compiledScene.clear();
+        reason = cachePath + " is damaged";
+        return false;
+    }
+    contents.compiledScene.compile(contents.objects, mode);
+    hierarchyBuilt = mode == ACCELERATION_BVH;
+    return true;
+}
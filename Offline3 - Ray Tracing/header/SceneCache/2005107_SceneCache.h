@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Object/2005107_Object.h"
+#include "../PointLight/2005107_PointLight.h"
+#include "../SpotLight/2005107_SpotLight.h"
+#include "../CompiledScene/2005107_CompiledScene.h"
+#include "../SceneStore/2005107_SceneStore.h"
+
+// Compiled form of a text scene, written next to it as <scene>.scenecache so
+// that later runs skip parsing and the hierarchy build. The file is a header
+// followed by flat arrays: the object types in file order, a table of the
+// distinct materials, the spheres, triangles and quadrics as one array per
+// field, the lights, and the BVH with objects given by index. Loading maps it
+// and builds the objects straight from those arrays.
+//
+// The header records a hash of the scene text and the build's precision, so
+// a cache is only used for the exact file and build that wrote it. Meshes
+// are loaded from files of their own that the hash does not cover, so scenes
+// with meshes are not cached.
+
+// Content hash of a scene file
+unsigned long long hashSceneText(const char *begin, const char *end);
+string sceneCachePath(const string &scenePath);
+
+// Everything a cache holds or fills in. The first leadingObjects objects are
+// the caller's own (the floor) rather than the scene's; they are not stored,
+// only counted, and must already be in place when the cache is loaded.
+struct SceneCacheContents
+{
+    double recursionLevel;
+    double dimension;
+    size_t leadingObjects;
+    vector<Object *> &objects;
+    vector<PointLight *> &pointLights;
+    vector<SpotLight *> &spotLights;
+    SceneStore &store;
+    CompiledScene &compiledScene;
+};
+
+// Writes the loaded scene; in BVH mode the compiled hierarchy is stored too
+bool saveSceneCache(const string &cachePath, unsigned long long sourceHash, const SceneCacheContents &contents, string &error);
+
+// Replaces the scene with the cached one when the cache matches sourceHash.
+// The hierarchy is restored in BVH mode when the cache has one; otherwise the
+// scene is compiled for mode, and hierarchyBuilt says so. On failure nothing
+// is changed and reason says why.
+bool loadSceneCache(const string &cachePath, unsigned long long sourceHash, AccelerationMode mode,
+                    SceneCacheContents &contents, bool &hierarchyBuilt, string &reason);
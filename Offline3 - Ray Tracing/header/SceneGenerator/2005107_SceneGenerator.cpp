@@ -0,0 +1,165 @@
+#include "2005107_SceneGenerator.h"
+#include <cmath>
+#include <random>
+
+#include "../Sphere/2005107_Sphere.h"
+#include "../Triangle/2005107_Triangle.h"
+#include "../General/2005107_General.h"
+
+namespace
+{
+    // Half the side of the square around the origin that objects are scattered over
+    const double SCENE_EXTENT = 150;
+
+    class SceneRandom
+    {
+    private:
+        mt19937 engine;
+
+    public:
+        explicit SceneRandom(unsigned int seed) : engine(seed) {}
+
+        double uniform(double low, double high)
+        {
+            return uniform_real_distribution<double>(low, high)(engine);
+        }
+
+        Color color()
+        {
+            return Color(uniform(0.2, 1), uniform(0.2, 1), uniform(0.2, 1));
+        }
+    };
+
+    void setMaterial(Object *object, SceneRandom &random, double reflection)
+    {
+        object->setColor(random.color());
+        object->setCoefficients(Coefficients(0.3, 0.4, 0.2, reflection));
+        object->setShine((int)random.uniform(5, 30));
+    }
+
+    void addSpheres(const SceneSpec &spec, SceneRandom &random, vector<Object *> &objects)
+    {
+        for (int k = 0; k < spec.sphereCount; k++)
+        {
+            double radius = random.uniform(2, 12);
+            Vector3D center(random.uniform(-SCENE_EXTENT, SCENE_EXTENT), random.uniform(-SCENE_EXTENT, SCENE_EXTENT),
+                            random.uniform(radius, 80));
+            Sphere *sphere = new Sphere(center, radius);
+            setMaterial(sphere, random, spec.reflection);
+            objects.push_back(sphere);
+        }
+    }
+
+    // Rolling terrain: a smooth height function sampled on a regular grid
+    void addTriangleGrid(const SceneSpec &spec, SceneRandom &random, vector<Object *> &objects)
+    {
+        int size = spec.triangleGridSize;
+        double cell = 2 * SCENE_EXTENT / size;
+        double phaseX = random.uniform(0, 6.28), phaseY = random.uniform(0, 6.28);
+        auto vertex = [&](int i, int j) {
+            double x = -SCENE_EXTENT + i * cell, y = -SCENE_EXTENT + j * cell;
+            double z = 15 + 10 * sin(x / 25 + phaseX) * cos(y / 30 + phaseY);
+            return Vector3D(x, y, z);
+        };
+
+        for (int j = 0; j < size; j++)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                Vector3D a = vertex(i, j), b = vertex(i + 1, j), c = vertex(i + 1, j + 1), d = vertex(i, j + 1);
+                Triangle *lower = new Triangle(a, b, c);
+                Triangle *upper = new Triangle(a, c, d);
+                setMaterial(lower, random, spec.reflection);
+                setMaterial(upper, random, spec.reflection);
+                objects.push_back(lower);
+                objects.push_back(upper);
+            }
+        }
+    }
+
+    // Alternates cylinders (x^2 + y^2 = r^2 clipped in height) and ellipsoids,
+    // each moved to a random spot and clipped to its own box
+    void addQuadrics(const SceneSpec &spec, SceneRandom &random, vector<Object *> &objects)
+    {
+        for (int k = 0; k < spec.quadricCount; k++)
+        {
+            double cx = random.uniform(-SCENE_EXTENT, SCENE_EXTENT), cy = random.uniform(-SCENE_EXTENT, SCENE_EXTENT);
+            double radius = random.uniform(2, 8);
+            General *quadric;
+            Vector3D corner(cx - radius, cy - radius, 0);
+            double height;
+            if (k % 2 == 0)
+            {
+                // (x - cx)^2 + (y - cy)^2 - r^2 = 0
+                height = random.uniform(20, 70);
+                quadric = new General(1, 1, 0, 0, 0, 0, -2 * cx, -2 * cy, 0, cx * cx + cy * cy - radius * radius);
+            }
+            else
+            {
+                // (x - cx)^2 / r^2 + (y - cy)^2 / r^2 + (z - cz)^2 / s^2 = 1, resting on the floor
+                double stretch = random.uniform(1, 3) * radius;
+                double cz = stretch;
+                height = 2 * stretch;
+                double ax = 1 / (radius * radius), az = 1 / (stretch * stretch);
+                quadric = new General(ax, ax, az, 0, 0, 0, -2 * cx * ax, -2 * cy * ax, -2 * cz * az,
+                                      (cx * cx + cy * cy) * ax + cz * cz * az - 1);
+            }
+            quadric->setBoundingBox(corner, 2 * radius, 2 * radius, height);
+            setMaterial(quadric, random, spec.reflection);
+            objects.push_back(quadric);
+        }
+    }
+
+    void addLights(const SceneSpec &spec, SceneRandom &random, vector<PointLight *> &pointLights,
+                   vector<SpotLight *> &spotLights)
+    {
+        // Dimmer lights when there are many, so images stay comparable rather than saturating
+        double intensity = 1.0 / sqrt((double)max(1, spec.pointLightCount + spec.spotLightCount));
+
+        for (int k = 0; k < spec.pointLightCount; k++)
+        {
+            PointLight *light = new PointLight();
+            light->setLightPosition(random.uniform(-SCENE_EXTENT, SCENE_EXTENT), random.uniform(-SCENE_EXTENT, SCENE_EXTENT),
+                                    random.uniform(100, 200));
+            light->setColor(random.color() * intensity);
+            pointLights.push_back(light);
+        }
+
+        for (int k = 0; k < spec.spotLightCount; k++)
+        {
+            SpotLight *light = new SpotLight();
+            double x = random.uniform(-SCENE_EXTENT, SCENE_EXTENT), y = random.uniform(-SCENE_EXTENT, SCENE_EXTENT);
+            light->setLightPosition(x, y, random.uniform(100, 200));
+            light->setColor(random.color() * intensity);
+            // Aimed roughly back at the middle of the scene
+            light->setLightDirection(-x * 0.5, -y * 0.5, -150);
+            light->setCutoffAngle(random.uniform(15, 40));
+            spotLights.push_back(light);
+        }
+    }
+}
+
+vector<SceneSpec> benchmarkSceneSpecs()
+{
+    // name, spheres, grid, quadrics, point lights, spot lights, recursion, image size, reflection, seed
+    return {
+        SceneSpec{"random-spheres", 1000, 0, 0, 4, 0, 3, 256, 0.2, 1},
+        SceneSpec{"triangle-grid", 0, 48, 0, 2, 2, 2, 256, 0.1, 2},
+        SceneSpec{"quadric-forest", 20, 0, 200, 4, 0, 2, 256, 0.2, 3},
+        SceneSpec{"many-lights", 100, 0, 0, 24, 8, 1, 256, 0.0, 4},
+        SceneSpec{"deep-reflections", 40, 0, 0, 3, 1, 6, 256, 0.5, 5},
+    };
+}
+
+void generateScene(const SceneSpec &spec, vector<Object *> &objects, vector<PointLight *> &pointLights,
+                   vector<SpotLight *> &spotLights)
+{
+    SceneRandom random(spec.seed);
+    addSpheres(spec, random, objects);
+    if (spec.triangleGridSize > 0)
+    {
+        addTriangleGrid(spec, random, objects);
+    }
+    addQuadrics(spec, random, objects);
+    addLights(spec, random, pointLights, spotLights);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Object/2005107_Object.h"
+#include "../PointLight/2005107_PointLight.h"
+#include "../SpotLight/2005107_SpotLight.h"
+
+// Parameters of a procedurally generated scene. Everything is placed above the
+// floor within view of the initial camera, and the same spec and seed always
+// produce the same scene.
+struct SceneSpec
+{
+    string name;
+    int sphereCount;
+    int triangleGridSize; // a gridSize x gridSize heightfield of 2 * gridSize^2 triangles, 0 for none
+    int quadricCount;     // upright bounded cylinders and ellipsoids
+    int pointLightCount;
+    int spotLightCount;
+    int recursionLevel;
+    int imageSize;
+    double reflection; // reflection coefficient given to every generated object
+    unsigned int seed;
+};
+
+// The scenes the benchmark suite renders, each stressing a different part of the renderer
+vector<SceneSpec> benchmarkSceneSpecs();
+
+// Appends the spec's objects and lights; the caller owns them afterwards. The
+// floor is not included, since the renderer adds its own.
+void generateScene(const SceneSpec &spec, vector<Object *> &objects, vector<PointLight *> &pointLights,
+                   vector<SpotLight *> &spotLights);
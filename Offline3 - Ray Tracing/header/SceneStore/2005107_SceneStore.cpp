@@ -0,0 +1,29 @@
+#include "2005107_SceneStore.h"
+
+Sphere &SceneStore::addSphere(const Vector3D &centre, double radius)
+{
+    return spheres.add(centre, radius);
+}
+
+Triangle &SceneStore::addTriangle(const Vector3D &a, const Vector3D &b, const Vector3D &c)
+{
+    return triangles.add(a, b, c);
+}
+
+General &SceneStore::addGeneral(const double coefficients[10])
+{
+    const double *c = coefficients;
+    return generals.add(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9]);
+}
+
+bool SceneStore::owns(const Object *object) const
+{
+    return spheres.contains(object) || triangles.contains(object) || generals.contains(object);
+}
+
+void SceneStore::clear()
+{
+    spheres.clear();
+    triangles.clear();
+    generals.clear();
+}
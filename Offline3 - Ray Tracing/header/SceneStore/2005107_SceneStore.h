@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+using namespace std;
+
+#include "../Object/2005107_Object.h"
+#include "../Sphere/2005107_Sphere.h"
+#include "../Triangle/2005107_Triangle.h"
+#include "../General/2005107_General.h"
+
+// Append only array whose elements never move: it grows by adding blocks,
+// each twice the size of the last, instead of reallocating, so a reference
+// to an element stays valid until clear(). A million elements take about
+// a dozen blocks.
+template <class T>
+class BlockArray
+{
+private:
+    static const size_t FIRST_BLOCK = 256;
+
+    struct Block
+    {
+        T *items;
+        size_t size, capacity;
+    };
+    vector<Block> blocks;
+
+public:
+    BlockArray() {}
+    BlockArray(const BlockArray &) = delete;
+    BlockArray &operator=(const BlockArray &) = delete;
+    ~BlockArray() { clear(); }
+
+    // Constructs the element in place from args
+    template <class... Args>
+    T &add(Args &&...args)
+    {
+        if (blocks.empty() || blocks.back().size == blocks.back().capacity)
+        {
+            size_t capacity = blocks.empty() ? FIRST_BLOCK : 2 * blocks.back().capacity;
+            Block block;
+            block.items = static_cast<T *>(::operator new(capacity * sizeof(T)));
+            block.size = 0;
+            block.capacity = capacity;
+            blocks.push_back(block);
+        }
+        Block &block = blocks.back();
+        T *item = new (block.items + block.size) T(std::forward<Args>(args)...);
+        block.size++;
+        return *item;
+    }
+
+    bool contains(const void *address) const
+    {
+        for (const Block &block : blocks)
+        {
+            // Integer addresses, since pointers into different blocks cannot be compared
+            size_t begin = (size_t)block.items, end = (size_t)(block.items + block.size);
+            if ((size_t)address >= begin && (size_t)address < end)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        for (Block &block : blocks)
+        {
+            for (size_t k = 0; k < block.size; k++)
+            {
+                block.items[k].~T();
+            }
+            ::operator delete(block.items);
+        }
+        blocks.clear();
+    }
+};
+
+// Owns the primitives read from a scene file. They are built in place in one
+// block array per type instead of one heap allocation each, which makes
+// loading large scenes much cheaper and keeps objects of a type together in
+// memory. Meshes, the floor and generated scenes are still allocated one by
+// one and freed by whoever frees the scene.
+class SceneStore
+{
+private:
+    BlockArray<Sphere> spheres;
+    BlockArray<Triangle> triangles;
+    BlockArray<General> generals;
+
+public:
+    // Each object is built in place and stays where it is until clear()
+    Sphere &addSphere(const Vector3D &centre, double radius);
+    Triangle &addTriangle(const Vector3D &a, const Vector3D &b, const Vector3D &c);
+    General &addGeneral(const double coefficients[10]);
+
+    // True when object lives in the store, so it must not be deleted
+    bool owns(const Object *object) const;
+    void clear();
+};
@@ -0,0 +1,50 @@
+#include "2005107_ScratchArena.h"
+#include <algorithm>
+
+const size_t ScratchArena::MINIMUM_CAPACITY;
+
+ScratchArena::ScratchArena() : buffer(nullptr), capacity(0), used(0), generation(0)
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    delete[] buffer;
+}
+
+void ScratchArena::reset(size_t minimumCapacity)
+{
+    used = 0;
+    generation++;
+
+    minimumCapacity = max(minimumCapacity, MINIMUM_CAPACITY);
+    if (capacity < minimumCapacity)
+    {
+        // operator new[] returns memory aligned for any fundamental type, which
+        // allocate() relies on when it aligns offsets
+        delete[] buffer;
+        buffer = new unsigned char[minimumCapacity];
+        capacity = minimumCapacity;
+    }
+}
+
+size_t ScratchArena::getCapacity() const
+{
+    return capacity;
+}
+
+size_t ScratchArena::getUsed() const
+{
+    return used;
+}
+
+unsigned long long ScratchArena::getGeneration() const
+{
+    return generation;
+}
+
+ScratchArena &threadScratchArena()
+{
+    static thread_local ScratchArena arena;
+    return arena;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+using namespace std;
+
+// Bump allocator for short-lived per-thread state on the trace and shade path.
+// reset() is the only call that may touch the heap, and only when the buffer
+// has to grow; allocate() just advances an offset, so a tile can carve out its
+// buffers without malloc and without locking. Nothing is destroyed on reset(),
+// so only trivially destructible types belong here.
+class ScratchArena
+{
+private:
+    unsigned char *buffer;
+    size_t capacity;
+    size_t used;
+    unsigned long long generation;
+
+public:
+    // Capacity every reset() provides at least, whatever its caller asks for
+    static const size_t MINIMUM_CAPACITY = 64 * 1024;
+
+    ScratchArena();
+    ~ScratchArena();
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    // Releases every allocation and makes room for at least minimumCapacity bytes
+    void reset(size_t minimumCapacity = 0);
+
+    // Uninitialised space for count Ts, or nullptr once the arena is exhausted
+    template <class T>
+    T *allocate(size_t count)
+    {
+        size_t start = (used + alignof(T) - 1) / alignof(T) * alignof(T);
+        if (start > capacity || count > (capacity - start) / sizeof(T))
+        {
+            return nullptr;
+        }
+        used = start + count * sizeof(T);
+        return reinterpret_cast<T *>(buffer + start);
+    }
+
+    size_t getCapacity() const;
+    size_t getUsed() const;
+    // Changes on every reset(), so holders of arena memory can tell theirs is gone
+    unsigned long long getGeneration() const;
+};
+
+// The calling thread's arena; empty until its first reset() and freed when the thread exits
+ScratchArena &threadScratchArena();
@@ -0,0 +1,228 @@
+#pragma once
+
+// Three lane arithmetic behind Vector3D and Color. Lanes3<T> holds x, y, z (or
+// red, green, blue) in SIMD registers: one SSE register of floats, or an SSE2
+// pair (x y | z) of doubles; NEON is used the same way on AArch64. Every lane
+// is rounded exactly as the scalar expression would be, and dot() adds in
+// x, y, z order, so results match the scalar code and the packet kernels bit
+// for bit. The fused helpers built on it (mulAdd) are likewise a multiply
+// then an add, never a contracted FMA. Build with -DRENDER_SCALAR_MATH to
+// force the plain fallback.
+//
+// Values are loaded from and stored to the three packed fields of the caller,
+// so Vector3D and Color keep their 3 x sizeof(T) layout.
+
+#include <cmath>
+
+#if !defined(RENDER_SCALAR_MATH) && (defined(__SSE2__) || defined(_M_X64))
+#define SIMD_MATH_SSE2
+#include <emmintrin.h>
+#elif !defined(RENDER_SCALAR_MATH) && defined(__ARM_NEON) && defined(__aarch64__)
+#define SIMD_MATH_NEON
+#include <arm_neon.h>
+#endif
+
+// Plain fallback, also used for any scalar type without a specialisation
+template <class T>
+struct Lanes3
+{
+    T x, y, z;
+
+    static inline Lanes3 load(const T *source)
+    {
+        Lanes3 lanes = {source[0], source[1], source[2]};
+        return lanes;
+    }
+    static inline Lanes3 set1(T value)
+    {
+        Lanes3 lanes = {value, value, value};
+        return lanes;
+    }
+    inline void store(T *destination) const
+    {
+        destination[0] = x;
+        destination[1] = y;
+        destination[2] = z;
+    }
+
+    friend inline Lanes3 operator+(Lanes3 a, Lanes3 b) { return make(a.x + b.x, a.y + b.y, a.z + b.z); }
+    friend inline Lanes3 operator-(Lanes3 a, Lanes3 b) { return make(a.x - b.x, a.y - b.y, a.z - b.z); }
+    friend inline Lanes3 operator*(Lanes3 a, Lanes3 b) { return make(a.x * b.x, a.y * b.y, a.z * b.z); }
+    friend inline Lanes3 operator/(Lanes3 a, Lanes3 b) { return make(a.x / b.x, a.y / b.y, a.z / b.z); }
+    static inline Lanes3 minimum(Lanes3 a, Lanes3 b) { return make(b.x < a.x ? b.x : a.x, b.y < a.y ? b.y : a.y, b.z < a.z ? b.z : a.z); }
+    static inline Lanes3 maximum(Lanes3 a, Lanes3 b) { return make(a.x < b.x ? b.x : a.x, a.y < b.y ? b.y : a.y, a.z < b.z ? b.z : a.z); }
+    static inline T dot(Lanes3 a, Lanes3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+private:
+    static inline Lanes3 make(T x, T y, T z)
+    {
+        Lanes3 lanes = {x, y, z};
+        return lanes;
+    }
+};
+
+#if defined(SIMD_MATH_SSE2)
+
+template <>
+struct Lanes3<double>
+{
+    __m128d xy, z; // z in the low lane; the high lane is never read
+
+    static inline Lanes3 load(const double *source) { return make(_mm_loadu_pd(source), _mm_load_sd(source + 2)); }
+    static inline Lanes3 set1(double value)
+    {
+        __m128d all = _mm_set1_pd(value);
+        return make(all, all);
+    }
+    inline void store(double *destination) const
+    {
+        _mm_storeu_pd(destination, xy);
+        _mm_store_sd(destination + 2, z);
+    }
+
+    friend inline Lanes3 operator+(Lanes3 a, Lanes3 b) { return make(_mm_add_pd(a.xy, b.xy), _mm_add_sd(a.z, b.z)); }
+    friend inline Lanes3 operator-(Lanes3 a, Lanes3 b) { return make(_mm_sub_pd(a.xy, b.xy), _mm_sub_sd(a.z, b.z)); }
+    friend inline Lanes3 operator*(Lanes3 a, Lanes3 b) { return make(_mm_mul_pd(a.xy, b.xy), _mm_mul_sd(a.z, b.z)); }
+    friend inline Lanes3 operator/(Lanes3 a, Lanes3 b) { return make(_mm_div_pd(a.xy, b.xy), _mm_div_sd(a.z, b.z)); }
+    // Operand order matches std::min and std::max, including which value wins for NaN
+    static inline Lanes3 minimum(Lanes3 a, Lanes3 b) { return make(_mm_min_pd(b.xy, a.xy), _mm_min_sd(b.z, a.z)); }
+    static inline Lanes3 maximum(Lanes3 a, Lanes3 b) { return make(_mm_max_pd(b.xy, a.xy), _mm_max_sd(b.z, a.z)); }
+    static inline double dot(Lanes3 a, Lanes3 b)
+    {
+        __m128d products = _mm_mul_pd(a.xy, b.xy);
+        __m128d sum = _mm_add_sd(products, _mm_unpackhi_pd(products, products));
+        return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_mul_sd(a.z, b.z)));
+    }
+
+private:
+    static inline Lanes3 make(__m128d xy, __m128d z)
+    {
+        Lanes3 lanes = {xy, z};
+        return lanes;
+    }
+};
+
+template <>
+struct Lanes3<float>
+{
+    __m128 xyzw; // w is a don't-care lane that is never stored
+
+    static inline Lanes3 load(const float *source)
+    {
+        // Through __m64, which may alias the floats (a double load would not)
+        __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(source));
+        return make(_mm_movelh_ps(xy, _mm_load_ss(source + 2)));
+    }
+    static inline Lanes3 set1(float value) { return make(_mm_set1_ps(value)); }
+    inline void store(float *destination) const
+    {
+        _mm_storel_pi(reinterpret_cast<__m64 *>(destination), xyzw);
+        _mm_store_ss(destination + 2, _mm_movehl_ps(xyzw, xyzw));
+    }
+
+    friend inline Lanes3 operator+(Lanes3 a, Lanes3 b) { return make(_mm_add_ps(a.xyzw, b.xyzw)); }
+    friend inline Lanes3 operator-(Lanes3 a, Lanes3 b) { return make(_mm_sub_ps(a.xyzw, b.xyzw)); }
+    friend inline Lanes3 operator*(Lanes3 a, Lanes3 b) { return make(_mm_mul_ps(a.xyzw, b.xyzw)); }
+    friend inline Lanes3 operator/(Lanes3 a, Lanes3 b) { return make(_mm_div_ps(a.xyzw, b.xyzw)); }
+    static inline Lanes3 minimum(Lanes3 a, Lanes3 b) { return make(_mm_min_ps(b.xyzw, a.xyzw)); }
+    static inline Lanes3 maximum(Lanes3 a, Lanes3 b) { return make(_mm_max_ps(b.xyzw, a.xyzw)); }
+    static inline float dot(Lanes3 a, Lanes3 b)
+    {
+        __m128 products = _mm_mul_ps(a.xyzw, b.xyzw);
+        __m128 sum = _mm_add_ss(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(products, products)));
+    }
+
+private:
+    static inline Lanes3 make(__m128 xyzw)
+    {
+        Lanes3 lanes = {xyzw};
+        return lanes;
+    }
+};
+
+#elif defined(SIMD_MATH_NEON)
+
+template <>
+struct Lanes3<double>
+{
+    float64x2_t xy, z; // z in lane 0
+
+    static inline Lanes3 load(const double *source) { return make(vld1q_f64(source), vdupq_n_f64(source[2])); }
+    static inline Lanes3 set1(double value)
+    {
+        float64x2_t all = vdupq_n_f64(value);
+        return make(all, all);
+    }
+    inline void store(double *destination) const
+    {
+        vst1q_f64(destination, xy);
+        destination[2] = vgetq_lane_f64(z, 0);
+    }
+
+    friend inline Lanes3 operator+(Lanes3 a, Lanes3 b) { return make(vaddq_f64(a.xy, b.xy), vaddq_f64(a.z, b.z)); }
+    friend inline Lanes3 operator-(Lanes3 a, Lanes3 b) { return make(vsubq_f64(a.xy, b.xy), vsubq_f64(a.z, b.z)); }
+    friend inline Lanes3 operator*(Lanes3 a, Lanes3 b) { return make(vmulq_f64(a.xy, b.xy), vmulq_f64(a.z, b.z)); }
+    friend inline Lanes3 operator/(Lanes3 a, Lanes3 b) { return make(vdivq_f64(a.xy, b.xy), vdivq_f64(a.z, b.z)); }
+    static inline Lanes3 minimum(Lanes3 a, Lanes3 b) { return make(vbslq_f64(vcltq_f64(b.xy, a.xy), b.xy, a.xy), vbslq_f64(vcltq_f64(b.z, a.z), b.z, a.z)); }
+    static inline Lanes3 maximum(Lanes3 a, Lanes3 b) { return make(vbslq_f64(vcltq_f64(a.xy, b.xy), b.xy, a.xy), vbslq_f64(vcltq_f64(a.z, b.z), b.z, a.z)); }
+    static inline double dot(Lanes3 a, Lanes3 b)
+    {
+        float64x2_t products = vmulq_f64(a.xy, b.xy);
+        return (vgetq_lane_f64(products, 0) + vgetq_lane_f64(products, 1)) + vgetq_lane_f64(a.z, 0) * vgetq_lane_f64(b.z, 0);
+    }
+
+private:
+    static inline Lanes3 make(float64x2_t xy, float64x2_t z)
+    {
+        Lanes3 lanes = {xy, z};
+        return lanes;
+    }
+};
+
+template <>
+struct Lanes3<float>
+{
+    float32x4_t xyzw;
+
+    static inline Lanes3 load(const float *source) { return make(vcombine_f32(vld1_f32(source), vdup_n_f32(source[2]))); }
+    static inline Lanes3 set1(float value) { return make(vdupq_n_f32(value)); }
+    inline void store(float *destination) const
+    {
+        vst1_f32(destination, vget_low_f32(xyzw));
+        destination[2] = vgetq_lane_f32(xyzw, 2);
+    }
+
+    friend inline Lanes3 operator+(Lanes3 a, Lanes3 b) { return make(vaddq_f32(a.xyzw, b.xyzw)); }
+    friend inline Lanes3 operator-(Lanes3 a, Lanes3 b) { return make(vsubq_f32(a.xyzw, b.xyzw)); }
+    friend inline Lanes3 operator*(Lanes3 a, Lanes3 b) { return make(vmulq_f32(a.xyzw, b.xyzw)); }
+    friend inline Lanes3 operator/(Lanes3 a, Lanes3 b) { return make(vdivq_f32(a.xyzw, b.xyzw)); }
+    static inline Lanes3 minimum(Lanes3 a, Lanes3 b) { return make(vbslq_f32(vcltq_f32(b.xyzw, a.xyzw), b.xyzw, a.xyzw)); }
+    static inline Lanes3 maximum(Lanes3 a, Lanes3 b) { return make(vbslq_f32(vcltq_f32(a.xyzw, b.xyzw), b.xyzw, a.xyzw)); }
+    static inline float dot(Lanes3 a, Lanes3 b)
+    {
+        float32x4_t products = vmulq_f32(a.xyzw, b.xyzw);
+        return (vgetq_lane_f32(products, 0) + vgetq_lane_f32(products, 1)) + vgetq_lane_f32(products, 2);
+    }
+
+private:
+    static inline Lanes3 make(float32x4_t xyzw)
+    {
+        Lanes3 lanes = {xyzw};
+        return lanes;
+    }
+};
+
+#endif
+
+// Name of the backend compiled in, for logs and benchmark output
+inline const char *simdMathName()
+{
+#if defined(SIMD_MATH_SSE2)
+    return "sse2";
+#elif defined(SIMD_MATH_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -1,13 +1,16 @@
 #include "2005107_Sphere.h"
+#include "../RenderStats/2005107_RenderStats.h"
 #include <algorithm>
 #include <cmath>
 
+#ifndef RENDER_ONLY
 #ifdef __linux__
 #include <GL/glut.h>
 #elif WIN32
 #include <glut.h>
 #include <windows.h>
 #endif
+#endif
 
 Sphere::Sphere() : Object()
 {
@@ -27,6 +30,7 @@ Sphere::Sphere(Vector3D center, double radius) : Object()
 
 void Sphere::draw()
 {
+#ifndef RENDER_ONLY
     glPushMatrix();
     {
         glColor3f(color.getRed(), color.getGreen(), color.getBlue());
@@ -34,6 +38,7 @@ void Sphere::draw()
         glutSolidSphere(length, 200, 200);
     }
     glPopMatrix();
+#endif
 }
 
 Vector3D Sphere::computeNormal(Vector3D point)
@@ -43,41 +48,59 @@ Vector3D Sphere::computeNormal(Vector3D point)
     return normal;
 }
 
-double Sphere::intersect(Ray *ray)
+bool Sphere::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit)
 {
-    Vector3D originalOrigin = ray->getOrigin();
-    ray->setOrigin(ray->getOrigin() - referencePoint);
-    double a = 1;
-    double b = 2 * (ray->getDirection() * ray->getOrigin());
-    double c = ray->getOrigin() * ray->getOrigin() - length * length;
-    double discriminant = b * b - 4 * a * c;
-    ray->setOrigin(originalOrigin);
+    countStat(STAT_SPHERE_TESTS);
+    Vector3D origin = ray.getOrigin() - referencePoint;
+    Vector3D direction = ray.getDirection();
+
+    // The squared distance between the centre and the ray is taken from the
+    // closest point directly rather than as b^2 - 4c, which cancels badly when
+    // the ray starts far from a small sphere (and in float builds)
+    Real halfB = direction * origin;
+    Vector3D closest = origin - direction * halfB;
+    Real discriminant = length * length - closest * closest;
 
     if (discriminant < 0)
     {
-        return -1.0;
+        return false;
     }
-    else
+
+    // Try the nearer root first, then the farther one
+    double sqrtDiscriminant = sqrt(discriminant);
+    double t = -halfB - sqrtDiscriminant;
+    if (t <= tMin || t >= tMax)
     {
-        double t;
-        double t1 = (-b + sqrt(discriminant)) / (2 * a);
-        double t2 = (-b - sqrt(discriminant)) / (2 * a);
-        if (t1 > 0 && t2 > 0)
-        {
-            t = min(t1, t2);
-        }
-        else if (t1 > 0)
+        t = -halfB + sqrtDiscriminant;
+        if (t <= tMin || t >= tMax)
         {
-            t = t1;
+            return false;
         }
-        else if (t2 > 0)
-        {
-            t = t2;
-        }
-        else
-        {
-            t = -1.0;
-        }
-        return t;
     }
+
+    hit.t = t;
+    hit.object = this;
+    return true;
+}
+
+void Sphere::intersectPacket(const RayPacket &packet, PacketHit &hits)
+{
+    countStat(STAT_SPHERE_TESTS, packet.activeCount());
+    double center[3] = {referencePoint.x, referencePoint.y, referencePoint.z};
+    hits.setObject(getPacketKernels().sphere(packet, center, length, hits.t), this);
+}
+
+AABB Sphere::getBounds()
+{
+    return AABB(referencePoint - Vector3D(length, length, length), referencePoint + Vector3D(length, length, length));
+}
+
+Vector3D Sphere::getCenter() const
+{
+    return referencePoint;
+}
+
+double Sphere::getRadius() const
+{
+    return length;
 }
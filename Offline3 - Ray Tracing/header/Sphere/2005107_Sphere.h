@@ -2,7 +2,7 @@
 
 #include "../Object/2005107_Object.h"
 
-class Sphere : public Object
+class Sphere final : public Object
 {
 public:
     Sphere();
@@ -10,5 +10,10 @@ public:
     
     void draw() override;
     Vector3D computeNormal(Vector3D point) override;
-    double intersect(Ray *ray) override;
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) override;
+    void intersectPacket(const RayPacket &packet, PacketHit &hits) override;
+    AABB getBounds() override;
+
+    Vector3D getCenter() const;
+    double getRadius() const;
 };
@@ -0,0 +1,271 @@
+#include "2005107_TextScanner.h"
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const int MAX_FAST_DIGITS = 19; // any 19 digit number fits in an unsigned 64-bit mantissa
+    const int MAX_FAST_EXPONENT = 22;
+    const unsigned long long MAX_EXACT_MANTISSA = 1ULL << 53;
+
+    // Powers of ten that are exact in a double
+    const double POWERS_OF_TEN[MAX_FAST_EXPONENT + 1] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                                         1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                                         1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    bool isSpace(char c)
+    {
+        // ' ' and '\t' through '\r'
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Only reached for numbers the fast path cannot convert exactly; the program
+    // never changes the C locale, so strtod expects a '.' like the fast path
+    bool parseDecimalSlow(const char *begin, const char *end, double &value)
+    {
+        vector<char> buffer(begin, end);
+        buffer.push_back('\0');
+        char *parsedEnd;
+        value = strtod(buffer.data(), &parsedEnd);
+        return parsedEnd == buffer.data() + (end - begin);
+    }
+
+    // Reads the number starting at begin and returns where it stops, which is
+    // begin itself when there is none. fast is false when the digits do not fit
+    // the exact fast path, and the value is then left for parseDecimalSlow().
+    const char *scanDecimal(const char *begin, const char *end, double &value, bool &fast)
+    {
+        const char *p = begin;
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            p++;
+        }
+
+        // Significant digits go into mantissa; exponent is the power of ten it is scaled by
+        unsigned long long mantissa = 0;
+        int significantDigits = 0, exponent = 0;
+        bool anyDigits = false, truncated = false;
+        for (; p < end && isDigit(*p); p++)
+        {
+            anyDigits = true;
+            if (significantDigits < MAX_FAST_DIGITS)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                significantDigits += mantissa != 0;
+            }
+            else
+            {
+                truncated = true;
+                exponent++;
+            }
+        }
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && isDigit(*p); p++)
+            {
+                anyDigits = true;
+                if (significantDigits < MAX_FAST_DIGITS)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    significantDigits += mantissa != 0;
+                    exponent--;
+                }
+                else
+                {
+                    truncated = true;
+                }
+            }
+        }
+        if (!anyDigits)
+        {
+            return begin;
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char *exponentStart = p++;
+            bool negativeExponent = p < end && *p == '-';
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                p++;
+            }
+            if (p == end || !isDigit(*p))
+            {
+                // Stops at the 'e', so the caller sees a malformed token
+                return exponentStart;
+            }
+            int written = 0;
+            for (; p < end && isDigit(*p); p++)
+            {
+                // Far beyond any double; strtod gives the infinity or zero
+                written = written < 100000 ? written * 10 + (*p - '0') : written;
+            }
+            exponent += negativeExponent ? -written : written;
+        }
+
+        fast = !truncated && mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_FAST_EXPONENT && exponent <= MAX_FAST_EXPONENT;
+        if (fast)
+        {
+            double magnitude = (double)mantissa;
+            magnitude = exponent < 0 ? magnitude / POWERS_OF_TEN[-exponent] : magnitude * POWERS_OF_TEN[exponent];
+            value = negative ? -magnitude : magnitude;
+        }
+        return p;
+    }
+}
+
+bool parseDecimal(const char *begin, const char *end, double &value)
+{
+    bool fast;
+    if (begin == end || scanDecimal(begin, end, value, fast) != end)
+    {
+        return false;
+    }
+    return fast || parseDecimalSlow(begin, end, value);
+}
+
+bool parseInteger(const char *begin, const char *end, long long &value)
+{
+    const char *p = begin;
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        p++;
+    }
+    if (p == end)
+    {
+        return false;
+    }
+    unsigned long long magnitude = 0;
+    for (; p < end; p++)
+    {
+        if (!isDigit(*p) || magnitude > (ULLONG_MAX - 9) / 10)
+        {
+            return false;
+        }
+        magnitude = magnitude * 10 + (*p - '0');
+    }
+    if (magnitude > (unsigned long long)LLONG_MAX + (negative ? 1 : 0))
+    {
+        return false;
+    }
+    value = negative ? (long long)(0 - magnitude) : (long long)magnitude;
+    return true;
+}
+
+TextScanner::TextScanner(const char *begin, const char *end, const string &sourceName)
+    : cursor(begin), end(end), lineStart(begin), line(1), sourceName(sourceName), tokenStart(begin), tokenLine(1),
+      tokenColumn(1)
+{
+}
+
+void TextScanner::skipSpace()
+{
+    while (cursor < end && isSpace(*cursor))
+    {
+        if (*cursor == '\n')
+        {
+            line++;
+            lineStart = cursor + 1;
+        }
+        cursor++;
+    }
+    tokenStart = cursor;
+    tokenLine = line;
+    tokenColumn = cursor - lineStart + 1;
+}
+
+const char *TextScanner::tokenEnd() const
+{
+    const char *p = cursor;
+    while (p < end && !isSpace(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+bool TextScanner::expected(const char *what)
+{
+    if (tokenStart == end)
+    {
+        return fail(string("unexpected end of file, expected ") + what);
+    }
+    return fail(string("expected ") + what + ", found '" + string(tokenStart, tokenEnd()) + "'");
+}
+
+// Numbers are converted as they are scanned, in one pass over the text
+bool TextScanner::readDouble(double &value, const char *what)
+{
+    skipSpace();
+    bool fast;
+    const char *numberEnd = scanDecimal(cursor, end, value, fast);
+    if (numberEnd == cursor || (numberEnd < end && !isSpace(*numberEnd)) ||
+        (!fast && !parseDecimalSlow(cursor, numberEnd, value)))
+    {
+        return expected(what);
+    }
+    cursor = numberEnd;
+    return true;
+}
+
+bool TextScanner::readDoubles(double *values, int count, const char *what)
+{
+    for (int k = 0; k < count; k++)
+    {
+        if (!readDouble(values[k], what))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextScanner::readInt(int &value, const char *what)
+{
+    skipSpace();
+    const char *intEnd = tokenEnd();
+    long long parsed;
+    if (!parseInteger(cursor, intEnd, parsed) || parsed < INT_MIN || parsed > INT_MAX)
+    {
+        return expected(what);
+    }
+    value = parsed;
+    cursor = intEnd;
+    return true;
+}
+
+bool TextScanner::readWord(string &word, const char *what)
+{
+    skipSpace();
+    if (cursor == end)
+    {
+        return expected(what);
+    }
+    const char *wordEnd = tokenEnd();
+    word.assign(cursor, wordEnd);
+    cursor = wordEnd;
+    return true;
+}
+
+bool TextScanner::fail(const string &message)
+{
+    if (error.empty())
+    {
+        error = sourceName + ":" + to_string(tokenLine) + ":" + to_string(tokenColumn) + ": " + message;
+    }
+    return false;
+}
+
+const string &TextScanner::getError() const
+{
+    return error;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+using namespace std;
+
+// Locale independent number parsing over [begin, end), which need not be null
+// terminated. The whole range must be the number. Decimals with up to 19
+// significant digits and a decimal exponent within +-22, which covers every
+// hand written or generated scene, are converted exactly with one
+// multiplication or division (Clinger's fast path); anything else is handed
+// to strtod, so the result is always the correctly rounded double.
+bool parseDecimal(const char *begin, const char *end, double &value);
+bool parseInteger(const char *begin, const char *end, long long &value);
+
+// Reads whitespace separated tokens from a memory mapped file in place,
+// keeping track of where each one starts so errors can point at it. Every
+// read returns false on failure and leaves a "name:line:column: message"
+// description in getError(); the first error is kept.
+class TextScanner
+{
+private:
+    const char *cursor, *end;
+    const char *lineStart;
+    int line;
+    string sourceName;
+    string error;
+    // Start, line and column of the last token read, for fail()
+    const char *tokenStart;
+    int tokenLine, tokenColumn;
+
+    // Moves to the start of the next token, or the end of the text
+    void skipSpace();
+    // End of the token at the cursor
+    const char *tokenEnd() const;
+    bool expected(const char *what);
+
+public:
+    TextScanner(const char *begin, const char *end, const string &sourceName);
+
+    bool readDouble(double &value, const char *what);
+    // count values, all described by what
+    bool readDoubles(double *values, int count, const char *what);
+    bool readInt(int &value, const char *what);
+    bool readWord(string &word, const char *what);
+
+    // Reports message at the last token read
+    bool fail(const string &message);
+    const string &getError() const;
+};
@@ -0,0 +1,172 @@
+#include "2005107_TileScheduler.h"
+#include "../RenderStats/2005107_RenderStats.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+TileScheduler::TileScheduler(int imageWidth, int imageHeight, int tileSize, int threadCount)
+    : imageWidth(imageWidth), imageHeight(imageHeight), tileSize(max(1, tileSize)), threadCount(max(1, threadCount))
+{
+    for (int y = 0; y < imageHeight; y += this->tileSize)
+    {
+        for (int x = 0; x < imageWidth; x += this->tileSize)
+        {
+            Tile tile;
+            tile.index = tiles.size();
+            tile.x0 = x;
+            tile.y0 = y;
+            tile.x1 = min(x + this->tileSize, imageWidth);
+            tile.y1 = min(y + this->tileSize, imageHeight);
+            tiles.push_back(tile);
+        }
+    }
+    timings.assign(tiles.size(), TileTiming{-1, 0.0});
+}
+
+bool TileScheduler::popLocal(vector<WorkerQueue> &queues, int workerId, int &tileIndex)
+{
+    WorkerQueue &queue = queues[workerId];
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.tileIndices.empty())
+    {
+        return false;
+    }
+    tileIndex = queue.tileIndices.front();
+    queue.tileIndices.pop_front();
+    return true;
+}
+
+bool TileScheduler::steal(vector<WorkerQueue> &queues, int workerId, int &tileIndex)
+{
+    for (int offset = 1; offset < threadCount; offset++)
+    {
+        WorkerQueue &victim = queues[(workerId + offset) % threadCount];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tileIndices.empty())
+        {
+            tileIndex = victim.tileIndices.back();
+            victim.tileIndices.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TileScheduler::workerLoop(vector<WorkerQueue> &queues, int workerId, const function<void(const Tile &)> &renderTile)
+{
+    int tileIndex;
+    while (popLocal(queues, workerId, tileIndex) || steal(queues, workerId, tileIndex))
+    {
+        auto start = chrono::steady_clock::now();
+        renderTile(tiles[tileIndex]);
+        auto end = chrono::steady_clock::now();
+
+        // Each tile index is rendered by exactly one worker, so no locking is needed here
+        timings[tileIndex].threadId = workerId;
+        timings[tileIndex].milliseconds = chrono::duration<double, milli>(end - start).count();
+    }
+
+    // Merges this worker's render statistics while its thread is still alive
+    flushThreadRenderStats();
+}
+
+void TileScheduler::run(const function<void(const Tile &)> &renderTile)
+{
+    vector<WorkerQueue> queues(threadCount);
+
+    // Deal tiles round-robin so every worker starts with a spread of image regions
+    for (int i = 0; i < (int)tiles.size(); i++)
+    {
+        queues[i % threadCount].tileIndices.push_back(i);
+    }
+
+    vector<thread> workers;
+    for (int workerId = 1; workerId < threadCount; workerId++)
+    {
+        workers.emplace_back(&TileScheduler::workerLoop, this, ref(queues), workerId, cref(renderTile));
+    }
+    workerLoop(queues, 0, renderTile);
+
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+int TileScheduler::getThreadCount() const
+{
+    return threadCount;
+}
+
+const vector<Tile> &TileScheduler::getTiles() const
+{
+    return tiles;
+}
+
+const vector<TileTiming> &TileScheduler::getTimings() const
+{
+    return timings;
+}
+
+void TileScheduler::printTimingSummary(ostream &out) const
+{
+    if (tiles.empty())
+    {
+        return;
+    }
+
+    vector<double> busyTime(threadCount, 0.0);
+    vector<int> tilesRendered(threadCount, 0);
+    double total = 0.0;
+    int slowest = 0, fastest = 0;
+    for (int i = 0; i < (int)tiles.size(); i++)
+    {
+        total += timings[i].milliseconds;
+        if (timings[i].threadId >= 0)
+        {
+            busyTime[timings[i].threadId] += timings[i].milliseconds;
+            tilesRendered[timings[i].threadId]++;
+        }
+        if (timings[i].milliseconds > timings[slowest].milliseconds)
+        {
+            slowest = i;
+        }
+        if (timings[i].milliseconds < timings[fastest].milliseconds)
+        {
+            fastest = i;
+        }
+    }
+
+    out << "Tiles: " << tiles.size() << " (" << tileSize << "x" << tileSize << ") on " << threadCount << " thread(s)" << endl;
+    out << "Tile time (ms): min " << timings[fastest].milliseconds
+        << ", avg " << total / tiles.size()
+        << ", max " << timings[slowest].milliseconds
+        << " at (" << tiles[slowest].x0 << ", " << tiles[slowest].y0 << ")" << endl;
+    for (int i = 0; i < threadCount; i++)
+    {
+        out << "  Thread " << i << ": " << tilesRendered[i] << " tiles, " << busyTime[i] << " ms busy" << endl;
+    }
+}
+
+void TileScheduler::saveTimings(const string &fileName) const
+{
+    ofstream out(fileName);
+    if (!out)
+    {
+        cerr << "Could not write tile timings to " << fileName << endl;
+        return;
+    }
+    out << "tile,x0,y0,x1,y1,thread,milliseconds" << endl;
+    for (int i = 0; i < (int)tiles.size(); i++)
+    {
+        out << i << "," << tiles[i].x0 << "," << tiles[i].y0 << "," << tiles[i].x1 << "," << tiles[i].y1
+            << "," << timings[i].threadId << "," << timings[i].milliseconds << endl;
+    }
+}
+
+int TileScheduler::defaultThreadCount()
+{
+    unsigned int hardwareThreads = thread::hardware_concurrency();
+    return hardwareThreads == 0 ? 1 : (int)hardwareThreads;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+// A rectangular block of pixels, [x0, x1) x [y0, y1)
+struct Tile
+{
+    int index;
+    int x0, y0, x1, y1;
+};
+
+struct TileTiming
+{
+    int threadId;
+    double milliseconds;
+};
+
+class TileScheduler
+{
+private:
+    // Each worker owns a queue; it pops from the front of its own queue
+    // and steals from the back of the others once it runs dry
+    struct WorkerQueue
+    {
+        deque<int> tileIndices;
+        mutex lock;
+    };
+
+    int imageWidth, imageHeight;
+    int tileSize;
+    int threadCount;
+    vector<Tile> tiles;
+    vector<TileTiming> timings;
+
+    bool popLocal(vector<WorkerQueue> &queues, int workerId, int &tileIndex);
+    bool steal(vector<WorkerQueue> &queues, int workerId, int &tileIndex);
+    void workerLoop(vector<WorkerQueue> &queues, int workerId, const function<void(const Tile &)> &renderTile);
+
+public:
+    TileScheduler(int imageWidth, int imageHeight, int tileSize, int threadCount);
+
+    // Renders every tile exactly once, blocking until all workers are done
+    void run(const function<void(const Tile &)> &renderTile);
+
+    int getThreadCount() const;
+    const vector<Tile> &getTiles() const;
+    const vector<TileTiming> &getTimings() const;
+
+    void printTimingSummary(ostream &out) const;
+    void saveTimings(const string &fileName) const;
+
+    static int defaultThreadCount();
+};
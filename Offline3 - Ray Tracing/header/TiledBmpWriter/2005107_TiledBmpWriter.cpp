@@ -0,0 +1,240 @@
+#include "2005107_TiledBmpWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    const int FILE_HEADER_BYTES = 14;
+    const int INFO_HEADER_BYTES = 40;
+    const int HEADER_BYTES = FILE_HEADER_BYTES + INFO_HEADER_BYTES;
+
+    void putLittleEndian(unsigned char *out, unsigned long long value, int bytes)
+    {
+        for (int k = 0; k < bytes; k++)
+        {
+            out[k] = (value >> (8 * k)) & 0xFF;
+        }
+    }
+
+    string describeErrno()
+    {
+        return errno != 0 ? string(": ") + strerror(errno) : string();
+    }
+}
+
+TiledBmpWriter::TiledBmpWriter()
+    : width(0), height(0), bandHeight(1), rowBytes(0), doneCount(0), band(-1), bandY0(0), bandY1(0)
+{
+}
+
+bool TiledBmpWriter::open(const string &fileName, int width, int height, int bandHeight, const string &renderKey, bool resume,
+                          string &error)
+{
+    this->fileName = fileName;
+    this->renderKey = renderKey;
+    progressName = fileName + ".progress";
+    this->width = width;
+    this->height = height;
+    this->bandHeight = max(1, bandHeight);
+    rowBytes = ((size_t)width * 3 + 3) / 4 * 4;
+    bandDone.assign((height + this->bandHeight - 1) / this->bandHeight, false);
+    doneCount = 0;
+
+    // The header's sizes are 32-bit
+    if (width <= 0 || height <= 0 || HEADER_BYTES + rowBytes * height > numeric_limits<unsigned int>::max())
+    {
+        error = "a " + to_string(width) + "x" + to_string(height) + " image does not fit in a BMP file";
+        return false;
+    }
+
+    bool found = false;
+    if (resume && !readProgress(found, error))
+    {
+        return false;
+    }
+    if (found)
+    {
+        file.open(fileName, ios::in | ios::out | ios::binary);
+        file.seekg(0, ios::end);
+        if (!file || (size_t)(streamoff)file.tellg() != HEADER_BYTES + rowBytes * height)
+        {
+            error = fileName + " does not match its progress file; render again without --resume";
+            return false;
+        }
+    }
+    else if (!create(error))
+    {
+        return false;
+    }
+
+    progress.open(progressName, found ? ios::app : ios::trunc);
+    if (!progress)
+    {
+        error = "cannot write " + progressName + describeErrno();
+        return false;
+    }
+    if (!found)
+    {
+        // Which layout and render the listed bands belong to, checked on resume
+        progress << width << " " << height << " " << this->bandHeight << endl;
+        progress << renderKey << endl;
+    }
+    return true;
+}
+
+// Header, then the pixel area sized by writing its last byte; on most file
+// systems the rows in between take no space until they are written
+bool TiledBmpWriter::create(string &error)
+{
+    file.open(fileName, ios::in | ios::out | ios::binary | ios::trunc);
+    if (!file)
+    {
+        error = "cannot write " + fileName + describeErrno();
+        return false;
+    }
+
+    size_t imageBytes = rowBytes * height;
+    unsigned char header[HEADER_BYTES] = {};
+    header[0] = 'B';
+    header[1] = 'M';
+    putLittleEndian(header + 2, HEADER_BYTES + imageBytes, 4);
+    putLittleEndian(header + 10, HEADER_BYTES, 4);
+    putLittleEndian(header + 14, INFO_HEADER_BYTES, 4);
+    putLittleEndian(header + 18, width, 4);
+    putLittleEndian(header + 22, height, 4);
+    putLittleEndian(header + 26, 1, 2);  // planes
+    putLittleEndian(header + 28, 24, 2); // bits per pixel
+    putLittleEndian(header + 34, imageBytes, 4);
+    file.write(reinterpret_cast<const char *>(header), HEADER_BYTES);
+    file.seekp(HEADER_BYTES + imageBytes - 1);
+    file.put(0);
+    file.flush();
+    if (!file)
+    {
+        error = "cannot write " + fileName + describeErrno();
+        return false;
+    }
+    return true;
+}
+
+// The first line gives the layout the bands were cut with and the second the
+// render key; every other line is one finished band. A line cut short by a
+// crash is ignored.
+bool TiledBmpWriter::readProgress(bool &found, string &error)
+{
+    ifstream in(progressName);
+    found = (bool)in;
+    if (!found)
+    {
+        return true;
+    }
+
+    int listedWidth, listedHeight, listedBandHeight;
+    string line;
+    if (!(in >> listedWidth >> listedHeight >> listedBandHeight) || listedWidth != width || listedHeight != height ||
+        listedBandHeight != bandHeight)
+    {
+        error = progressName + " belongs to a render of another size or band height; render again without --resume";
+        return false;
+    }
+    getline(in, line);
+    if (!getline(in, line) || line != renderKey)
+    {
+        error = progressName + " belongs to a render of another scene, view or settings; render again without --resume";
+        return false;
+    }
+    while (getline(in, line))
+    {
+        char *end;
+        long listed = strtol(line.c_str(), &end, 10);
+        if (end != line.c_str() && *end == '\0' && listed >= 0 && listed < (long)bandDone.size() && !bandDone[listed])
+        {
+            bandDone[listed] = true;
+            doneCount++;
+        }
+    }
+    return true;
+}
+
+int TiledBmpWriter::getBandCount() const
+{
+    return bandDone.size();
+}
+
+int TiledBmpWriter::getBandHeight() const
+{
+    return bandHeight;
+}
+
+bool TiledBmpWriter::isBandDone(int band) const
+{
+    return bandDone[band];
+}
+
+int TiledBmpWriter::getDoneCount() const
+{
+    return doneCount;
+}
+
+void TiledBmpWriter::beginBand(int band)
+{
+    this->band = band;
+    bandY0 = band * bandHeight;
+    bandY1 = min(height, bandY0 + bandHeight);
+    // Padding bytes stay zero, as the rows are rewritten in place
+    pixels.assign((bandY1 - bandY0) * rowBytes, 0);
+}
+
+int TiledBmpWriter::getBandY0() const
+{
+    return bandY0;
+}
+
+int TiledBmpWriter::getBandY1() const
+{
+    return bandY1;
+}
+
+bool TiledBmpWriter::writeBand(string &error)
+{
+    // The bottom row of the band comes first in the file
+    file.seekp(HEADER_BYTES + (size_t)(height - bandY1) * rowBytes);
+    file.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+    file.flush();
+    if (!file)
+    {
+        error = "cannot write " + fileName + describeErrno();
+        return false;
+    }
+
+    // Only listed once its rows have reached the file
+    progress << band << endl;
+    if (!progress)
+    {
+        error = "cannot write " + progressName + describeErrno();
+        return false;
+    }
+    if (!bandDone[band])
+    {
+        bandDone[band] = true;
+        doneCount++;
+    }
+    return true;
+}
+
+bool TiledBmpWriter::finish(string &error)
+{
+    file.close();
+    progress.close();
+    if (doneCount < (int)bandDone.size())
+    {
+        error = to_string(bandDone.size() - doneCount) + " bands of " + fileName + " are still missing";
+        return false;
+    }
+    remove(progressName.c_str());
+    return true;
+}
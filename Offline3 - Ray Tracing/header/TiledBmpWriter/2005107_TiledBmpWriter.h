@@ -0,0 +1,69 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Writes a 24-bit BMP of any size one band of rows at a time, each straight
+// to its place in the file, so only one band is ever in memory. BMP keeps
+// rows bottom up, so a band's rows are buffered in that order and land in
+// one contiguous write.
+//
+// Bands written so far are listed in a progress file next to the image,
+// <image>.progress, which finish() removes. Opening with resume keeps the
+// bands it lists, so a render that died part way can carry on from there.
+// The file starts with the layout and a caller supplied render key naming
+// everything else the pixels depend on; resuming with either different is
+// refused rather than mixing bands of two renders.
+class TiledBmpWriter
+{
+private:
+    fstream file;
+    string fileName, progressName;
+    string renderKey;
+    ofstream progress;
+    int width, height, bandHeight;
+    size_t rowBytes; // with the padding to a multiple of four
+    vector<bool> bandDone;
+    int doneCount;
+
+    // The band being filled
+    int band;
+    int bandY0, bandY1;
+    vector<unsigned char> pixels;
+
+    bool create(string &error);
+    bool readProgress(bool &found, string &error);
+
+public:
+    TiledBmpWriter();
+
+    // renderKey must be a single line
+    bool open(const string &fileName, int width, int height, int bandHeight, const string &renderKey, bool resume,
+              string &error);
+
+    int getBandCount() const;
+    int getBandHeight() const;
+    bool isBandDone(int band) const;
+    int getDoneCount() const;
+
+    // Starts filling band, whose rows are [getBandY0(), getBandY1())
+    void beginBand(int band);
+    int getBandY0() const;
+    int getBandY1() const;
+    // Pixel (x, y) of the current band, y counted from the top of the image;
+    // distinct pixels may be set from several threads at once
+    void setPixel(int x, int y, unsigned char red, unsigned char green, unsigned char blue)
+    {
+        unsigned char *pixel = &pixels[(bandY1 - 1 - y) * rowBytes + 3 * x];
+        pixel[0] = blue;
+        pixel[1] = green;
+        pixel[2] = red;
+    }
+    // Writes the current band and records it as done
+    bool writeBand(string &error);
+
+    // Closes the image once every band is written and drops the progress file
+    bool finish(string &error);
+};
@@ -1,13 +1,16 @@
 #include "2005107_Triangle.h"
+#include "../RenderStats/2005107_RenderStats.h"
 #include <algorithm>
 #include <cmath>
 
+#ifndef RENDER_ONLY
 #ifdef __linux__
 #include <GL/glut.h>
 #elif WIN32
 #include <glut.h>
 #include <windows.h>
 #endif
+#endif
 
 extern double epsilon;
 
@@ -34,6 +37,7 @@ Triangle::Triangle(Vector3D a, Vector3D b, Vector3D c) : Object(), vertexA(a), v
 
 void Triangle::draw()
 {
+#ifndef RENDER_ONLY
     glBegin(GL_TRIANGLES);
     {
         glColor3f(color.getRed(), color.getGreen(), color.getBlue());
@@ -42,6 +46,7 @@ void Triangle::draw()
         glVertex3f(vertexC.x, vertexC.y, vertexC.z);
     }
     glEnd();
+#endif
 }
 
 Vector3D Triangle::computeNormal(Vector3D point)
@@ -51,23 +56,24 @@ Vector3D Triangle::computeNormal(Vector3D point)
     return normal;
 }
 
-double Triangle::intersect(Ray *ray)
+bool Triangle::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit)
 {
+    countStat(STAT_TRIANGLE_TESTS);
     Vector3D normal = computeNormal(referencePoint);
-    double denominator = normal * ray->getDirection();
+    double denominator = normal * ray.getDirection();
     
     if (fabs(denominator) < epsilon)
     {
-        return -1.0;
+        return false;
     }
     
-    double t = ((referencePoint - ray->getOrigin()) * normal) / denominator;
-    if (t < 0)
+    double t = ((referencePoint - ray.getOrigin()) * normal) / denominator;
+    if (t <= tMin || t >= tMax)
     {
-        return -1.0;
+        return false;
     }
     
-    Vector3D intersectionPoint = ray->getOrigin() + ray->getDirection() * t;
+    Vector3D intersectionPoint = ray.getOrigin().mulAdd(ray.getDirection(), t);
     
     // Check if point is inside triangle using cross product method
     Vector3D crossProduct0 = (vertexB - vertexA) ^ (intersectionPoint - vertexA);
@@ -76,8 +82,43 @@ double Triangle::intersect(Ray *ray)
     
     if ((crossProduct0 * crossProduct1 >= 0) && (crossProduct1 * crossProduct2 >= 0))
     {
-        return t;
+        hit.t = t;
+        hit.object = this;
+        return true;
     }
     
-    return -1.0;
+    return false;
+}
+
+void Triangle::intersectPacket(const RayPacket &packet, PacketHit &hits)
+{
+    countStat(STAT_TRIANGLE_TESTS, packet.activeCount());
+    Vector3D normal = computeNormal(referencePoint);
+    double vertices[9] = {vertexA.x, vertexA.y, vertexA.z, vertexB.x, vertexB.y, vertexB.z, vertexC.x, vertexC.y, vertexC.z};
+    double normalComponents[3] = {normal.x, normal.y, normal.z};
+    hits.setObject(getPacketKernels().triangle(packet, vertices, normalComponents, epsilon, hits.t), this);
+}
+
+AABB Triangle::getBounds()
+{
+    AABB bounds;
+    bounds.expand(vertexA);
+    bounds.expand(vertexB);
+    bounds.expand(vertexC);
+    return bounds;
+}
+
+Vector3D Triangle::getVertexA() const
+{
+    return vertexA;
+}
+
+Vector3D Triangle::getVertexB() const
+{
+    return vertexB;
+}
+
+Vector3D Triangle::getVertexC() const
+{
+    return vertexC;
 }
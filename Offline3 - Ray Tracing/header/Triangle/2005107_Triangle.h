@@ -2,7 +2,7 @@
 
 #include "../Object/2005107_Object.h"
 
-class Triangle : public Object
+class Triangle final : public Object
 {
 private:
     Vector3D vertexA, vertexB, vertexC;
@@ -13,5 +13,11 @@ public:
     
     void draw() override;
     Vector3D computeNormal(Vector3D point) override;
-    double intersect(Ray *ray) override;
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) override;
+    void intersectPacket(const RayPacket &packet, PacketHit &hits) override;
+    AABB getBounds() override;
+
+    Vector3D getVertexA() const;
+    Vector3D getVertexB() const;
+    Vector3D getVertexC() const;
 };
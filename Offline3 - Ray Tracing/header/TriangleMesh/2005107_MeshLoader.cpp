@@ -0,0 +1,536 @@
+#include "2005107_MeshLoader.h"
+#include "../MappedFile/2005107_MappedFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+    const int MAX_NUMBER_LENGTH = 63;
+
+    bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char *skipBlanks(const char *p, const char *end)
+    {
+        while (p < end && isBlank(*p))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    const char *tokenEnd(const char *p, const char *end)
+    {
+        while (p < end && !isBlank(*p))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    // The mapped file is not null terminated, so each number is copied out
+    // before strtod sees it
+    bool parseDouble(const char *begin, const char *end, double &value)
+    {
+        size_t length = end - begin;
+        if (length == 0 || length > MAX_NUMBER_LENGTH)
+        {
+            return false;
+        }
+        char buffer[MAX_NUMBER_LENGTH + 1];
+        memcpy(buffer, begin, length);
+        buffer[length] = '\0';
+        char *parsedEnd;
+        value = strtod(buffer, &parsedEnd);
+        return parsedEnd == buffer + length;
+    }
+
+    // Leading (optionally signed) integer of an OBJ face token such as 7, 7/2 or -1//3
+    bool parseFaceIndex(const char *begin, const char *end, long &value)
+    {
+        bool negative = begin < end && *begin == '-';
+        const char *p = negative ? begin + 1 : begin;
+        const char *digits = p;
+        value = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            value = value * 10 + (*p - '0');
+            if (value > 0xFFFFFFFFL)
+            {
+                return false;
+            }
+            p++;
+        }
+        if (p == digits || (p < end && *p != '/'))
+        {
+            return false;
+        }
+        if (negative)
+        {
+            value = -value;
+        }
+        return true;
+    }
+
+    string lineError(int line, const string &message)
+    {
+        ostringstream out;
+        out << "line " << line << ": " << message;
+        return out.str();
+    }
+
+    void appendFan(const vector<unsigned int> &polygon, vector<unsigned int> &indices)
+    {
+        for (size_t k = 2; k < polygon.size(); k++)
+        {
+            indices.push_back(polygon[0]);
+            indices.push_back(polygon[k - 1]);
+            indices.push_back(polygon[k]);
+        }
+    }
+
+    bool indicesInRange(const vector<unsigned int> &indices, size_t vertexCount, string &error)
+    {
+        for (unsigned int index : indices)
+        {
+            if (index >= vertexCount)
+            {
+                ostringstream out;
+                out << "vertex index " << index + 1 << " is out of range (" << vertexCount << " vertices)";
+                error = out.str();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    enum PlyType
+    {
+        PLY_INT8,
+        PLY_UINT8,
+        PLY_INT16,
+        PLY_UINT16,
+        PLY_INT32,
+        PLY_UINT32,
+        PLY_FLOAT32,
+        PLY_FLOAT64,
+        PLY_INVALID
+    };
+
+    struct PlyProperty
+    {
+        string name;
+        PlyType type;
+        bool isList;
+        PlyType countType;
+    };
+
+    struct PlyElement
+    {
+        string name;
+        size_t count;
+        vector<PlyProperty> properties;
+    };
+
+    PlyType plyTypeFromName(const string &name)
+    {
+        if (name == "char" || name == "int8") return PLY_INT8;
+        if (name == "uchar" || name == "uint8") return PLY_UINT8;
+        if (name == "short" || name == "int16") return PLY_INT16;
+        if (name == "ushort" || name == "uint16") return PLY_UINT16;
+        if (name == "int" || name == "int32") return PLY_INT32;
+        if (name == "uint" || name == "uint32") return PLY_UINT32;
+        if (name == "float" || name == "float32") return PLY_FLOAT32;
+        if (name == "double" || name == "float64") return PLY_FLOAT64;
+        return PLY_INVALID;
+    }
+
+    size_t plyTypeSize(PlyType type)
+    {
+        switch (type)
+        {
+        case PLY_INT8:
+        case PLY_UINT8:
+            return 1;
+        case PLY_INT16:
+        case PLY_UINT16:
+            return 2;
+        case PLY_INT32:
+        case PLY_UINT32:
+        case PLY_FLOAT32:
+            return 4;
+        default:
+            return 8;
+        }
+    }
+
+    bool hostIsBigEndian()
+    {
+        const uint16_t probe = 1;
+        unsigned char firstByte;
+        memcpy(&firstByte, &probe, 1);
+        return firstByte == 0;
+    }
+
+    // Reads one value and advances p; false when the file ends first
+    bool readPlyValue(const char *&p, const char *end, PlyType type, bool swapBytes, double &value)
+    {
+        size_t size = plyTypeSize(type);
+        if ((size_t)(end - p) < size)
+        {
+            return false;
+        }
+        unsigned char bytes[8];
+        memcpy(bytes, p, size);
+        if (swapBytes)
+        {
+            reverse(bytes, bytes + size);
+        }
+        p += size;
+
+        switch (type)
+        {
+        case PLY_INT8: { int8_t v; memcpy(&v, bytes, 1); value = v; break; }
+        case PLY_UINT8: { uint8_t v; memcpy(&v, bytes, 1); value = v; break; }
+        case PLY_INT16: { int16_t v; memcpy(&v, bytes, 2); value = v; break; }
+        case PLY_UINT16: { uint16_t v; memcpy(&v, bytes, 2); value = v; break; }
+        case PLY_INT32: { int32_t v; memcpy(&v, bytes, 4); value = v; break; }
+        case PLY_UINT32: { uint32_t v; memcpy(&v, bytes, 4); value = v; break; }
+        case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); value = v; break; }
+        default: { double v; memcpy(&v, bytes, 8); value = v; break; }
+        }
+        return true;
+    }
+
+    // Parses the ASCII header and leaves p at the first byte of binary data
+    bool readPlyHeader(const char *&p, const char *end, vector<PlyElement> &elements, bool &bigEndian, string &error)
+    {
+        int line = 0;
+        bool formatSeen = false;
+        while (p < end)
+        {
+            const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (lineEnd == nullptr)
+            {
+                break;
+            }
+            string text(p, lineEnd);
+            p = lineEnd + 1;
+            line++;
+            if (!text.empty() && text.back() == '\r')
+            {
+                text.pop_back();
+            }
+
+            istringstream words(text);
+            string keyword;
+            words >> keyword;
+            if (line == 1)
+            {
+                if (keyword != "ply")
+                {
+                    error = "not a PLY file";
+                    return false;
+                }
+            }
+            else if (keyword == "format")
+            {
+                string format;
+                words >> format;
+                if (format == "binary_little_endian" || format == "binary_big_endian")
+                {
+                    bigEndian = format == "binary_big_endian";
+                    formatSeen = true;
+                }
+                else
+                {
+                    error = "header line " + to_string(line) + ": PLY format '" + format + "' is not supported, only binary";
+                    return false;
+                }
+            }
+            else if (keyword == "element")
+            {
+                PlyElement element;
+                if (!(words >> element.name >> element.count))
+                {
+                    error = "header line " + to_string(line) + ": malformed element";
+                    return false;
+                }
+                elements.push_back(element);
+            }
+            else if (keyword == "property")
+            {
+                PlyProperty property;
+                string typeName;
+                words >> typeName;
+                property.isList = typeName == "list";
+                property.countType = PLY_INVALID;
+                if (property.isList)
+                {
+                    string countTypeName;
+                    words >> countTypeName >> typeName;
+                    property.countType = plyTypeFromName(countTypeName);
+                }
+                property.type = plyTypeFromName(typeName);
+                words >> property.name;
+                if (elements.empty() || property.type == PLY_INVALID || (property.isList && property.countType == PLY_INVALID) ||
+                    property.name.empty())
+                {
+                    error = "header line " + to_string(line) + ": malformed property";
+                    return false;
+                }
+                elements.back().properties.push_back(property);
+            }
+            else if (keyword == "end_header")
+            {
+                if (!formatSeen)
+                {
+                    error = "PLY header has no format line";
+                    return false;
+                }
+                return true;
+            }
+            // comment, obj_info and unknown keywords are skipped
+        }
+        error = "PLY header has no end_header line";
+        return false;
+    }
+
+    int findProperty(const PlyElement &element, const char *name)
+    {
+        for (size_t k = 0; k < element.properties.size(); k++)
+        {
+            if (element.properties[k].name == name)
+            {
+                return k;
+            }
+        }
+        return -1;
+    }
+}
+
+bool loadMesh(const string &fileName, vector<Vector3D> &vertices, vector<unsigned int> &indices, string &error)
+{
+    vertices.clear();
+    indices.clear();
+
+    size_t dot = fileName.find_last_of('.');
+    string extension = dot == string::npos ? "" : fileName.substr(dot + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != "obj" && extension != "ply")
+    {
+        error = fileName + ": unknown mesh format, expected .obj or .ply";
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.open(fileName, error))
+    {
+        return false;
+    }
+
+    bool loaded = extension == "obj" ? loadOBJ(file.begin(), file.end(), vertices, indices, error)
+                                     : loadPLY(file.begin(), file.end(), vertices, indices, error);
+    if (!loaded)
+    {
+        error = fileName + ": " + error;
+        return false;
+    }
+    if (indices.empty())
+    {
+        error = fileName + ": no triangles";
+        return false;
+    }
+    return true;
+}
+
+bool loadOBJ(const char *begin, const char *end, vector<Vector3D> &vertices, vector<unsigned int> &indices, string &error)
+{
+    vector<unsigned int> polygon;
+    int line = 0;
+    const char *p = begin;
+    while (p < end)
+    {
+        const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+        line++;
+
+        const char *token = skipBlanks(p, lineEnd);
+        const char *keywordEnd = tokenEnd(token, lineEnd);
+        size_t keywordLength = keywordEnd - token;
+
+        if (keywordLength == 1 && *token == 'v')
+        {
+            double coordinates[3];
+            const char *q = keywordEnd;
+            for (int k = 0; k < 3; k++)
+            {
+                q = skipBlanks(q, lineEnd);
+                const char *numberEnd = tokenEnd(q, lineEnd);
+                if (!parseDouble(q, numberEnd, coordinates[k]))
+                {
+                    error = lineError(line, "expected three vertex coordinates");
+                    return false;
+                }
+                q = numberEnd;
+            }
+            // An optional w (or vertex colour) may follow and is ignored
+            vertices.push_back(Vector3D(coordinates[0], coordinates[1], coordinates[2]));
+        }
+        else if (keywordLength == 1 && *token == 'f')
+        {
+            polygon.clear();
+            const char *q = skipBlanks(keywordEnd, lineEnd);
+            while (q < lineEnd)
+            {
+                const char *indexEnd = tokenEnd(q, lineEnd);
+                long index;
+                if (!parseFaceIndex(q, indexEnd, index) || index == 0)
+                {
+                    error = lineError(line, "malformed face vertex '" + string(q, indexEnd) + "'");
+                    return false;
+                }
+                // Negative indices count back from the latest vertex
+                long resolved = index > 0 ? index - 1 : (long)vertices.size() + index;
+                if (resolved < 0)
+                {
+                    error = lineError(line, "relative index " + to_string(index) + " is before the first vertex");
+                    return false;
+                }
+                polygon.push_back(resolved);
+                q = skipBlanks(indexEnd, lineEnd);
+            }
+            if (polygon.size() < 3)
+            {
+                error = lineError(line, "face has fewer than three vertices");
+                return false;
+            }
+            appendFan(polygon, indices);
+        }
+        // Comments, normals, texture coordinates, groups and materials are skipped
+
+        p = lineEnd + 1;
+    }
+
+    // Positive indices may refer to vertices listed after the face
+    return indicesInRange(indices, vertices.size(), error);
+}
+
+bool loadPLY(const char *begin, const char *end, vector<Vector3D> &vertices, vector<unsigned int> &indices, string &error)
+{
+    const char *p = begin;
+    vector<PlyElement> elements;
+    bool bigEndian = false;
+    if (!readPlyHeader(p, end, elements, bigEndian, error))
+    {
+        return false;
+    }
+    bool swapBytes = bigEndian != hostIsBigEndian();
+
+    vector<unsigned int> polygon;
+    vector<double> values;
+    for (const PlyElement &element : elements)
+    {
+        // Every item takes at least this many bytes, which bounds a believable count
+        size_t minimumItemSize = 0;
+        for (const PlyProperty &property : element.properties)
+        {
+            minimumItemSize += plyTypeSize(property.isList ? property.countType : property.type);
+        }
+        if (minimumItemSize > 0 && element.count > (size_t)(end - p) / minimumItemSize)
+        {
+            error = "file ends inside element " + element.name;
+            return false;
+        }
+
+        bool isVertex = element.name == "vertex";
+        bool isFace = element.name == "face";
+        int axes[3] = {findProperty(element, "x"), findProperty(element, "y"), findProperty(element, "z")};
+        int indexList = findProperty(element, "vertex_indices");
+        if (indexList < 0)
+        {
+            indexList = findProperty(element, "vertex_index");
+        }
+        if (isVertex && (axes[0] < 0 || axes[1] < 0 || axes[2] < 0))
+        {
+            error = "vertex element lacks x, y or z";
+            return false;
+        }
+        if (isFace && (indexList < 0 || !element.properties[indexList].isList))
+        {
+            error = "face element lacks a vertex_indices list";
+            return false;
+        }
+        if (isVertex)
+        {
+            vertices.reserve(element.count);
+        }
+        else if (isFace)
+        {
+            indices.reserve(3 * element.count);
+        }
+
+        values.resize(element.properties.size());
+        for (size_t item = 0; item < element.count; item++)
+        {
+            for (size_t k = 0; k < element.properties.size(); k++)
+            {
+                const PlyProperty &property = element.properties[k];
+                if (!property.isList)
+                {
+                    if (!readPlyValue(p, end, property.type, swapBytes, values[k]))
+                    {
+                        error = "file ends inside element " + element.name;
+                        return false;
+                    }
+                    continue;
+                }
+
+                double count;
+                if (!readPlyValue(p, end, property.countType, swapBytes, count) || count < 0)
+                {
+                    error = "file ends inside element " + element.name;
+                    return false;
+                }
+                bool keep = isFace && (int)k == indexList;
+                polygon.clear();
+                for (long entry = 0; entry < (long)count; entry++)
+                {
+                    double value;
+                    if (!readPlyValue(p, end, property.type, swapBytes, value))
+                    {
+                        error = "file ends inside element " + element.name;
+                        return false;
+                    }
+                    if (keep)
+                    {
+                        if (value < 0 || value >= vertices.size())
+                        {
+                            error = "face " + to_string(item) + " has vertex index " + to_string((long)value) +
+                                    " out of range (" + to_string(vertices.size()) + " vertices)";
+                            return false;
+                        }
+                        polygon.push_back((unsigned int)value);
+                    }
+                }
+                if (keep)
+                {
+                    appendFan(polygon, indices);
+                }
+            }
+            if (isVertex)
+            {
+                vertices.push_back(Vector3D(values[axes[0]], values[axes[1]], values[axes[2]]));
+            }
+        }
+    }
+    return true;
+}
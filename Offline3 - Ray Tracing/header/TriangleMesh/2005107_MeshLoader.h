@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Vector3D/2005107_Vector3D.h"
+
+// Reads the geometry of a Wavefront OBJ or binary PLY file, chosen by the file
+// extension. Polygons are fan triangulated into indices (three per triangle);
+// normals, texture coordinates and materials in the file are ignored. Returns
+// false with a message naming the file and line (OBJ) or element (PLY) on error.
+bool loadMesh(const string &fileName, vector<Vector3D> &vertices, vector<unsigned int> &indices, string &error);
+
+bool loadOBJ(const char *begin, const char *end, vector<Vector3D> &vertices, vector<unsigned int> &indices, string &error);
+bool loadPLY(const char *begin, const char *end, vector<Vector3D> &vertices, vector<unsigned int> &indices, string &error);
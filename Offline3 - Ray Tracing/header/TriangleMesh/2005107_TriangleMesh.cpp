@@ -0,0 +1,477 @@
+#include "2005107_TriangleMesh.h"
+#include "2005107_MeshLoader.h"
+#include "../RenderStats/2005107_RenderStats.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifndef RENDER_ONLY
+#ifdef __linux__
+#include <GL/glut.h>
+#elif WIN32
+#include <glut.h>
+#include <windows.h>
+#endif
+#endif
+
+extern double epsilon;
+
+namespace
+{
+    const int SAH_BIN_COUNT = 16;
+    const int MAX_LEAF_TRIANGLES = 8;
+    // Smaller ranges always become leaves; a few extra triangle tests cost less than the node memory
+    const int MIN_SPLIT_TRIANGLES = 4;
+    const int MAX_STACK_DEPTH = 64;
+    // Below this depth splits fall back to the median, which bounds the total depth by the stack size
+    const int MEDIAN_SPLIT_DEPTH = 32;
+    const double TRAVERSAL_COST = 1.0;
+    const double INTERSECTION_COST = 1.0;
+
+    float roundDown(double value)
+    {
+        float rounded = (float)value;
+        return rounded > value ? nextafterf(rounded, -numeric_limits<float>::infinity()) : rounded;
+    }
+
+    float roundUp(double value)
+    {
+        float rounded = (float)value;
+        return rounded < value ? nextafterf(rounded, numeric_limits<float>::infinity()) : rounded;
+    }
+
+    bool hitsNode(const MeshBVHNode &node, const double origin[3], const double inverseDirection[3], double tMin, double tMax)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            double t1 = (node.minimum[axis] - origin[axis]) * inverseDirection[axis];
+            double t2 = (node.maximum[axis] - origin[axis]) * inverseDirection[axis];
+            tMin = max(tMin, min(t1, t2));
+            tMax = min(tMax, max(t1, t2));
+        }
+        return tMin <= tMax;
+    }
+}
+
+TriangleMesh::TriangleMesh() : Object()
+{
+}
+
+bool TriangleMesh::load(const string &fileName, string &error)
+{
+    vector<Vector3D> loadedVertices;
+    vector<unsigned int> loadedIndices;
+    if (!loadMesh(fileName, loadedVertices, loadedIndices, error))
+    {
+        return false;
+    }
+    vertices.swap(loadedVertices);
+    indices.swap(loadedIndices);
+    vertices.shrink_to_fit();
+    nodes.clear();
+    return true;
+}
+
+void TriangleMesh::setGeometry(const vector<Vector3D> &vertices, const vector<unsigned int> &indices)
+{
+    this->vertices = vertices;
+    this->indices = indices;
+    nodes.clear();
+}
+
+void TriangleMesh::transform(double scale, const Vector3D &rotationDegrees, const Vector3D &translation)
+{
+    for (Vector3D &vertex : vertices)
+    {
+        Vector3D moved = vertex * scale;
+        moved = moved.rotate(Vector3D(1, 0, 0), rotationDegrees.x);
+        moved = moved.rotate(Vector3D(0, 1, 0), rotationDegrees.y);
+        moved = moved.rotate(Vector3D(0, 0, 1), rotationDegrees.z);
+        vertex = moved + translation;
+    }
+    nodes.clear();
+}
+
+void TriangleMesh::buildHierarchy()
+{
+    nodes.clear();
+    bounds = AABB();
+    for (const Vector3D &vertex : vertices)
+    {
+        bounds.expand(vertex);
+    }
+    referencePoint = bounds.centroid();
+
+    int triangleCount = getTriangleCount();
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    vector<BuildEntry> entries(triangleCount);
+    for (int triangle = 0; triangle < triangleCount; triangle++)
+    {
+        BuildEntry &entry = entries[triangle];
+        for (int k = 0; k < 3; k++)
+        {
+            entry.bounds.expand(vertices[indices[3 * triangle + k]]);
+        }
+        entry.centroid = entry.bounds.centroid();
+        entry.triangle = triangle;
+    }
+
+    vector<unsigned int> orderedIndices;
+    orderedIndices.reserve(indices.size());
+    nodes.reserve(2 * triangleCount / MAX_LEAF_TRIANGLES + 1);
+    buildRecursive(entries, 0, triangleCount, 0, orderedIndices);
+    indices.swap(orderedIndices);
+    nodes.shrink_to_fit();
+}
+
+int TriangleMesh::buildRecursive(vector<BuildEntry> &entries, int begin, int end, int depth, vector<unsigned int> &orderedIndices)
+{
+    AABB nodeBounds, centroidBounds;
+    for (int i = begin; i < end; i++)
+    {
+        nodeBounds.expand(entries[i].bounds);
+        centroidBounds.expand(entries[i].centroid);
+    }
+
+    int nodeIndex = nodes.size();
+    nodes.push_back(MeshBVHNode());
+    for (int axis = 0; axis < 3; axis++)
+    {
+        nodes[nodeIndex].minimum[axis] = roundDown(axisComponent(nodeBounds.minimum, axis));
+        nodes[nodeIndex].maximum[axis] = roundUp(axisComponent(nodeBounds.maximum, axis));
+    }
+    nodes[nodeIndex].splitAxis = 0;
+    nodes[nodeIndex].padding = 0;
+
+    int count = end - begin;
+    int axis = 0;
+    int middle = count > MIN_SPLIT_TRIANGLES ? partitionSAH(entries, begin, end, centroidBounds, nodeBounds.surfaceArea(), depth, axis) : -1;
+
+    if (middle < 0)
+    {
+        nodes[nodeIndex].secondChildOrFirstTriangle = orderedIndices.size() / 3;
+        nodes[nodeIndex].triangleCount = count;
+        for (int i = begin; i < end; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                orderedIndices.push_back(indices[3 * entries[i].triangle + k]);
+            }
+        }
+        return nodeIndex;
+    }
+
+    nodes[nodeIndex].splitAxis = axis;
+    nodes[nodeIndex].triangleCount = 0;
+    buildRecursive(entries, begin, middle, depth + 1, orderedIndices);
+    int secondChild = buildRecursive(entries, middle, end, depth + 1, orderedIndices);
+    nodes[nodeIndex].secondChildOrFirstTriangle = secondChild;
+    return nodeIndex;
+}
+
+// Same binned SAH as the scene BVH; returns the partition point, or -1 for a leaf
+int TriangleMesh::partitionSAH(vector<BuildEntry> &entries, int begin, int end, const AABB &centroidBounds, double parentArea, int depth, int &axis)
+{
+    int count = end - begin;
+    if (depth >= MEDIAN_SPLIT_DEPTH)
+    {
+        if (count <= MAX_LEAF_TRIANGLES)
+        {
+            return -1;
+        }
+        axis = centroidBounds.longestAxis();
+        int middle = begin + count / 2;
+        nth_element(entries.begin() + begin, entries.begin() + middle, entries.begin() + end, [axis](const BuildEntry &a, const BuildEntry &b) {
+            return axisComponent(a.centroid, axis) < axisComponent(b.centroid, axis);
+        });
+        return middle;
+    }
+
+    double leafCost = INTERSECTION_COST * count;
+    double bestCost = numeric_limits<double>::infinity();
+    int bestAxis = -1, bestSplit = -1;
+
+    for (int candidateAxis = 0; candidateAxis < 3; candidateAxis++)
+    {
+        double axisMin = axisComponent(centroidBounds.minimum, candidateAxis);
+        double axisMax = axisComponent(centroidBounds.maximum, candidateAxis);
+        if (axisMax - axisMin <= 0)
+        {
+            continue;
+        }
+
+        AABB binBounds[SAH_BIN_COUNT];
+        int binCounts[SAH_BIN_COUNT] = {0};
+        double scale = SAH_BIN_COUNT / (axisMax - axisMin);
+        for (int i = begin; i < end; i++)
+        {
+            int bin = min(SAH_BIN_COUNT - 1, (int)((axisComponent(entries[i].centroid, candidateAxis) - axisMin) * scale));
+            binCounts[bin]++;
+            binBounds[bin].expand(entries[i].bounds);
+        }
+
+        double rightArea[SAH_BIN_COUNT];
+        int rightCount[SAH_BIN_COUNT];
+        AABB accumulated;
+        int accumulatedCount = 0;
+        for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--)
+        {
+            accumulated.expand(binBounds[bin]);
+            accumulatedCount += binCounts[bin];
+            rightArea[bin] = accumulated.surfaceArea();
+            rightCount[bin] = accumulatedCount;
+        }
+
+        accumulated = AABB();
+        accumulatedCount = 0;
+        for (int split = 1; split < SAH_BIN_COUNT; split++)
+        {
+            accumulated.expand(binBounds[split - 1]);
+            accumulatedCount += binCounts[split - 1];
+            if (accumulatedCount == 0 || rightCount[split] == 0)
+            {
+                continue;
+            }
+            double cost = TRAVERSAL_COST + INTERSECTION_COST *
+                          (accumulated.surfaceArea() * accumulatedCount + rightArea[split] * rightCount[split]) / parentArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = candidateAxis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+    {
+        if (count <= MAX_LEAF_TRIANGLES)
+        {
+            return -1;
+        }
+        axis = 0;
+        return begin + count / 2;
+    }
+
+    if (bestCost >= leafCost && count <= MAX_LEAF_TRIANGLES)
+    {
+        return -1;
+    }
+
+    axis = bestAxis;
+    double axisMin = axisComponent(centroidBounds.minimum, axis);
+    double scale = SAH_BIN_COUNT / (axisComponent(centroidBounds.maximum, axis) - axisMin);
+    BuildEntry *middle = partition(&entries[begin], &entries[begin] + count, [&](const BuildEntry &entry) {
+        return min(SAH_BIN_COUNT - 1, (int)((axisComponent(entry.centroid, axis) - axisMin) * scale)) < bestSplit;
+    });
+    return middle - &entries[0];
+}
+
+void TriangleMesh::draw()
+{
+#ifndef RENDER_ONLY
+    glBegin(GL_TRIANGLES);
+    {
+        glColor3f(color.getRed(), color.getGreen(), color.getBlue());
+        for (unsigned int index : indices)
+        {
+            const Vector3D &vertex = vertices[index];
+            glVertex3f(vertex.x, vertex.y, vertex.z);
+        }
+    }
+    glEnd();
+#endif
+}
+
+// Moller-Trumbore, written on raw components since it runs once per candidate triangle.
+// Edges are inclusive, as in Triangle::intersect.
+bool TriangleMesh::intersectTriangle(unsigned int triangle, const Ray &ray, double tMin, double &tHit, double &u, double &v) const
+{
+    const Vector3D &a = vertices[indices[3 * triangle]];
+    const Vector3D &b = vertices[indices[3 * triangle + 1]];
+    const Vector3D &c = vertices[indices[3 * triangle + 2]];
+    const Vector3D &origin = ray.getOrigin();
+    const Vector3D &direction = ray.getDirection();
+
+    double edge1x = b.x - a.x, edge1y = b.y - a.y, edge1z = b.z - a.z;
+    double edge2x = c.x - a.x, edge2y = c.y - a.y, edge2z = c.z - a.z;
+    double px = direction.y * edge2z - direction.z * edge2y;
+    double py = direction.z * edge2x - direction.x * edge2z;
+    double pz = direction.x * edge2y - direction.y * edge2x;
+    double determinant = edge1x * px + edge1y * py + edge1z * pz;
+    // Mesh triangles can be tiny, so only exactly parallel rays are rejected here;
+    // nearly parallel ones fail the barycentric tests below
+    if (determinant == 0.0)
+    {
+        return false;
+    }
+    double inverseDeterminant = 1.0 / determinant;
+
+    double sx = origin.x - a.x, sy = origin.y - a.y, sz = origin.z - a.z;
+    double candidateU = (sx * px + sy * py + sz * pz) * inverseDeterminant;
+    if (candidateU < 0.0 || candidateU > 1.0)
+    {
+        return false;
+    }
+
+    double qx = sy * edge1z - sz * edge1y;
+    double qy = sz * edge1x - sx * edge1z;
+    double qz = sx * edge1y - sy * edge1x;
+    double candidateV = (direction.x * qx + direction.y * qy + direction.z * qz) * inverseDeterminant;
+    if (candidateV < 0.0 || candidateU + candidateV > 1.0)
+    {
+        return false;
+    }
+
+    double t = (edge2x * qx + edge2y * qy + edge2z * qz) * inverseDeterminant;
+    if (t <= tMin || t >= tHit)
+    {
+        return false;
+    }
+    tHit = t;
+    u = candidateU;
+    v = candidateV;
+    return true;
+}
+
+bool TriangleMesh::intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit)
+{
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    const Vector3D &rayOrigin = ray.getOrigin();
+    const Vector3D &rayDirection = ray.getDirection();
+    double origin[3] = {rayOrigin.x, rayOrigin.y, rayOrigin.z};
+    double inverseDirection[3] = {1.0 / rayDirection.x, 1.0 / rayDirection.y, 1.0 / rayDirection.z};
+    bool directionNegative[3] = {rayDirection.x < 0, rayDirection.y < 0, rayDirection.z < 0};
+
+    double tHit = tMax, u = 0, v = 0;
+    int nearest = -1;
+    int stack[MAX_STACK_DEPTH];
+    int stackSize = 0;
+    int nodeIndex = 0;
+    while (true)
+    {
+        const MeshBVHNode &node = nodes[nodeIndex];
+        if (hitsNode(node, origin, inverseDirection, tMin, tHit))
+        {
+            if (node.triangleCount > 0)
+            {
+                countStat(STAT_TRIANGLE_TESTS, node.triangleCount);
+                unsigned int last = node.secondChildOrFirstTriangle + node.triangleCount;
+                for (unsigned int triangle = node.secondChildOrFirstTriangle; triangle < last; triangle++)
+                {
+                    if (intersectTriangle(triangle, ray, tMin, tHit, u, v))
+                    {
+                        nearest = triangle;
+                    }
+                }
+            }
+            else
+            {
+                // Visit the child on the near side of the split plane first
+                if (directionNegative[node.splitAxis])
+                {
+                    stack[stackSize++] = nodeIndex + 1;
+                    nodeIndex = node.secondChildOrFirstTriangle;
+                }
+                else
+                {
+                    stack[stackSize++] = node.secondChildOrFirstTriangle;
+                    nodeIndex = nodeIndex + 1;
+                }
+                continue;
+            }
+        }
+        if (stackSize == 0)
+        {
+            break;
+        }
+        nodeIndex = stack[--stackSize];
+    }
+
+    if (nearest < 0)
+    {
+        return false;
+    }
+    hit.t = tHit;
+    hit.object = this;
+    hit.primitive = nearest;
+    hit.u = u;
+    hit.v = v;
+    return true;
+}
+
+Vector3D TriangleMesh::faceNormal(unsigned int triangle) const
+{
+    const Vector3D &a = vertices[indices[3 * triangle]];
+    const Vector3D &b = vertices[indices[3 * triangle + 1]];
+    const Vector3D &c = vertices[indices[3 * triangle + 2]];
+    Vector3D normal = (b - a) ^ (c - a);
+    normal.normalize();
+    return normal;
+}
+
+void TriangleMesh::completeHit(const Ray &ray, HitRecord &hit)
+{
+    // Packet traversal keeps only t and the object, so the face is looked up again around t
+    if (hit.primitive < 0)
+    {
+        double tolerance = epsilon * max(1.0, hit.t);
+        HitRecord face;
+        if (intersect(ray, hit.t - tolerance, hit.t + tolerance, face))
+        {
+            hit.primitive = face.primitive;
+            hit.u = face.u;
+            hit.v = face.v;
+        }
+    }
+
+    hit.point = ray.getOrigin().mulAdd(ray.getDirection(), hit.t);
+    hit.color = color;
+    if (hit.primitive < 0)
+    {
+        hit.normal = ray.getDirection() * -1.0;
+        return;
+    }
+
+    // Meshes are often open (terrain, scanned surfaces) or inconsistently wound,
+    // so the normal is turned towards the viewer to shade both sides alike
+    hit.normal = faceNormal(hit.primitive);
+    if (hit.normal * ray.getDirection() > 0)
+    {
+        hit.normal = hit.normal * -1.0;
+    }
+}
+
+AABB TriangleMesh::getBounds()
+{
+    return bounds;
+}
+
+int TriangleMesh::getTriangleCount() const
+{
+    return indices.size() / 3;
+}
+
+int TriangleMesh::getVertexCount() const
+{
+    return vertices.size();
+}
+
+int TriangleMesh::getNodeCount() const
+{
+    return nodes.size();
+}
+
+size_t TriangleMesh::getMemoryUsage() const
+{
+    return vertices.capacity() * sizeof(Vector3D) + indices.capacity() * sizeof(unsigned int) +
+           nodes.capacity() * sizeof(MeshBVHNode);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "../Object/2005107_Object.h"
+
+// Node of a mesh's own hierarchy, laid out like BVHNode but with float bounds
+// (rounded outwards, so they still enclose their triangles) to fit in 32 bytes
+struct MeshBVHNode
+{
+    float minimum[3], maximum[3];
+    unsigned int secondChildOrFirstTriangle; // interior: index of second child, leaf: first triangle
+    unsigned short triangleCount;            // 0 for interior nodes
+    unsigned char splitAxis;
+    unsigned char padding;
+};
+
+// Indexed triangle mesh sharing one material. Vertices are stored once and
+// every triangle is three 32-bit indices into them; the triangles are reordered
+// at build time so each leaf of the mesh's hierarchy covers a contiguous range.
+// The scene BVH sees the mesh as a single bounded object.
+class TriangleMesh final : public Object
+{
+private:
+    struct BuildEntry
+    {
+        AABB bounds;
+        Vector3D centroid;
+        unsigned int triangle;
+    };
+
+    vector<Vector3D> vertices;
+    vector<unsigned int> indices;
+    vector<MeshBVHNode> nodes;
+    AABB bounds;
+
+    int buildRecursive(vector<BuildEntry> &entries, int begin, int end, int depth, vector<unsigned int> &orderedIndices);
+    int partitionSAH(vector<BuildEntry> &entries, int begin, int end, const AABB &centroidBounds, double parentArea, int depth, int &axis);
+    bool intersectTriangle(unsigned int triangle, const Ray &ray, double tMin, double &tHit, double &u, double &v) const;
+    Vector3D faceNormal(unsigned int triangle) const;
+
+public:
+    TriangleMesh();
+
+    // Replaces the geometry with the contents of an OBJ or binary PLY file
+    bool load(const string &fileName, string &error);
+    void setGeometry(const vector<Vector3D> &vertices, const vector<unsigned int> &indices);
+    // Scales about the origin, rotates about x, then y, then z, then translates
+    void transform(double scale, const Vector3D &rotationDegrees, const Vector3D &translation);
+    // Must be called after the geometry last changes and before rendering
+    void buildHierarchy();
+
+    void draw() override;
+    bool intersect(const Ray &ray, double tMin, double tMax, HitRecord &hit) override;
+    void completeHit(const Ray &ray, HitRecord &hit) override;
+    AABB getBounds() override;
+
+    int getTriangleCount() const;
+    int getVertexCount() const;
+    int getNodeCount() const;
+    size_t getMemoryUsage() const;
+};
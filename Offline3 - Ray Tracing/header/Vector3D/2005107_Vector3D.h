@@ -3,65 +3,130 @@
 
 #include <cmath>
 #include <iostream>
+#include <type_traits>
+
+#include "../Precision/2005107_Precision.h"
+#include "../SimdMath/2005107_SimdMath.h"
 
 using namespace std;
 
-class Vector3D {
+// Three component vector over scalar type T; the renderer uses Vector3D,
+// which is Vector3DT<Real>. Everything is defined here so the operators inline
+// into the hot loops; the arithmetic runs on Lanes3 registers. Copies are
+// compiler generated, so the type is trivially copyable.
+template <class T>
+class Vector3DT {
 public:
-    double x, y, z;
+    T x, y, z;
 
     // Constructors
-    Vector3D(double x = 0, double y = 0, double z = 0);
-    Vector3D(const Vector3D& other);
-
-    // Assignment operator
-    Vector3D& operator=(const Vector3D& other);
+    constexpr Vector3DT(T x = 0, T y = 0, T z = 0) : x(x), y(y), z(z) {}
+    // Converts between precisions
+    template <class U>
+    constexpr explicit Vector3DT(const Vector3DT<U>& other) : x(other.x), y(other.y), z(other.z) {}
 
     // Arithmetic operators
-    Vector3D operator+(const Vector3D& other) const;
-    Vector3D operator-(const Vector3D& other) const;
-    Vector3D operator*(double scalar) const;
-    Vector3D operator/(double scalar) const;
+    Vector3DT operator+(const Vector3DT& other) const { return Vector3DT(lanes() + other.lanes()); }
+    Vector3DT operator-(const Vector3DT& other) const { return Vector3DT(lanes() - other.lanes()); }
+    Vector3DT operator*(T scalar) const { return Vector3DT(lanes() * Lanes3<T>::set1(scalar)); }
+    Vector3DT operator/(T scalar) const { return Vector3DT(lanes() / Lanes3<T>::set1(scalar)); }
 
     // Compound assignment operators
-    Vector3D& operator+=(const Vector3D& other);
-    Vector3D& operator-=(const Vector3D& other);
-    Vector3D& operator*=(double scalar);
-    Vector3D& operator/=(double scalar);
+    Vector3DT& operator+=(const Vector3DT& other) { return *this = *this + other; }
+    Vector3DT& operator-=(const Vector3DT& other) { return *this = *this - other; }
+    Vector3DT& operator*=(T scalar) { return *this = *this * scalar; }
+    Vector3DT& operator/=(T scalar) { return *this = *this / scalar; }
 
     // Comparison operators
-    bool operator==(const Vector3D& other) const;
-    bool operator!=(const Vector3D& other) const;
+    bool operator==(const Vector3DT& other) const {
+        const T epsilon = 1e-9;
+        return abs(x - other.x) < epsilon && abs(y - other.y) < epsilon && abs(z - other.z) < epsilon;
+    }
+    bool operator!=(const Vector3DT& other) const { return !(*this == other); }
 
     // Vector operations
-    double dot(const Vector3D& other) const;
-    Vector3D cross(const Vector3D& other) const;
-    double length() const;
-    double lengthSquared() const;
-    void normalize();
-    Vector3D normalized() const;
-    Vector3D rotate(const Vector3D& axis, double degrees) const;
+    T dot(const Vector3DT& other) const { return Lanes3<T>::dot(lanes(), other.lanes()); }
+    constexpr Vector3DT cross(const Vector3DT& other) const {
+        return Vector3DT(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+    }
+    T length() const { return sqrt(lengthSquared()); }
+    T lengthSquared() const { return dot(*this); }
+    void normalize() {
+        T len = length();
+        if (len > 0) {
+            *this /= len;
+        }
+    }
+    Vector3DT normalized() const {
+        T len = length();
+        if (len > 0) {
+            return *this / len;
+        }
+        return zero();
+    }
+    Vector3DT rotate(const Vector3DT& axis, double degrees) const;
+
+    // Fused helpers
+    // this + direction * scalar, e.g. the point at distance t along a ray
+    Vector3DT mulAdd(const Vector3DT& direction, T scalar) const {
+        return Vector3DT(lanes() + direction.lanes() * Lanes3<T>::set1(scalar));
+    }
+    // Mirror image of this direction about the plane with the given unit normal
+    Vector3DT reflect(const Vector3DT& normal) const { return *this - normal * (2 * dot(normal)); }
 
     // Legacy operators for backward compatibility
-    double operator*(const Vector3D& v) const; // dot product
-    Vector3D operator^(const Vector3D& v) const; // cross product
+    T operator*(const Vector3DT& v) const { return dot(v); } // dot product
+    constexpr Vector3DT operator^(const Vector3DT& v) const { return cross(v); } // cross product
 
     // Static utility functions
-    static Vector3D zero();
-    static Vector3D one();
-    static Vector3D up();
-    static Vector3D down();
-    static Vector3D left();
-    static Vector3D right();
-    static Vector3D forward();
-    static Vector3D backward();
-
-    // Friend function for output stream operator
-    friend ostream& operator<<(ostream& out, const Vector3D& vector);
+    static constexpr Vector3DT zero() { return Vector3DT(0, 0, 0); }
+    static constexpr Vector3DT one() { return Vector3DT(1, 1, 1); }
+    static constexpr Vector3DT up() { return Vector3DT(0, 1, 0); }
+    static constexpr Vector3DT down() { return Vector3DT(0, -1, 0); }
+    static constexpr Vector3DT left() { return Vector3DT(-1, 0, 0); }
+    static constexpr Vector3DT right() { return Vector3DT(1, 0, 0); }
+    static constexpr Vector3DT forward() { return Vector3DT(0, 0, 1); }
+    static constexpr Vector3DT backward() { return Vector3DT(0, 0, -1); }
+
+private:
+    explicit Vector3DT(const Lanes3<T>& lanes) { lanes.store(&x); }
+    Lanes3<T> lanes() const { return Lanes3<T>::load(&x); }
 };
 
+typedef Vector3DT<Real> Vector3D;
+
+// lanes() reads x, y and z as one packed array
+static_assert(sizeof(Vector3DT<float>) == 3 * sizeof(float) && sizeof(Vector3DT<double>) == 3 * sizeof(double),
+              "Vector3DT must be exactly three packed scalars");
+static_assert(is_trivially_copyable<Vector3DT<Real> >::value, "Vector3DT copies must stay plain memberwise copies");
+
 // Utility functions
-double degreeToRadian(double degree);
-double radianToDegree(double radian);
+inline double degreeToRadian(double degree) {
+    return degree * M_PI / 180;
+}
+
+inline double radianToDegree(double radian) {
+    return radian * 180 / M_PI;
+}
+
+template <class T>
+Vector3DT<T> Vector3DT<T>::rotate(const Vector3DT& axis, double degrees) const {
+    Vector3DT v = *this;
+    Vector3DT k = axis.normalized();
+    double theta = degreeToRadian(degrees);
+    double cosTheta = cos(theta);
+    double sinTheta = sin(theta);
+    T dotProduct = k.dot(v);
+
+    // Rodrigues' rotation formula: v*cos(θ) + (k × v)*sin(θ) + k*(k · v)*(1 - cos(θ))
+    return v * cosTheta + k.cross(v) * sinTheta + k * dotProduct * (1 - cosTheta);
+}
+
+// Output stream operator
+template <class T>
+ostream& operator<<(ostream& out, const Vector3DT<T>& vector) {
+    out << "< " << vector.x << " " << vector.y << " " << vector.z << " >";
+    return out;
+}
 
 #endif // VECTOR3D_H
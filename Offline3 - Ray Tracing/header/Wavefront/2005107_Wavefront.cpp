@@ -0,0 +1,262 @@
+#include "2005107_Wavefront.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <new>
+#include <vector>
+using namespace std;
+
+#include "../Object/2005107_Object.h"
+#include "../Camera/2005107_Camera.h"
+#include "../PointLight/2005107_PointLight.h"
+#include "../SpotLight/2005107_SpotLight.h"
+#include "../CompiledScene/2005107_CompiledScene.h"
+#include "../RenderStats/2005107_RenderStats.h"
+#include "../ScratchArena/2005107_ScratchArena.h"
+#include "../LightTree/2005107_LightTree.h"
+
+extern double recursionLevel;
+extern double zNear, zFar;
+extern vector<PointLight *> pointLights;
+extern vector<SpotLight *> spotLights;
+extern CompiledScene compiledScene;
+extern Camera camera;
+
+namespace
+{
+    // Shadow queries gathered before they are traced together; bounds the
+    // queue however many lights the scene has
+    const int SHADOW_BATCH = 1024;
+
+    // Covers the alignment padding between the arrays carved from the arena
+    const size_t ALIGNMENT_SLACK = 8 * alignof(double);
+
+    struct QueuedRay
+    {
+        Ray ray;
+        double tMin, tMax;
+        int source; // pixel for primary rays, parent segment for reflections
+    };
+
+    // One hit along a pixel's reflection chain
+    struct PathSegment
+    {
+        Color color;     // shading at this hit; the resolved colour once folded
+        Color reflected; // resolved colour of the reflection, when there is one
+        Object *object;
+        int parent; // segment this one is the reflection of, -1 at depth 0
+        int depth;
+        bool hasReflection;
+    };
+
+    struct ShadowQuery
+    {
+        LightSample sample;
+        Vector3D point;
+        int segment;
+    };
+
+    // Depths 0..D, where D is the first depth at which reflection stops
+    int depthCount()
+    {
+        int lastDepth = recursionLevel > 0 ? (int)min(ceil(recursionLevel), (double)MAX_WAVEFRONT_DEPTH) : 0;
+        return lastDepth + 1;
+    }
+
+    // Traces the queued shadow rays and adds the light of every unblocked one
+    // to its segment, in queue order, which is each segment's light order
+    void flushShadows(const ShadowQuery *queries, int count, PathSegment *segments)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            const ShadowQuery &query = queries[k];
+            if (!Object::isInShadow(query.point, query.sample.lightPosition, query.sample.distance, query.sample.lightIndex))
+            {
+                Object::addLightSample(query.sample, &segments[query.segment].color);
+            }
+        }
+    }
+
+    // Used only if the arena could not hold the queues: the rays are traced as traceRay() would
+    void traceRecursive(const Ray *rays, int count, Color *colors, const Object **primaryObjects)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            countStat(STAT_PRIMARY_RAYS);
+            colors[i] = Color(0, 0, 0);
+            if (primaryObjects != nullptr)
+            {
+                primaryObjects[i] = nullptr;
+            }
+
+            double tMin = 0, tMax = numeric_limits<double>::infinity();
+            HitRecord hit;
+            if (rays[i].clipToDepthRange(camera.getPosition(), camera.getLookDirection(), zNear, zFar, tMin, tMax) &&
+                compiledScene.intersect(rays[i], tMin, tMax, hit))
+            {
+                hit.object->phongLighting(rays[i], hit, &colors[i], 0);
+                if (primaryObjects != nullptr)
+                {
+                    primaryObjects[i] = hit.object;
+                }
+            }
+        }
+    }
+}
+
+size_t wavefrontScratchBytes(int rayCount)
+{
+    size_t count = max(rayCount, 0);
+    return 2 * count * sizeof(QueuedRay) + count * sizeof(HitRecord) + count * depthCount() * sizeof(PathSegment) +
+           count * sizeof(int) + SHADOW_BATCH * sizeof(ShadowQuery) + ALIGNMENT_SLACK;
+}
+
+void traceWavefront(const Ray *rays, int count, Color *colors, const Object **primaryObjects)
+{
+    int depths = depthCount();
+    int lightCount = pointLights.size() + spotLights.size();
+    bool sampledLights = Object::usesLightSampling();
+    int chosenLights[MAX_LIGHT_SAMPLES];
+    double chosenWeights[MAX_LIGHT_SAMPLES];
+
+    ScratchArena &arena = threadScratchArena();
+    QueuedRay *queue = arena.allocate<QueuedRay>(count);
+    QueuedRay *nextQueue = arena.allocate<QueuedRay>(count);
+    HitRecord *hits = arena.allocate<HitRecord>(count);
+    PathSegment *segments = arena.allocate<PathSegment>((size_t)count * depths);
+    int *pixelSegments = arena.allocate<int>(count);
+    ShadowQuery *shadows = arena.allocate<ShadowQuery>(SHADOW_BATCH);
+    if (queue == nullptr || nextQueue == nullptr || hits == nullptr || segments == nullptr || pixelSegments == nullptr || shadows == nullptr)
+    {
+        traceRecursive(rays, count, colors, primaryObjects);
+        return;
+    }
+
+    // Primary rays, clipped to the part between the near and far planes
+    int queueSize = 0;
+    for (int i = 0; i < count; i++)
+    {
+        countStat(STAT_PRIMARY_RAYS);
+        pixelSegments[i] = -1;
+        QueuedRay &queued = queue[queueSize];
+        queued.ray = rays[i];
+        queued.tMin = 0;
+        queued.tMax = numeric_limits<double>::infinity();
+        queued.source = i;
+        if (rays[i].clipToDepthRange(camera.getPosition(), camera.getLookDirection(), zNear, zFar, queued.tMin, queued.tMax))
+        {
+            queueSize++;
+        }
+    }
+
+    int segmentCount = 0;
+    for (int depth = 0; queueSize > 0; depth++)
+    {
+        // Nearest hits for the whole queue; rays that hit are compacted to the front
+        int hitCount = 0;
+        {
+            ScopedPhase phase(depth == 0 ? PHASE_PRIMARY_VISIBILITY : PHASE_REFLECTION_RAYS);
+            for (int k = 0; k < queueSize; k++)
+            {
+                HitRecord *hit = new (&hits[hitCount]) HitRecord();
+                if (compiledScene.intersect(queue[k].ray, queue[k].tMin, queue[k].tMax, *hit))
+                {
+                    queue[hitCount++] = queue[k];
+                }
+            }
+        }
+
+        // Shading up to the shadow tests, which are queued, and the reflection rays of the next depth
+        int nextQueueSize = 0;
+        int shadowCount = 0;
+        {
+            ScopedPhase phase(PHASE_SHADING);
+            recordDepth(depth);
+            for (int k = 0; k < hitCount; k++)
+            {
+                const HitRecord &hit = hits[k];
+                const QueuedRay &queued = queue[k];
+                int segmentIndex = segmentCount++;
+                PathSegment &segment = segments[segmentIndex];
+                segment.color = hit.color * hit.object->getCoefficients().getAmbient();
+                segment.object = hit.object;
+                segment.parent = depth == 0 ? -1 : queued.source;
+                segment.depth = depth;
+                segment.hasReflection = false;
+                if (depth == 0)
+                {
+                    pixelSegments[queued.source] = segmentIndex;
+                }
+
+                // Every light, or in many-light mode the ones the light tree picks
+                int lightsToShade = sampledLights ? Object::chooseLights(hit, chosenLights, chosenWeights) : lightCount;
+                for (int k = 0; k < lightsToShade; k++)
+                {
+                    int lightIndex = sampledLights ? chosenLights[k] : k;
+                    ShadowQuery &query = shadows[shadowCount];
+                    if (!hit.object->sampleLight(hit, lightIndex, query.sample))
+                    {
+                        continue;
+                    }
+                    hit.object->weighLightSample(hit, queued.ray, query.sample);
+                    if (sampledLights)
+                    {
+                        Object::scaleLightSample(query.sample, chosenWeights[k]);
+                    }
+                    query.point = hit.point;
+                    query.segment = segmentIndex;
+                    if (++shadowCount == SHADOW_BATCH)
+                    {
+                        flushShadows(shadows, shadowCount, segments);
+                        shadowCount = 0;
+                    }
+                }
+
+                if (depth < recursionLevel)
+                {
+                    countStat(STAT_REFLECTION_RAYS);
+                    QueuedRay &reflection = nextQueue[nextQueueSize];
+                    if (depth + 1 < depths && hit.object->getReflectedRay(hit, queued.ray, reflection.ray, reflection.tMin, reflection.tMax))
+                    {
+                        reflection.source = segmentIndex;
+                        nextQueueSize++;
+                    }
+                }
+            }
+        }
+        flushShadows(shadows, shadowCount, segments);
+
+        swap(queue, nextQueue);
+        queueSize = nextQueueSize;
+    }
+
+    // Children were created after their parents, so walking backwards folds
+    // every reflection into its parent before the parent is folded itself
+    for (int s = segmentCount - 1; s >= 0; s--)
+    {
+        PathSegment &segment = segments[s];
+        if (segment.depth < recursionLevel)
+        {
+            if (segment.hasReflection)
+            {
+                segment.object->addReflection(segment.reflected, &segment.color);
+            }
+            segment.color.clamp();
+        }
+        if (segment.parent >= 0)
+        {
+            segments[segment.parent].reflected = segment.color;
+            segments[segment.parent].hasReflection = true;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int segmentIndex = pixelSegments[i];
+        colors[i] = segmentIndex >= 0 ? segments[segmentIndex].color : Color(0, 0, 0);
+        if (primaryObjects != nullptr)
+        {
+            primaryObjects[i] = segmentIndex >= 0 ? segments[segmentIndex].object : nullptr;
+        }
+    }
+}
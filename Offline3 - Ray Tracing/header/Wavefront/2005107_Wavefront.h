@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+using namespace std;
+
+#include "../Color/2005107_Color.h"
+#include "../Ray/2005107_Ray.h"
+
+class Object;
+
+// Breadth-first alternative to traceRay(). A batch of primary rays is
+// intersected together, every hit is shaded up to its shadow tests, and the
+// shadow rays and the reflection rays it spawns go into queues that are each
+// processed in bulk, one reflection depth at a time, until no rays are left or
+// recursionLevel is reached. Each path keeps its shading per depth, and the
+// reflections are folded back into their parents at the end with the same
+// arithmetic (and per-level clamping) as the recursive renderer, so both give
+// the same image.
+//
+// All queues live in the calling thread's scratch arena, which must have been
+// reset with room for wavefrontScratchBytes(count) plus the shading scratch.
+
+// Reflection depths the executor follows at most, whatever recursionLevel says
+const int MAX_WAVEFRONT_DEPTH = 64;
+
+size_t wavefrontScratchBytes(int rayCount);
+
+// Colours of count primary rays (clipped to the camera's depth range here) and,
+// when primaryObjects is given, the object each hits first (nullptr on a miss)
+void traceWavefront(const Ray *rays, int count, Color *colors, const Object **primaryObjects);
@@ -0,0 +1,335 @@
+#include "2005107_WorkerPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    // Sent by a worker once its scene is loaded; also tells apart a worker
+    // that failed before reaching the protocol
+    const unsigned int HELLO_MAGIC = 0x57524b31; // "WRK1"
+
+    // Bands each worker holds at once, so it starts the next while the last travels back
+    const size_t BANDS_IN_FLIGHT = 2;
+
+    enum MessageType
+    {
+        MESSAGE_FRAME = 1,
+        MESSAGE_BAND = 2,
+        MESSAGE_QUIT = 3
+    };
+
+    struct BandHeader
+    {
+        int y0, y1;
+    };
+
+    // Both ends run the same executable on the same host, so values go over the
+    // socket in memory layout. MSG_NOSIGNAL turns a closed peer into an error
+    // rather than a SIGPIPE.
+    bool sendAll(int fd, const void *data, size_t size)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0)
+        {
+            ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (sent <= 0)
+            {
+                return false;
+            }
+            bytes += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    bool receiveAll(int fd, void *data, size_t size)
+    {
+        char *bytes = static_cast<char *>(data);
+        while (size > 0)
+        {
+            ssize_t received = recv(fd, bytes, size, 0);
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (received <= 0)
+            {
+                return false;
+            }
+            bytes += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    bool sendMessage(int fd, MessageType type, const void *payload, size_t size)
+    {
+        int header = type;
+        return sendAll(fd, &header, sizeof(header)) && sendAll(fd, payload, size);
+    }
+
+    // Child side of fork(). Only async-signal-safe calls until exec: the
+    // worker's end of the socket loses close-on-exec, and output goes to
+    // /dev/null, as every worker would repeat the coordinator's scene summary.
+    void execWorker(char *const argv[], int socket, int devNull)
+    {
+        if (fcntl(socket, F_SETFD, 0) != 0 || dup2(devNull, STDOUT_FILENO) < 0)
+        {
+            _exit(127);
+        }
+        execv("/proc/self/exe", argv);
+        _exit(127);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+bool WorkerPool::start(const vector<string> &arguments, int count, string &error)
+{
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (devNull < 0)
+    {
+        error = string("cannot open /dev/null: ") + strerror(errno);
+        return false;
+    }
+    for (int k = 0; k < count; k++)
+    {
+        // Close-on-exec, so later workers do not inherit the coordinator's
+        // ends and keep a dead worker's socket open
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0)
+        {
+            error = string("cannot create a worker socket: ") + strerror(errno);
+            break;
+        }
+        vector<string> workerArguments = arguments;
+        workerArguments.push_back("--worker-fd");
+        workerArguments.push_back(to_string(sockets[1]));
+        vector<char *> argv;
+        argv.push_back(const_cast<char *>("2005107_main"));
+        for (string &argument : workerArguments)
+        {
+            argv.push_back(&argument[0]);
+        }
+        argv.push_back(nullptr);
+
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            execWorker(argv.data(), sockets[1], devNull);
+        }
+        close(sockets[1]);
+        if (pid < 0)
+        {
+            close(sockets[0]);
+            error = string("cannot start a worker: ") + strerror(errno);
+            break;
+        }
+        Worker worker;
+        worker.pid = pid;
+        worker.fd = sockets[0];
+        workers.push_back(worker);
+    }
+
+    close(devNull);
+
+    // Workers load their scenes in parallel; each says hello when it is done
+    deque<int> unused;
+    for (size_t k = workers.size(); k-- > 0;)
+    {
+        unsigned int hello = 0;
+        if (!receiveAll(workers[k].fd, &hello, sizeof(hello)) || hello != HELLO_MAGIC)
+        {
+            drop(k, unused, "exited before loading the scene");
+        }
+    }
+    if (workers.empty() && error.empty())
+    {
+        error = "no worker could load the scene";
+    }
+    return !workers.empty();
+}
+
+int WorkerPool::getWorkerCount() const
+{
+    return workers.size();
+}
+
+void WorkerPool::drop(size_t index, deque<int> &pending, const string &reason)
+{
+    Worker &worker = workers[index];
+    cout << "Worker " << worker.pid << " " << reason;
+    if (!worker.outstanding.empty())
+    {
+        cout << ", reassigning " << worker.outstanding.size() << " bands";
+    }
+    cout << endl;
+
+    close(worker.fd);
+    kill(worker.pid, SIGKILL);
+    waitpid(worker.pid, nullptr, 0);
+    pending.insert(pending.begin(), worker.outstanding.begin(), worker.outstanding.end());
+    workers.erase(workers.begin() + index);
+}
+
+void WorkerPool::render(const FrameSetup &frame, int bandHeight, const BandSink &store, const BandRenderer &renderLocally)
+{
+    bandHeight = max(1, bandHeight);
+    int bandCount = (frame.height + bandHeight - 1) / bandHeight;
+    deque<int> pending;
+    for (int band = 0; band < bandCount; band++)
+    {
+        pending.push_back(band);
+    }
+    vector<unsigned char> pixels((size_t)frame.width * bandHeight * 3);
+
+    for (size_t k = workers.size(); k-- > 0;)
+    {
+        if (!sendMessage(workers[k].fd, MESSAGE_FRAME, &frame, sizeof(frame)))
+        {
+            drop(k, pending, "stopped responding");
+        }
+    }
+
+    int received = 0;
+    vector<pollfd> polled;
+    while (received < bandCount && !workers.empty())
+    {
+        // Top up every worker's queue
+        for (size_t k = workers.size(); k-- > 0;)
+        {
+            Worker &worker = workers[k];
+            while (worker.outstanding.size() < BANDS_IN_FLIGHT && !pending.empty())
+            {
+                int band = pending.front();
+                BandHeader header = {band * bandHeight, min(frame.height, (band + 1) * bandHeight)};
+                if (!sendMessage(worker.fd, MESSAGE_BAND, &header, sizeof(header)))
+                {
+                    drop(k, pending, "stopped responding");
+                    break;
+                }
+                pending.pop_front();
+                worker.outstanding.push_back(band);
+            }
+        }
+
+        polled.clear();
+        for (const Worker &worker : workers)
+        {
+            pollfd entry = {worker.fd, POLLIN, 0};
+            polled.push_back(entry);
+        }
+        if (polled.empty() || poll(polled.data(), polled.size(), -1) < 0)
+        {
+            continue;
+        }
+
+        // Backwards, so dropping a worker leaves the indices still to visit alone
+        for (size_t k = polled.size(); k-- > 0;)
+        {
+            if (polled[k].revents == 0)
+            {
+                continue;
+            }
+            Worker &worker = workers[k];
+            BandHeader header;
+            int band = worker.outstanding.empty() ? -1 : worker.outstanding.front();
+            bool valid = band >= 0 && receiveAll(worker.fd, &header, sizeof(header)) && header.y0 == band * bandHeight &&
+                         header.y1 == min(frame.height, (band + 1) * bandHeight);
+            size_t bandBytes = valid ? (size_t)frame.width * (header.y1 - header.y0) * 3 : 0;
+            if (!valid || !receiveAll(worker.fd, pixels.data(), bandBytes))
+            {
+                drop(k, pending, "stopped before finishing its bands");
+                continue;
+            }
+            store(header.y0, header.y1, pixels.data());
+            worker.outstanding.pop_front();
+            received++;
+        }
+    }
+
+    // Whatever the workers could not finish
+    if (!pending.empty())
+    {
+        cout << "Rendering the remaining " << pending.size() << " bands locally" << endl;
+    }
+    for (int band : pending)
+    {
+        int y0 = band * bandHeight, y1 = min(frame.height, y0 + bandHeight);
+        renderLocally(y0, y1, pixels.data());
+        store(y0, y1, pixels.data());
+    }
+}
+
+void WorkerPool::stop()
+{
+    for (Worker &worker : workers)
+    {
+        sendMessage(worker.fd, MESSAGE_QUIT, nullptr, 0);
+        close(worker.fd);
+        waitpid(worker.pid, nullptr, 0);
+    }
+    workers.clear();
+}
+
+int serveWorker(int fd, const function<void(const FrameSetup &)> &setFrame, const BandRenderer &renderBand)
+{
+    if (!sendAll(fd, &HELLO_MAGIC, sizeof(HELLO_MAGIC)))
+    {
+        return 1;
+    }
+
+    FrameSetup frame;
+    bool haveFrame = false;
+    vector<unsigned char> pixels;
+    int type;
+    while (receiveAll(fd, &type, sizeof(type)))
+    {
+        if (type == MESSAGE_FRAME)
+        {
+            if (!receiveAll(fd, &frame, sizeof(frame)))
+            {
+                return 1;
+            }
+            setFrame(frame);
+            haveFrame = true;
+        }
+        else if (type == MESSAGE_BAND)
+        {
+            BandHeader header;
+            if (!receiveAll(fd, &header, sizeof(header)) || !haveFrame || header.y0 < 0 || header.y1 <= header.y0 ||
+                header.y1 > frame.height)
+            {
+                return 1;
+            }
+            pixels.resize((size_t)frame.width * (header.y1 - header.y0) * 3);
+            renderBand(header.y0, header.y1, pixels.data());
+            if (!sendAll(fd, &header, sizeof(header)) || !sendAll(fd, pixels.data(), pixels.size()))
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            return type == MESSAGE_QUIT ? 0 : 1;
+        }
+    }
+    // The coordinator went away
+    return 1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+using namespace std;
+
+// What a worker needs to trace the coordinator's view: the image size and the
+// camera exactly as its getters report it, so worker pixels match local ones
+struct FrameSetup
+{
+    int width, height;
+    double position[3], look[3], up[3], right[3];
+};
+
+// Fills rgb, row y0 first and each row left to right, with rows [y0, y1)
+typedef function<void(int y0, int y1, unsigned char *rgb)> BandRenderer;
+// Receives rows [y0, y1) of the frame in the same layout
+typedef function<void(int y0, int y1, const unsigned char *rgb)> BandSink;
+
+// Runs copies of this program as worker processes on the local host and
+// shares frames between them. Each worker loads the same scene, then talks
+// to the coordinator over its own Unix socket pair: the coordinator sends the
+// view and bands of rows, the worker sends back each band's pixels in the
+// order it was asked for. A worker that exits, crashes or sends anything
+// unexpected is dropped and its outstanding bands are handed to the others;
+// with none left, the coordinator renders the rest itself.
+class WorkerPool
+{
+private:
+    struct Worker
+    {
+        pid_t pid;
+        int fd;
+        deque<int> outstanding; // bands sent and not yet returned, oldest first
+    };
+
+    vector<Worker> workers;
+
+    // Kills and reaps the worker and puts its outstanding bands back in front of pending
+    void drop(size_t index, deque<int> &pending, const string &reason);
+
+public:
+    ~WorkerPool();
+
+    // Starts count workers running this executable with arguments plus
+    // "--worker-fd N", and waits until each has loaded its scene. Workers
+    // that fail to start are reported and left out; false when none did.
+    bool start(const vector<string> &arguments, int count, string &error);
+    int getWorkerCount() const;
+
+    // Renders frame in bands of bandHeight rows and hands every band to store,
+    // from this thread, in whatever order they arrive
+    void render(const FrameSetup &frame, int bandHeight, const BandSink &store, const BandRenderer &renderLocally);
+
+    // Tells the workers to exit and waits for them
+    void stop();
+};
+
+// Worker side of the protocol, for a process started with --worker-fd: takes
+// each view with setFrame and renders the bands asked for until the
+// coordinator says to stop or goes away. Returns the process exit code.
+int serveWorker(int fd, const function<void(const FrameSetup &)> &setFrame, const BandRenderer &renderBand);
@@ -1,27 +1,116 @@
 #! /bin/bash
+sources="header/Camera/2005107_Camera.cpp header/Coefficients/2005107_Coefficients.cpp header/Ray/2005107_Ray.cpp header/Object/2005107_Object.cpp header/Floor/2005107_Floor.cpp header/MipmapTexture/2005107_MipmapTexture.cpp header/Sphere/2005107_Sphere.cpp header/Triangle/2005107_Triangle.cpp header/General/2005107_General.cpp header/TriangleMesh/2005107_TriangleMesh.cpp header/TriangleMesh/2005107_MeshLoader.cpp header/MappedFile/2005107_MappedFile.cpp header/PointLight/2005107_PointLight.cpp header/SpotLight/2005107_SpotLight.cpp header/TileScheduler/2005107_TileScheduler.cpp header/AABB/2005107_AABB.cpp header/BVH/2005107_BVH.cpp header/CompiledScene/2005107_CompiledScene.cpp header/CompiledScene/2005107_PrimitiveDispatch.cpp header/Benchmark/2005107_Benchmark.cpp header/ProgressiveRenderer/2005107_ProgressiveRenderer.cpp header/Sampling/2005107_Sampling.cpp header/CameraPath/2005107_CameraPath.cpp header/FrameWriter/2005107_FrameWriter.cpp header/RenderStats/2005107_RenderStats.cpp header/Wavefront/2005107_Wavefront.cpp header/LightTree/2005107_LightTree.cpp header/TextScanner/2005107_TextScanner.cpp header/SceneStore/2005107_SceneStore.cpp header/SceneCache/2005107_SceneCache.cpp header/TiledBmpWriter/2005107_TiledBmpWriter.cpp header/WorkerPool/2005107_WorkerPool.cpp header/ScratchArena/2005107_ScratchArena.cpp header/AllocationCheck/2005107_AllocationCheck.cpp header/SceneGenerator/2005107_SceneGenerator.cpp header/RayPacket/2005107_RayPacket.cpp header/RayPacket/2005107_PacketKernelsSSE2.cpp header/RayPacket/2005107_PacketKernelsAVX2.cpp 2005107_main.cpp"
+
+# Every build is optimized; unoptimized timings say little about the renderer
+
+# --float selects the single precision build and --check-allocations the build
+# that asserts tracing never allocates; both flags are for this script only
+build_flags=""
+arguments=()
+for argument in "$@"
+do
+    if [ "$argument" == "--float" ]
+    then
+        build_flags="$build_flags -DRENDER_FLOAT"
+    elif [ "$argument" == "--check-allocations" ]
+    then
+        build_flags="$build_flags -DCHECK_ALLOCATIONS"
+    else
+        arguments+=("$argument")
+    fi
+done
+set -- "${arguments[@]}"
+
+# The benchmark suite generates its own scenes, so it takes no input file
+if [ "$1" == "--benchmark-suite" ]
+then
+    g++ -std=c++11 -O2 -DRENDER_ONLY $build_flags $sources -o 2005107_main -pthread
+    ./2005107_main "$@"
+    rm 2005107_main
+    exit
+fi
+
+# Renders the sample scenes with a double and a float build and reports how far
+# apart they are; fails when either scene's PSNR drops below the floor
+if [ "$1" == "--validate-precision" ]
+then
+    output_directory=${2:-output/precision}
+    minimum_psnr=40
+    mkdir -p "$output_directory"
+    g++ -std=c++11 -O2 -DRENDER_ONLY $sources -o 2005107_main_double -pthread
+    g++ -std=c++11 -O2 -DRENDER_ONLY -DRENDER_FLOAT $sources -o 2005107_main_float -pthread
+    status=0
+    for scene in input input2
+    do
+        for precision in double float
+        do
+            ./2005107_main_$precision io/$scene.txt "$output_directory" --render --out "$output_directory/$scene-$precision.bmp" "${@:3}" | grep -E "Render time|Scalar precision"
+        done
+        ./2005107_main_double --compare "$output_directory/$scene-double.bmp" "$output_directory/$scene-float.bmp" --min-psnr $minimum_psnr || status=1
+    done
+    rm 2005107_main_double 2005107_main_float
+    exit $status
+fi
+
+# Renders the sample scenes with the recursive and the wavefront executor and
+# checks they agree; fails when either scene's PSNR drops below the floor
+if [ "$1" == "--validate-wavefront" ]
+then
+    output_directory=${2:-output/wavefront}
+    minimum_psnr=50
+    mkdir -p "$output_directory"
+    g++ -std=c++11 -O2 -DRENDER_ONLY $build_flags $sources -o 2005107_main -pthread
+    status=0
+    for scene in input input2
+    do
+        ./2005107_main io/$scene.txt "$output_directory" --render --out "$output_directory/$scene-recursive.bmp" "${@:3}" | grep -E "Render time"
+        ./2005107_main io/$scene.txt "$output_directory" --render --wavefront --out "$output_directory/$scene-wavefront.bmp" "${@:3}" | grep -E "Render time|Wavefront tracing"
+        ./2005107_main --compare "$output_directory/$scene-recursive.bmp" "$output_directory/$scene-wavefront.bmp" --min-psnr $minimum_psnr || status=1
+    done
+    rm 2005107_main
+    exit $status
+fi
+
 if [ -z "$2" ]
 then
-    echo "usage: ./run.sh <input_file_path> <output_file_directory> [texture_file_path]"
+    echo "usage: ./run.sh --benchmark-suite <results.json> [--threads N] [--tile-size N] [--packets] [--simd scalar|sse2|avx2] [--phase-timers] [--light-samples N] [--float] [--check-allocations]"
+    echo "       ./run.sh --validate-precision [output_directory] [render options]"
+    echo "       ./run.sh --validate-wavefront [output_directory] [render options]"
+    echo "       ./run.sh <input_file_path> <output_file_directory> [texture_file_path] [--threads N] [--tile-size N] [--packets] [--wavefront] [--simd scalar|sse2|avx2] [--flat] [--benchmark] [--render] [--camera px,py,pz,lx,ly,lz,ux,uy,uz] [--out file.bmp] [--extra-samples N] [--aa N] [--aa-threshold T] [--camera-path file.txt] [--phase-timers] [--texture-filter nearest|bilinear|trilinear] [--light-samples N] [--no-scene-cache] [--resolution N] [--tiled-output] [--resume] [--workers N] [--float] [--check-allocations]"
     exit 1
 fi
 input_file_path=$1
 output_file_directory=$2
 texture_file_path=$3
+render_options="${@:4}"
+
+# Options may follow the output directory directly when no texture is given
+if [[ "$texture_file_path" == --* ]]
+then
+    texture_file_path=""
+    render_options="${@:3}"
+fi
 
 if [ ! -d "$output_file_directory" ]
 then
     mkdir -p $output_file_directory
 fi
 
-g++ -std=c++11 header/Camera/2005107_Camera.cpp header/Vector3D/2005107_Vector3D.cpp header/Color/2005107_Color.cpp header/Coefficients/2005107_Coefficients.cpp header/Ray/2005107_Ray.cpp header/Object/2005107_Object.cpp header/Floor/2005107_Floor.cpp header/Sphere/2005107_Sphere.cpp header/Triangle/2005107_Triangle.cpp header/General/2005107_General.cpp header/PointLight/2005107_PointLight.cpp header/SpotLight/2005107_SpotLight.cpp 2005107_main.cpp -o 2005107_main -lGL -lGLU -lglut
+# --render and --camera-path need no window, so that build leaves out the viewer and links without OpenGL/GLUT
+if [[ " $render_options " == *" --render "* || " $render_options " == *" --camera-path "* ]]
+then
+    g++ -std=c++11 -O2 -DRENDER_ONLY $build_flags $sources -o 2005107_main -pthread
+else
+    g++ -std=c++11 -O2 $build_flags $sources 2005107_viewer.cpp -o 2005107_main -lGL -lGLU -lglut -pthread
+fi
 
 if [ -z "$texture_file_path" ]
 then
     echo "Running without texture (checkerboard pattern)"
-    ./2005107_main $input_file_path $output_file_directory
+    ./2005107_main $input_file_path $output_file_directory $render_options
 else
     echo "Running with texture: $texture_file_path"
-    ./2005107_main $input_file_path $output_file_directory $texture_file_path
+    ./2005107_main $input_file_path $output_file_directory $texture_file_path $render_options
 fi
 
 rm 2005107_main
\ No newline at end of file